@@ -0,0 +1,106 @@
+// cost of the root certificates per handshake on one long-lived handle, the
+// way the client's api, upload and file handles see it: the PEM bundle
+// handed over as CURLOPT_CAINFO_BLOB (parsed on every handshake), as a
+// CURLOPT_CAINFO file with the CA cache off, and as a file with libcurl's
+// CA cache on (what gemini_client_prepare() sets up)
+//
+// build: make bench BENCH=bench_ca_bundle
+// run as: bench_ca_bundle [https url] [bundle path]
+
+// define __declspc as empty for native linux build (0or MSVC)
+#include <stddef.h>
+#ifndef __declspec
+#define __declspec(x)
+#endif
+
+#include <curl/curl.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../gemini_api/gemini_client.h"
+#include "../utils/read_file.h"
+
+#define ROUNDS 10
+
+typedef enum CaMode { CA_BLOB, CA_FILE, CA_FILE_CACHED } CaMode;
+
+static size_t discard(char *data, size_t size, size_t nmemb, void *userdata) {
+  return size * nmemb;
+}
+
+// average handshake (connect to TLS done) of ROUNDS fresh connections on
+// one handle in ms, -1 when one failed
+static double run(GeminiClient *client, const char *url, CaMode mode,
+                  char *bundle) {
+  CURL *curl = curl_easy_init();
+  double handshakes = 0;
+
+  for (int i = 0; i < ROUNDS; i++) {
+    gemini_client_prepare(client, curl);
+    if (mode == CA_BLOB) {
+      struct curl_blob ca_blob = {bundle, strlen(bundle), CURL_BLOB_COPY};
+      curl_easy_setopt(curl, CURLOPT_CAINFO_BLOB, &ca_blob);
+      curl_easy_setopt(curl, CURLOPT_CAINFO, NULL);
+      curl_easy_setopt(curl, CURLOPT_CAPATH, NULL);
+    } else if (mode == CA_FILE) {
+      curl_easy_setopt(curl, CURLOPT_CA_CACHE_TIMEOUT, 0L);
+    }
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard);
+    // a new connection and a full handshake every round
+    curl_easy_setopt(curl, CURLOPT_SHARE, NULL);
+    curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+    curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 0L);
+
+    CURLcode res = curl_easy_perform(curl);
+    curl_off_t connected_us = 0;
+    curl_off_t tls_done_us = 0;
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connected_us);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls_done_us);
+
+    if (res != CURLE_OK) {
+      fprintf(stderr, "[ERROR] %s: %s\n", url, curl_easy_strerror(res));
+      curl_easy_cleanup(curl);
+      return -1;
+    }
+    handshakes += (tls_done_us - connected_us) / 1000.0;
+  }
+
+  curl_easy_cleanup(curl);
+  return handshakes / ROUNDS;
+}
+
+int main(int argc, char **argv) {
+  const char *url =
+      argc > 1 ? argv[1] : "https://generativelanguage.googleapis.com/";
+  const char *path = argc > 2 ? argv[2] : GEMINI_CLIENT_DEFAULT_CA_BUNDLE;
+
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  // the URLs only matter for requests, none are made through the client
+  GeminiClient *client = gemini_client_create(url, url, "bench");
+  if (!client)
+    return EXIT_FAILURE;
+
+  char *bundle = NULL;
+  if (gemini_client_set_ca_bundle(client, path) != 0 ||
+      !(bundle = read_file(client->ca_bundle))) {
+    fprintf(stderr, "[ERROR] Can't read %s\n", path);
+    return EXIT_FAILURE;
+  }
+
+  printf("bundle: %s, %zu KiB\n", client->ca_bundle, strlen(bundle) / 1024);
+  printf("blob          %8.2f ms per handshake\n",
+         run(client, url, CA_BLOB, bundle));
+  printf("file          %8.2f ms per handshake\n",
+         run(client, url, CA_FILE, bundle));
+  printf("file, cached  %8.2f ms per handshake\n",
+         run(client, url, CA_FILE_CACHED, bundle));
+
+  free(bundle);
+  gemini_client_destroy(client);
+  curl_global_cleanup();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+// back-to-back prompt latency: a fresh client per request (the old
+// curl_easy_init/cleanup behavior) against one persistent gemini client
+//
+// build: make bench BENCH=bench_client
+// run from src/ so ../env.json and the CA bundle resolve
+
+// define __declspc as empty for native linux build (0or MSVC)
+#include <stddef.h>
+#ifndef __declspec
+#define __declspec(x)
+#endif
+
+#include <cjson/cJSON.h>
+#include <curl/curl.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../gemini_api/gemini_client.h"
+#include "../gemini_api/gemini_request.h"
+#include "../utils/get_time_ms.h"
+#include "../utils/read_file.h"
+
+#define ROUNDS 5
+
+static char prompt[] = "Reply with the single word: pong";
+
+static double run_cold(const char *url, const char *file_url,
+                       const char *key) {
+  double total = 0;
+
+  for (int i = 0; i < ROUNDS; i++) {
+    double start = get_time_ms();
+    GeminiClient *client = gemini_client_create(url, file_url, key);
+    char *res = gemini_request(client, NULL, prompt, NULL, 0);
+    gemini_client_destroy(client);
+    double elapsed = get_time_ms() - start;
+
+    printf("  cold #%d: %8.1f ms\n", i + 1, elapsed);
+    total += elapsed;
+    free(res);
+  }
+
+  return total / ROUNDS;
+}
+
+static double run_warm(const char *url, const char *file_url,
+                       const char *key) {
+  double total = 0;
+  GeminiClient *client = gemini_client_create(url, file_url, key);
+
+  // first request pays DNS + TCP + TLS, keep it out of the average
+  free(gemini_request(client, NULL, prompt, NULL, 0));
+
+  for (int i = 0; i < ROUNDS; i++) {
+    double start = get_time_ms();
+    char *res = gemini_request(client, NULL, prompt, NULL, 0);
+    double elapsed = get_time_ms() - start;
+
+    printf("  warm #%d: %8.1f ms\n", i + 1, elapsed);
+    total += elapsed;
+    free(res);
+  }
+
+  gemini_client_destroy(client);
+  return total / ROUNDS;
+}
+
+int main(void) {
+  char *env_json = read_file("../env.json");
+  cJSON *env = cJSON_Parse(env_json);
+  if (!env) {
+    fprintf(stderr, "[ERROR] Could not read ../env.json\n");
+    free(env_json);
+    return EXIT_FAILURE;
+  }
+
+  const char *key = cJSON_GetStringValue(
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_API_KEY"));
+  const char *url = cJSON_GetStringValue(
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_API_URL"));
+  const char *file_url = cJSON_GetStringValue(
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_FILE_URL"));
+
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  printf("fresh handle per request:\n");
+  double cold = run_cold(url, file_url, key);
+  printf("persistent client:\n");
+  double warm = run_warm(url, file_url, key);
+
+  printf("\navg cold: %.1f ms, avg warm: %.1f ms, saved %.1f ms per request\n",
+         cold, warm, cold - warm);
+
+  curl_global_cleanup();
+  cJSON_Delete(env);
+  free(env_json);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+// pulling the answer out of a generateContent response: the old full
+// cJSON_Parse tree against the json_extract path scan, for small to large
+// responses shaped like the real ones (usage, safety ratings, several parts)
+//
+// build: make bench BENCH=bench_json_extract
+
+// define __declspc as empty for native linux build (0or MSVC)
+#include <stddef.h>
+#ifndef __declspec
+#define __declspec(x)
+#endif
+
+#include <cjson/cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../types/types.h"
+#include "../callbacks/write_callback.h"
+#include "../utils/get_time_ms.h"
+#include "../utils/json_extract.h"
+
+#define ITERATIONS 2000
+
+static void append(Memory *mem, const char *text) {
+  write_callback((char *)text, 1, strlen(text), mem);
+}
+
+static Memory make_response(int part_count, size_t part_len) {
+  Memory mem = {malloc(1), 0};
+  mem.response[0] = '\0';
+
+  append(&mem, "{\n  \"candidates\": [\n    {\n      \"content\": {\n"
+               "        \"parts\": [\n");
+
+  const char *line = "Chapter \\\"3\\\": \\033[1mkey\\033[0m idea \\u00e9.\\n";
+  for (int i = 0; i < part_count; i++) {
+    append(&mem, i == 0 ? "          {\"text\": \""
+                        : ",\n          {\"text\": \"");
+    for (size_t written = 0; written < part_len; written += strlen(line)) {
+      append(&mem, line);
+    }
+    append(&mem, "\"}");
+  }
+
+  append(&mem, "\n        ],\n        \"role\": \"model\"\n      },\n"
+               "      \"finishReason\": \"STOP\",\n"
+               "      \"safetyRatings\": [\n");
+  for (int i = 0; i < 4; i++) {
+    append(&mem, i == 0 ? "" : ",\n");
+    append(&mem, "        {\"category\": \"HARM_CATEGORY_HARASSMENT\", "
+                 "\"probability\": \"NEGLIGIBLE\"}");
+  }
+  append(&mem, "\n      ]\n    }\n  ],\n"
+               "  \"usageMetadata\": {\"promptTokenCount\": 812, "
+               "\"candidatesTokenCount\": 5120, \"totalTokenCount\": 5932},\n"
+               "  \"modelVersion\": \"gemini-2.5-flash\"\n}\n");
+
+  return mem;
+}
+
+// what gemini_request() did before, extended to every part for fairness
+static char *cjson_text(Memory *mem) {
+  cJSON *mem_res = cJSON_Parse(mem->response);
+  cJSON *candidates = cJSON_GetObjectItemCaseSensitive(mem_res, "candidates");
+  cJSON *first_candidate = cJSON_GetArrayItem(candidates, 0);
+  cJSON *content = cJSON_GetObjectItemCaseSensitive(first_candidate, "content");
+  cJSON *parts = cJSON_GetObjectItemCaseSensitive(content, "parts");
+
+  Memory text = {malloc(1), 0};
+  text.response[0] = '\0';
+
+  cJSON *part = NULL;
+  cJSON_ArrayForEach(part, parts) {
+    cJSON *part_text = cJSON_GetObjectItemCaseSensitive(part, "text");
+    if (cJSON_IsString(part_text))
+      append(&text, part_text->valuestring);
+  }
+
+  cJSON_Delete(mem_res);
+
+  return text.response;
+}
+
+static void run(int part_count, size_t part_len) {
+  Memory mem = make_response(part_count, part_len);
+
+  size_t cjson_len = 0;
+  double start = get_time_ms();
+  for (int i = 0; i < ITERATIONS; i++) {
+    char *text = cjson_text(&mem);
+    cjson_len = strlen(text);
+    free(text);
+  }
+  double cjson_ms = get_time_ms() - start;
+
+  size_t extract_len = 0;
+  start = get_time_ms();
+  for (int i = 0; i < ITERATIONS; i++) {
+    char *text =
+        json_concat_text(mem.response, mem.size, "candidates[0].content.parts");
+    extract_len = strlen(text);
+    free(text);
+  }
+  double extract_ms = get_time_ms() - start;
+
+  printf("%7zu B | cJSON %9.2f us | extract %9.2f us | %.1fx%s\n", mem.size,
+         cjson_ms * 1000.0 / ITERATIONS, extract_ms * 1000.0 / ITERATIONS,
+         cjson_ms / extract_ms,
+         cjson_len == extract_len ? "" : " (text differs!)");
+
+  free(mem.response);
+}
+
+int main(void) {
+  run(1, 256);
+  run(1, 4 * 1024);
+  run(3, 16 * 1024);
+  run(8, 64 * 1024);
+
+  return EXIT_SUCCESS;
+}
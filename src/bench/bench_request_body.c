@@ -0,0 +1,119 @@
+// generateContent body construction: the old cJSON tree + cJSON_Print path
+// against the streaming JSON writer, for 0, 5 and 50 file parts
+//
+// build: make bench BENCH=bench_request_body
+
+// define __declspc as empty for native linux build (0or MSVC)
+#include <stddef.h>
+#ifndef __declspec
+#define __declspec(x)
+#endif
+
+#include <cjson/cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../gemini_api/build_request_body.h"
+#include "../gemini_api/gemini_client.h"
+#include "../utils/get_time_ms.h"
+
+#define ITERATIONS 20000
+
+static char system_prompt[3200];
+static char user_prompt[] = "Summarize chapter 3 of the attached \"notes\".";
+
+// what gemini_request() did before the writer
+static char *cjson_body(char **file_uris, char **file_mime_types,
+                        int file_count) {
+  char full_prompt[4000];
+  snprintf(full_prompt, sizeof(full_prompt),
+           "System Prompt: %s\nUser Prompt: %s", system_prompt, user_prompt);
+
+  cJSON *req_body_json = cJSON_CreateObject();
+  cJSON *contents = cJSON_CreateArray();
+  cJSON_AddItemToObject(req_body_json, "contents", contents);
+
+  cJSON *content = cJSON_CreateObject();
+  cJSON_AddItemToArray(contents, content);
+  cJSON *parts = cJSON_CreateArray();
+  cJSON_AddItemToObject(content, "parts", parts);
+
+  for (int i = 0; i < file_count; i++) {
+    cJSON *part_file = cJSON_CreateObject();
+    cJSON *file_data = cJSON_CreateObject();
+    cJSON_AddItemToObject(part_file, "file_data", file_data);
+    cJSON_AddStringToObject(file_data, "mime_type", file_mime_types[i]);
+    cJSON_AddStringToObject(file_data, "file_uri", file_uris[i]);
+    cJSON_AddItemToArray(parts, part_file);
+  }
+
+  cJSON *part_text = cJSON_CreateObject();
+  cJSON_AddStringToObject(part_text, "text", full_prompt);
+  cJSON_AddItemToArray(parts, part_text);
+
+  char *req_body_json_str = cJSON_Print(req_body_json);
+  cJSON_Delete(req_body_json);
+
+  return req_body_json_str;
+}
+
+static void run(GeminiClient *client, int file_count) {
+  char **file_uris = malloc((file_count + 1) * sizeof(char *));
+  char **file_mime_types = malloc((file_count + 1) * sizeof(char *));
+
+  for (int i = 0; i < file_count; i++) {
+    file_uris[i] = malloc(96);
+    snprintf(file_uris[i], 96,
+             "https://generativelanguage.googleapis.com/v1beta/files/%08d", i);
+    file_mime_types[i] = "application/pdf";
+  }
+
+  size_t cjson_len = 0;
+  double start = get_time_ms();
+  for (int i = 0; i < ITERATIONS; i++) {
+    char *body = cjson_body(file_uris, file_mime_types, file_count);
+    cjson_len = strlen(body);
+    free(body);
+  }
+  double cjson_ms = get_time_ms() - start;
+
+  size_t writer_len = 0;
+  start = get_time_ms();
+  for (int i = 0; i < ITERATIONS; i++) {
+    build_request_body(client, file_uris, user_prompt, file_mime_types,
+                       file_count, NULL, &writer_len);
+  }
+  double writer_ms = get_time_ms() - start;
+
+  printf("%2d parts | cJSON %8.2f us %6zu B | writer %8.2f us %6zu B | "
+         "%.1fx\n",
+         file_count, cjson_ms * 1000.0 / ITERATIONS, cjson_len,
+         writer_ms * 1000.0 / ITERATIONS, writer_len, cjson_ms / writer_ms);
+
+  for (int i = 0; i < file_count; i++) {
+    free(file_uris[i]);
+  }
+  free(file_uris);
+  free(file_mime_types);
+}
+
+int main(void) {
+  // roughly the size of the real system prompt, with quotes and escapes
+  const char *line = "- Use \\033[1m for \"bold\" text in the terminal.\n";
+  while (strlen(system_prompt) + strlen(line) < sizeof(system_prompt)) {
+    strcat(system_prompt, line);
+  }
+
+  GeminiClient client = {0};
+  gemini_client_set_system_prompt(&client, system_prompt);
+
+  run(&client, 0);
+  run(&client, 5);
+  run(&client, 50);
+
+  free(client.prompt_prefix_json);
+  json_writer_free(&client.body);
+
+  return EXIT_SUCCESS;
+}
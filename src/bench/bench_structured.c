@@ -0,0 +1,118 @@
+// decoding a structured answer (a JSON array of quiz questions) into C
+// structs: cJSON_Parse plus copying every field out of the tree against
+// structured_decode() scanning the text in place, for a few to many items
+//
+// build: make bench BENCH=bench_structured
+
+// define __declspc as empty for native linux build (0or MSVC)
+#include <stddef.h>
+#ifndef __declspec
+#define __declspec(x)
+#endif
+
+#include <cjson/cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../types/types.h"
+#include "../callbacks/write_callback.h"
+#include "../structured/study_types.h"
+#include "../utils/get_time_ms.h"
+
+#define ITERATIONS 2000
+
+static void append(Memory *mem, const char *text) {
+  write_callback((char *)text, 1, strlen(text), mem);
+}
+
+static Memory make_answer(int item_count) {
+  Memory mem = {malloc(1), 0};
+  mem.response[0] = '\0';
+
+  append(&mem, "[\n");
+  for (int i = 0; i < item_count; i++) {
+    append(&mem, i == 0 ? "  {" : ",\n  {");
+    append(&mem, "\"question\": \"Which layer of the \\\"OSI\\\" model "
+                 "handles routing between networks?\", "
+                 "\"choices\": [\"Data link\", \"Network\", \"Transport\", "
+                 "\"Session \\u00e9\"], \"answer\": 1, "
+                 "\"explanation\": \"Routers read network layer addresses "
+                 "to forward packets hop by hop.\\nThe others don't.\"}");
+  }
+  append(&mem, "\n]\n");
+
+  return mem;
+}
+
+static char *copy_string(cJSON *item, const char *name) {
+  cJSON *value = cJSON_GetObjectItemCaseSensitive(item, name);
+  return cJSON_IsString(value) ? strdup(value->valuestring) : NULL;
+}
+
+// what a caller had to write without structured_decode()
+static QuizQuestion *cjson_decode(Memory *mem, size_t *out_count) {
+  cJSON *root = cJSON_Parse(mem->response);
+  int count = cJSON_GetArraySize(root);
+  QuizQuestion *questions = calloc(count, sizeof(QuizQuestion));
+
+  int i = 0;
+  cJSON *item = NULL;
+  cJSON_ArrayForEach(item, root) {
+    QuizQuestion *q = &questions[i++];
+    q->question = copy_string(item, "question");
+    q->explanation = copy_string(item, "explanation");
+
+    cJSON *answer = cJSON_GetObjectItemCaseSensitive(item, "answer");
+    q->answer = cJSON_IsNumber(answer) ? (long long)answer->valuedouble : 0;
+
+    cJSON *choices = cJSON_GetObjectItemCaseSensitive(item, "choices");
+    int choice_count = cJSON_GetArraySize(choices);
+    q->choices.items = calloc(choice_count, sizeof(char *));
+    cJSON *choice = NULL;
+    cJSON_ArrayForEach(choice, choices) {
+      q->choices.items[q->choices.count++] = strdup(choice->valuestring);
+    }
+  }
+
+  cJSON_Delete(root);
+
+  *out_count = count;
+  return questions;
+}
+
+static void run(int item_count) {
+  Memory mem = make_answer(item_count);
+
+  size_t cjson_count = 0;
+  double start = get_time_ms();
+  for (int i = 0; i < ITERATIONS; i++) {
+    QuizQuestion *questions = cjson_decode(&mem, &cjson_count);
+    structured_free(&QuizQuestion_schema, questions, cjson_count);
+  }
+  double cjson_ms = get_time_ms() - start;
+
+  size_t decode_count = 0;
+  start = get_time_ms();
+  for (int i = 0; i < ITERATIONS; i++) {
+    QuizQuestion *questions = structured_decode(
+        &QuizQuestion_schema, mem.response, mem.size, &decode_count);
+    structured_free(&QuizQuestion_schema, questions, decode_count);
+  }
+  double decode_ms = get_time_ms() - start;
+
+  printf("%4d items %7zu B | cJSON %9.2f us | decode %9.2f us | %.1fx%s\n",
+         item_count, mem.size, cjson_ms * 1000.0 / ITERATIONS,
+         decode_ms * 1000.0 / ITERATIONS, cjson_ms / decode_ms,
+         cjson_count == decode_count ? "" : " (counts differ!)");
+
+  free(mem.response);
+}
+
+int main(void) {
+  run(5);
+  run(20);
+  run(100);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+// write_callback growth: the old exact-fit realloc per chunk against the
+// geometric Memory buffer, feeding bodies in curl sized chunks
+//
+// build: make bench BENCH=bench_write_callback
+
+// define __declspc as empty for native linux build (0or MSVC)
+#include <stddef.h>
+#ifndef __declspec
+#define __declspec(x)
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../callbacks/write_callback.h"
+#include "../types/types.h"
+#include "../utils/get_time_ms.h"
+#include "../utils/memory_buffer.h"
+
+// CURLOPT_BUFFERSIZE of gemini_client_prepare()
+#define CHUNK_SIZE 5000
+#define ITERATIONS 50
+
+static size_t exact_reallocs = 0;
+
+// what write_callback() did before
+static size_t exact_write_callback(char *ptr, size_t size, size_t nmemb,
+                                   void *userdata) {
+  size_t total_bytes = size * nmemb;
+  Memory *mem = (Memory *)userdata;
+
+  char *temp = realloc(mem->response, mem->size + total_bytes + 1);
+  if (!temp)
+    return 0;
+  exact_reallocs++;
+
+  mem->response = temp;
+  memcpy(&(mem->response[mem->size]), ptr, total_bytes);
+  mem->size += total_bytes;
+  mem->response[mem->size] = '\0';
+
+  return total_bytes;
+}
+
+static void run(size_t body_len) {
+  static char chunk[CHUNK_SIZE];
+  memset(chunk, 'x', sizeof(chunk));
+
+  exact_reallocs = 0;
+  double start = get_time_ms();
+  for (int i = 0; i < ITERATIONS; i++) {
+    Memory mem = {malloc(1), 0};
+    for (size_t sent = 0; sent < body_len; sent += CHUNK_SIZE) {
+      exact_write_callback(chunk, 1, CHUNK_SIZE, &mem);
+    }
+    free(mem.response);
+  }
+  double exact_ms = get_time_ms() - start;
+
+  MemoryStats before, after;
+  memory_stats(&before);
+  start = get_time_ms();
+  for (int i = 0; i < ITERATIONS; i++) {
+    Memory mem;
+    memory_init(&mem);
+    for (size_t sent = 0; sent < body_len; sent += CHUNK_SIZE) {
+      write_callback(chunk, 1, CHUNK_SIZE, &mem);
+    }
+    memory_release(&mem);
+  }
+  double buffer_ms = get_time_ms() - start;
+  memory_stats(&after);
+
+  printf("%6zu KiB | exact %8.3f ms %7zu reallocs | geometric %8.3f ms "
+         "%5llu reallocs %3llu pooled\n",
+         body_len / 1024, exact_ms / ITERATIONS, exact_reallocs / ITERATIONS,
+         buffer_ms / ITERATIONS,
+         (after.reallocs - before.reallocs) / ITERATIONS,
+         after.pooled - before.pooled);
+}
+
+int main(void) {
+  run(16 * 1024);
+  run(256 * 1024);
+  run(4 * 1024 * 1024);
+  run(32 * 1024 * 1024);
+
+  MemoryStats stats;
+  memory_stats(&stats);
+  printf("%llu buffers, %llu MiB appended, peak %zu KiB\n", stats.buffers,
+         stats.bytes / (1024 * 1024), stats.peak / 1024);
+
+  // spill: past 1 MiB the body goes to a temp file and is read back
+  // mapped, the heap stops growing there
+  Memory mem;
+  memory_init(&mem);
+  mem.spill_at = 1024 * 1024;
+  static char chunk[CHUNK_SIZE];
+  memset(chunk, 'x', sizeof(chunk));
+  for (size_t sent = 0; sent < 8 * 1024 * 1024; sent += CHUNK_SIZE) {
+    if (write_callback(chunk, 1, CHUNK_SIZE, &mem) != CHUNK_SIZE)
+      break;
+  }
+  const char *body = memory_body(&mem);
+  size_t body_len = memory_body_len(&mem);
+  printf("spill at 1 MiB: %s, %zu B readable (%s), %zu KiB peak in memory\n",
+         memory_spilled(&mem) ? "spilled" : "in memory", body_len,
+         body && body[body_len - 1] == 'x' ? "ok" : "broken",
+         mem.peak / 1024);
+  memory_release(&mem);
+
+  // limit: the same body stops at 1 MiB instead of growing on
+  memory_init(&mem);
+  mem.limit = 1024 * 1024;
+  // a short write is where curl would abort the transfer
+  for (size_t sent = 0; sent < 8 * 1024 * 1024; sent += CHUNK_SIZE) {
+    if (write_callback(chunk, 1, CHUNK_SIZE, &mem) != CHUNK_SIZE)
+      break;
+  }
+  printf("limit of 1 MiB: %s, %zu B written, %zu KiB peak in memory\n",
+         memory_over_limit(&mem) ? "cut off" : "in memory", mem.written,
+         mem.peak / 1024);
+  memory_release(&mem);
+
+  return EXIT_SUCCESS;
+}
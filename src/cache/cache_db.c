@@ -0,0 +1,33 @@
+#include "cache_db.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(dir, mode) _mkdir(dir)
+#else
+#include <sys/stat.h>
+#endif
+
+sqlite3 *cache_db_open(void) {
+  sqlite3 *db = NULL;
+
+  // Ensure db directory exists (ignore error if it already exists)
+  mkdir("db", 0755);
+
+  int rc = sqlite3_open_v2(CACHE_DB_PATH, &db,
+                           SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE |
+                               SQLITE_OPEN_FULLMUTEX,
+                           NULL);
+  if (rc != SQLITE_OK) {
+    fprintf(stderr, "[ERROR] Could not open %s: %s\n", CACHE_DB_PATH,
+            sqlite3_errmsg(db));
+    sqlite3_close(db);
+    return NULL;
+  }
+
+  // WAL keeps lookups from waiting on the refresh thread's writes
+  sqlite3_exec(db, "PRAGMA journal_mode=WAL;", 0, 0, NULL);
+  sqlite3_exec(db, "PRAGMA synchronous=NORMAL;", 0, 0, NULL);
+  sqlite3_busy_timeout(db, 2000);
+
+  return db;
+}
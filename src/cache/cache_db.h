@@ -0,0 +1,15 @@
+#ifndef CACHEDB_H
+#define CACHEDB_H
+
+#include <sqlite3.h>
+#include <stdio.h>
+
+#define CACHE_DB_PATH "db/cache.db"
+
+// opens (and creates) the local cache database, safe to use from the
+// refresh thread and the main loop, NULL on failure. a writer that wraps
+// its statements in a transaction gets a connection of its own, on a
+// shared one whatever the other threads run meanwhile lands inside it
+sqlite3 *cache_db_open(void);
+
+#endif
@@ -0,0 +1,270 @@
+#include "file_cache.h"
+
+FileCache *file_cache_open(sqlite3 *db) {
+  if (!db)
+    return NULL;
+
+  const char *create_table_sql =
+      "CREATE TABLE IF NOT EXISTS file_cache ("
+      "hash TEXT PRIMARY KEY,"
+      "file_uri TEXT NOT NULL,"
+      "name TEXT,"
+      "mime TEXT,"
+      "expires_at INTEGER NOT NULL,"
+      "created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+      ");";
+
+  if (sqlite3_exec(db, create_table_sql, 0, 0, NULL) != SQLITE_OK)
+    return NULL;
+
+  FileCache *cache = calloc(1, sizeof(FileCache));
+  if (!cache)
+    return NULL;
+
+  cache->db = db;
+  pthread_mutex_init(&cache->lock, NULL);
+
+  // prepared once, a lookup is then a single indexed read
+  sqlite3_prepare_v2(db,
+                     "SELECT file_uri, name, expires_at FROM file_cache "
+                     "WHERE hash = ? AND expires_at > ?;",
+                     -1, &cache->lookup_stmt, NULL);
+  sqlite3_prepare_v2(db,
+                     "INSERT OR REPLACE INTO file_cache "
+                     "(hash, file_uri, name, mime, expires_at) "
+                     "VALUES (?, ?, ?, ?, ?);",
+                     -1, &cache->store_stmt, NULL);
+  sqlite3_prepare_v2(db, "DELETE FROM file_cache WHERE hash = ?;", -1,
+                     &cache->remove_stmt, NULL);
+  sqlite3_prepare_v2(db,
+                     "SELECT hash, name, mime FROM file_cache "
+                     "WHERE expires_at < ?;",
+                     -1, &cache->expiring_stmt, NULL);
+
+  if (!cache->lookup_stmt || !cache->store_stmt || !cache->remove_stmt ||
+      !cache->expiring_stmt) {
+    fprintf(stderr, "[ERROR] Could not prepare file cache: %s\n",
+            sqlite3_errmsg(db));
+    file_cache_close(cache);
+    return NULL;
+  }
+
+  return cache;
+}
+
+void file_cache_close(FileCache *cache) {
+  if (!cache)
+    return;
+
+  sqlite3_finalize(cache->lookup_stmt);
+  sqlite3_finalize(cache->store_stmt);
+  sqlite3_finalize(cache->remove_stmt);
+  sqlite3_finalize(cache->expiring_stmt);
+  pthread_mutex_destroy(&cache->lock);
+  free(cache);
+}
+
+int file_cache_lookup(FileCache *cache, const char *hash, GeminiFile *out) {
+  if (!cache)
+    return 0;
+
+  int hit = 0;
+
+  pthread_mutex_lock(&cache->lock);
+
+  sqlite3_stmt *stmt = cache->lookup_stmt;
+  sqlite3_bind_text(stmt, 1, hash, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, (sqlite3_int64)time(NULL) + FILE_CACHE_MIN_TTL);
+
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    const unsigned char *uri = sqlite3_column_text(stmt, 0);
+    const unsigned char *name = sqlite3_column_text(stmt, 1);
+
+    out->uri = strdup((const char *)uri);
+    out->name = name ? strdup((const char *)name) : NULL;
+    out->expires_at = sqlite3_column_int64(stmt, 2);
+    hit = out->uri != NULL;
+  }
+
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  pthread_mutex_unlock(&cache->lock);
+
+  return hit;
+}
+
+void file_cache_store(FileCache *cache, const GeminiFile *file) {
+  if (!cache || !file->uri || file->hash[0] == '\0')
+    return;
+
+  pthread_mutex_lock(&cache->lock);
+
+  sqlite3_stmt *stmt = cache->store_stmt;
+  sqlite3_bind_text(stmt, 1, file->hash, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 2, file->uri, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 3, file->name, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 4, file->mime, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 5, (sqlite3_int64)file->expires_at);
+
+  if (sqlite3_step(stmt) != SQLITE_DONE) {
+    fprintf(stderr, "[ERROR] Could not cache file uri: %s\n",
+            sqlite3_errmsg(cache->db));
+  }
+
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  pthread_mutex_unlock(&cache->lock);
+}
+
+void file_cache_remove(FileCache *cache, const char *hash) {
+  if (!cache)
+    return;
+
+  pthread_mutex_lock(&cache->lock);
+
+  sqlite3_stmt *stmt = cache->remove_stmt;
+  sqlite3_bind_text(stmt, 1, hash, -1, SQLITE_STATIC);
+  sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  pthread_mutex_unlock(&cache->lock);
+}
+
+typedef struct ExpiringEntry {
+  char hash[65];
+  char *name;
+  char *mime;
+} ExpiringEntry;
+
+// copies the rows out so no lock is held during network calls
+static ExpiringEntry *file_cache_expiring(FileCache *cache, size_t *count) {
+  ExpiringEntry *entries = NULL;
+  size_t capacity = 0;
+  *count = 0;
+
+  pthread_mutex_lock(&cache->lock);
+
+  sqlite3_stmt *stmt = cache->expiring_stmt;
+  sqlite3_bind_int64(stmt, 1,
+                     (sqlite3_int64)time(NULL) + FILE_CACHE_REFRESH_MARGIN);
+
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (*count == capacity) {
+      capacity = capacity ? capacity * 2 : 8;
+      ExpiringEntry *grown = realloc(entries, capacity * sizeof(*entries));
+      if (!grown)
+        break;
+      entries = grown;
+    }
+
+    ExpiringEntry *entry = &entries[(*count)++];
+    const unsigned char *name = sqlite3_column_text(stmt, 1);
+    const unsigned char *mime = sqlite3_column_text(stmt, 2);
+
+    snprintf(entry->hash, sizeof(entry->hash), "%s",
+             (const char *)sqlite3_column_text(stmt, 0));
+    entry->name = name ? strdup((const char *)name) : NULL;
+    entry->mime = mime ? strdup((const char *)mime) : NULL;
+  }
+
+  sqlite3_reset(stmt);
+
+  pthread_mutex_unlock(&cache->lock);
+
+  return entries;
+}
+
+static void file_cache_refresh_pass(FileCacheRefresher *refresher,
+                                    CURL *curl) {
+  size_t count = 0;
+  ExpiringEntry *entries = file_cache_expiring(refresher->cache, &count);
+
+  for (size_t i = 0; i < count && refresher->running; i++) {
+    ExpiringEntry *entry = &entries[i];
+
+    if (!entry->name) {
+      file_cache_remove(refresher->cache, entry->hash);
+      continue;
+    }
+
+    GeminiFile file = {0};
+    long status =
+        get_file_metadata(refresher->client, curl, entry->name, &file);
+
+    if (status == 200 &&
+        file.expires_at > (long long)time(NULL) + FILE_CACHE_MIN_TTL) {
+      // still alive, keep the server's view of the expiry
+      snprintf(file.hash, sizeof(file.hash), "%s", entry->hash);
+      file.mime = entry->mime;
+      file_cache_store(refresher->cache, &file);
+    } else if (status == 200) {
+      // too close to expiry to hand out, drop it remotely as well
+      delete_file(refresher->client, curl, entry->name);
+      file_cache_remove(refresher->cache, entry->hash);
+    } else if (status == 403 || status == 404) {
+      file_cache_remove(refresher->cache, entry->hash);
+    }
+    // anything else is a network problem, try again next pass
+
+    gemini_file_free(&file);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    free(entries[i].name);
+    free(entries[i].mime);
+  }
+  free(entries);
+}
+
+static void *file_cache_refresh_thread(void *arg) {
+  FileCacheRefresher *refresher = (FileCacheRefresher *)arg;
+
+  // the clone's handles are this thread's alone
+  CURL *curl = refresher->client->file_handle;
+
+  while (refresher->running) {
+    file_cache_refresh_pass(refresher, curl);
+
+    for (int i = 0; i < FILE_CACHE_REFRESH_INTERVAL && refresher->running;
+         i++) {
+      delay(1000);
+    }
+  }
+
+  return NULL;
+}
+
+int file_cache_refresh_start(FileCacheRefresher *refresher, FileCache *cache,
+                             GeminiClient *client) {
+  if (!cache || !client)
+    return -1;
+
+  refresher->cache = cache;
+  refresher->client = gemini_client_clone(client);
+  if (!refresher->client)
+    return -1;
+  refresher->running = true;
+
+  if (pthread_create(&refresher->thread, NULL, file_cache_refresh_thread,
+                     refresher) != 0) {
+    refresher->running = false;
+    gemini_client_destroy(refresher->client);
+    refresher->client = NULL;
+    return -1;
+  }
+
+  return 0;
+}
+
+void file_cache_refresh_stop(FileCacheRefresher *refresher) {
+  if (!refresher->running)
+    return;
+
+  refresher->running = false;
+  pthread_join(refresher->thread, NULL);
+  gemini_client_destroy(refresher->client);
+  refresher->client = NULL;
+}
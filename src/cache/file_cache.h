@@ -0,0 +1,56 @@
+#ifndef FILECACHE_H
+#define FILECACHE_H
+
+#include <pthread.h>
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../gemini_api/file_metadata.h"
+#include "../gemini_api/gemini_client.h"
+#include "../types/types.h"
+#include "../utils/delay.h"
+
+// a cached uri is only handed out if it stays valid this much longer
+#define FILE_CACHE_MIN_TTL (10 * 60)
+// the refresher re-validates entries expiring within this window
+#define FILE_CACHE_REFRESH_MARGIN (60 * 60)
+#define FILE_CACHE_REFRESH_INTERVAL (5 * 60)
+
+// sha256 of a local file -> File API upload, so re-attaching the same
+// document skips both upload requests
+typedef struct FileCache {
+  sqlite3 *db;
+  sqlite3_stmt *lookup_stmt;
+  sqlite3_stmt *store_stmt;
+  sqlite3_stmt *remove_stmt;
+  sqlite3_stmt *expiring_stmt;
+  pthread_mutex_t lock;
+} FileCache;
+
+typedef struct FileCacheRefresher {
+  pthread_t thread;
+  volatile bool running;
+  FileCache *cache;
+  GeminiClient *client; // a clone of the one it was started with
+} FileCacheRefresher;
+
+FileCache *file_cache_open(sqlite3 *db);
+void file_cache_close(FileCache *cache);
+
+// 1 and out->uri/name/expires_at filled on a hit, 0 on a miss
+int file_cache_lookup(FileCache *cache, const char *hash, GeminiFile *out);
+void file_cache_store(FileCache *cache, const GeminiFile *file);
+void file_cache_remove(FileCache *cache, const char *hash);
+
+// background thread re-validating entries close to expiry and deleting
+// remote files that are about to go stale. it asks through a clone of
+// client, stopped before client is destroyed
+int file_cache_refresh_start(FileCacheRefresher *refresher, FileCache *cache,
+                             GeminiClient *client);
+void file_cache_refresh_stop(FileCacheRefresher *refresher);
+
+#endif
@@ -0,0 +1,246 @@
+#include "response_cache.h"
+
+ResponseCache *response_cache_open(sqlite3 *db, long long ttl,
+                                   long long max_bytes) {
+  if (!db)
+    return NULL;
+
+  const char *create_table_sql =
+      "CREATE TABLE IF NOT EXISTS response_cache ("
+      "key TEXT PRIMARY KEY,"
+      "response TEXT NOT NULL,"
+      "bytes INTEGER NOT NULL,"
+      "created_at INTEGER NOT NULL,"
+      "last_used INTEGER NOT NULL"
+      ");"
+      "CREATE INDEX IF NOT EXISTS response_cache_last_used "
+      "ON response_cache (last_used);";
+
+  if (sqlite3_exec(db, create_table_sql, 0, 0, NULL) != SQLITE_OK)
+    return NULL;
+
+  ResponseCache *cache = calloc(1, sizeof(ResponseCache));
+  if (!cache)
+    return NULL;
+
+  cache->db = db;
+  cache->ttl = ttl;
+  cache->max_bytes = max_bytes;
+  pthread_mutex_init(&cache->lock, NULL);
+
+  sqlite3_prepare_v2(db,
+                     "SELECT response, created_at FROM response_cache "
+                     "WHERE key = ?;",
+                     -1, &cache->get_stmt, NULL);
+  sqlite3_prepare_v2(db,
+                     "UPDATE response_cache SET last_used = ? WHERE key = ?;",
+                     -1, &cache->touch_stmt, NULL);
+  sqlite3_prepare_v2(db,
+                     "INSERT OR REPLACE INTO response_cache "
+                     "(key, response, bytes, created_at, last_used) "
+                     "VALUES (?, ?, ?, ?, ?);",
+                     -1, &cache->put_stmt, NULL);
+  sqlite3_prepare_v2(db,
+                     "SELECT key, bytes FROM response_cache WHERE key != ? "
+                     "ORDER BY last_used ASC LIMIT 16;",
+                     -1, &cache->oldest_stmt, NULL);
+  sqlite3_prepare_v2(db, "DELETE FROM response_cache WHERE key = ?;", -1,
+                     &cache->evict_stmt, NULL);
+
+  if (!cache->get_stmt || !cache->touch_stmt || !cache->put_stmt ||
+      !cache->oldest_stmt || !cache->evict_stmt) {
+    fprintf(stderr, "[ERROR] Could not prepare response cache: %s\n",
+            sqlite3_errmsg(db));
+    response_cache_close(cache);
+    return NULL;
+  }
+
+  sqlite3_stmt *sum_stmt = NULL;
+  if (sqlite3_prepare_v2(db, "SELECT TOTAL(bytes) FROM response_cache;", -1,
+                         &sum_stmt, NULL) == SQLITE_OK &&
+      sqlite3_step(sum_stmt) == SQLITE_ROW) {
+    cache->total_bytes = (long long)sqlite3_column_double(sum_stmt, 0);
+  }
+  sqlite3_finalize(sum_stmt);
+
+  return cache;
+}
+
+void response_cache_close(ResponseCache *cache) {
+  if (!cache)
+    return;
+
+  sqlite3_finalize(cache->get_stmt);
+  sqlite3_finalize(cache->touch_stmt);
+  sqlite3_finalize(cache->put_stmt);
+  sqlite3_finalize(cache->oldest_stmt);
+  sqlite3_finalize(cache->evict_stmt);
+  pthread_mutex_destroy(&cache->lock);
+  free(cache);
+}
+
+static int compare_hashes(const void *a, const void *b) {
+  return strcmp(*(const char **)a, *(const char **)b);
+}
+
+void response_cache_key(const char *prompt, const GeminiFile *files,
+                        size_t file_count, const char *model_url,
+                        char out_key[65]) {
+  Sha256 ctx;
+  sha256_init(&ctx);
+
+  // "What is  SUCCESS?" and "what is success?" share one entry
+  bool pending_space = false;
+  bool started = false;
+  for (const char *c = prompt; *c; c++) {
+    if (isspace((unsigned char)*c)) {
+      pending_space = started;
+      continue;
+    }
+
+    if (pending_space)
+      sha256_update(&ctx, " ", 1);
+    pending_space = false;
+    started = true;
+
+    char lower = (char)tolower((unsigned char)*c);
+    sha256_update(&ctx, &lower, 1);
+  }
+  sha256_update(&ctx, "\n", 1);
+
+  // the same attachments picked in another order are the same question
+  const char **hashes = malloc(file_count * sizeof(char *) + 1);
+  if (hashes) {
+    for (size_t i = 0; i < file_count; i++) {
+      hashes[i] = files[i].hash;
+    }
+    qsort(hashes, file_count, sizeof(char *), compare_hashes);
+
+    for (size_t i = 0; i < file_count; i++) {
+      sha256_update(&ctx, hashes[i], strlen(hashes[i]));
+      sha256_update(&ctx, "\n", 1);
+    }
+    free(hashes);
+  }
+
+  if (model_url)
+    sha256_update(&ctx, model_url, strlen(model_url));
+
+  sha256_final_hex(&ctx, out_key);
+}
+
+char *response_cache_get(ResponseCache *cache, const char *key,
+                         bool allow_stale) {
+  if (!cache)
+    return NULL;
+
+  char *response = NULL;
+  long long now = (long long)time(NULL);
+
+  pthread_mutex_lock(&cache->lock);
+
+  sqlite3_stmt *stmt = cache->get_stmt;
+  sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    long long created_at = sqlite3_column_int64(stmt, 1);
+
+    if (allow_stale || now - created_at < cache->ttl) {
+      response = strdup((const char *)sqlite3_column_text(stmt, 0));
+    }
+  }
+
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  if (response) {
+    sqlite3_bind_int64(cache->touch_stmt, 1, (sqlite3_int64)now);
+    sqlite3_bind_text(cache->touch_stmt, 2, key, -1, SQLITE_STATIC);
+    sqlite3_step(cache->touch_stmt);
+    sqlite3_reset(cache->touch_stmt);
+    sqlite3_clear_bindings(cache->touch_stmt);
+  }
+
+  pthread_mutex_unlock(&cache->lock);
+
+  return response;
+}
+
+// drops least recently used answers until the cache fits max_bytes. keep
+// is the answer just put, its last_used can tie with older ones
+static void response_cache_evict(ResponseCache *cache, const char *keep,
+                                 long long keep_bytes) {
+  while (cache->total_bytes > cache->max_bytes) {
+    char keys[16][65];
+    long long sizes[16];
+    int found = 0;
+
+    sqlite3_bind_text(cache->oldest_stmt, 1, keep, -1, SQLITE_STATIC);
+    while (found < 16 && sqlite3_step(cache->oldest_stmt) == SQLITE_ROW) {
+      snprintf(keys[found], sizeof(keys[found]), "%s",
+               (const char *)sqlite3_column_text(cache->oldest_stmt, 0));
+      sizes[found] = sqlite3_column_int64(cache->oldest_stmt, 1);
+      found++;
+    }
+    sqlite3_reset(cache->oldest_stmt);
+    sqlite3_clear_bindings(cache->oldest_stmt);
+
+    if (found == 0) {
+      cache->total_bytes = keep_bytes;
+      return;
+    }
+
+    for (int i = 0; i < found && cache->total_bytes > cache->max_bytes; i++) {
+      sqlite3_bind_text(cache->evict_stmt, 1, keys[i], -1, SQLITE_STATIC);
+      sqlite3_step(cache->evict_stmt);
+      sqlite3_reset(cache->evict_stmt);
+      sqlite3_clear_bindings(cache->evict_stmt);
+
+      cache->total_bytes -= sizes[i];
+    }
+  }
+}
+
+void response_cache_put(ResponseCache *cache, const char *key,
+                        const char *response) {
+  if (!cache || !response || cache->ttl <= 0)
+    return;
+
+  long long bytes = (long long)strlen(response);
+  if (bytes > cache->max_bytes)
+    return;
+
+  long long now = (long long)time(NULL);
+
+  pthread_mutex_lock(&cache->lock);
+
+  // read and write in one go, a deferred BEGIN could find another
+  // connection's write in between and fail the upgrade without waiting
+  sqlite3_exec(cache->db, "BEGIN IMMEDIATE;", 0, 0, NULL);
+
+  // a replaced entry gives its bytes back first
+  sqlite3_bind_text(cache->get_stmt, 1, key, -1, SQLITE_STATIC);
+  if (sqlite3_step(cache->get_stmt) == SQLITE_ROW)
+    cache->total_bytes -= sqlite3_column_bytes(cache->get_stmt, 0);
+  sqlite3_reset(cache->get_stmt);
+  sqlite3_clear_bindings(cache->get_stmt);
+
+  sqlite3_stmt *stmt = cache->put_stmt;
+  sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 2, response, (int)bytes, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 3, (sqlite3_int64)bytes);
+  sqlite3_bind_int64(stmt, 4, (sqlite3_int64)now);
+  sqlite3_bind_int64(stmt, 5, (sqlite3_int64)now);
+
+  if (sqlite3_step(stmt) == SQLITE_DONE) {
+    cache->total_bytes += bytes;
+    response_cache_evict(cache, key, bytes);
+  }
+
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  sqlite3_exec(cache->db, "COMMIT;", 0, 0, NULL);
+
+  pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,51 @@
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <ctype.h>
+#include <pthread.h>
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../types/types.h"
+#include "../utils/sha256.h"
+
+#define RESPONSE_CACHE_DEFAULT_TTL (24 * 60 * 60)
+#define RESPONSE_CACHE_DEFAULT_MAX_BYTES (8 * 1024 * 1024)
+
+// answers keyed on prompt + attachments + model, bounded by total size
+typedef struct ResponseCache {
+  sqlite3 *db;
+  sqlite3_stmt *get_stmt;
+  sqlite3_stmt *touch_stmt;
+  sqlite3_stmt *put_stmt;
+  sqlite3_stmt *oldest_stmt;
+  sqlite3_stmt *evict_stmt;
+  long long ttl;       // seconds an answer counts as fresh
+  long long max_bytes; // least recently used answers go past this
+  long long total_bytes;
+  pthread_mutex_t lock;
+} ResponseCache;
+
+// puts run in a transaction, so db is a connection of its own (see
+// cache_db_open()), closed by the caller after response_cache_close()
+ResponseCache *response_cache_open(sqlite3 *db, long long ttl,
+                                   long long max_bytes);
+void response_cache_close(ResponseCache *cache);
+
+// sha256 over the normalized prompt (lowercased, whitespace collapsed), the
+// sorted hashes of the attached files and the model url
+void response_cache_key(const char *prompt, const GeminiFile *files,
+                        size_t file_count, const char *model_url,
+                        char out_key[65]);
+
+// cached answer or NULL, allow_stale ignores the ttl (offline fallback)
+char *response_cache_get(ResponseCache *cache, const char *key,
+                         bool allow_stale);
+void response_cache_put(ResponseCache *cache, const char *key,
+                        const char *response);
+
+#endif
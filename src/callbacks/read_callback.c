@@ -0,0 +1,35 @@
+#include "read_callback.h"
+
+size_t read_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
+  FileUpload *upload = (FileUpload *)userdata;
+  size_t wanted = size * nitems;
+
+  if ((long long)wanted > upload->remaining)
+    wanted = (size_t)upload->remaining;
+
+  if (wanted == 0)
+    return 0;
+
+  size_t read_len = fread(buffer, 1, wanted, upload->fptr);
+  if (read_len == 0 && ferror(upload->fptr)) {
+    fprintf(stderr, "[ERROR] Failed to read upload chunk.\n");
+    return CURL_READFUNC_ABORT;
+  }
+
+  upload->remaining -= read_len;
+  return read_len;
+}
+
+int seek_callback(void *userdata, curl_off_t offset, int origin) {
+  FileUpload *upload = (FileUpload *)userdata;
+
+  // offsets are relative to the start of the chunk body
+  if (origin != SEEK_SET || offset > upload->chunk_len)
+    return CURL_SEEKFUNC_CANTSEEK;
+
+  if (file_seek(upload->fptr, upload->offset + offset) != 0)
+    return CURL_SEEKFUNC_FAIL;
+
+  upload->remaining = upload->chunk_len - offset;
+  return CURL_SEEKFUNC_OK;
+}
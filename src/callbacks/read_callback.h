@@ -0,0 +1,18 @@
+#ifndef READCALLBACK_H
+#define READCALLBACK_H
+
+#include <curl/curl.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "../types/types.h"
+#include "../utils/file_offset.h"
+
+// CURLOPT_READFUNCTION feeding the current chunk of a FileUpload straight
+// from the file into libcurl's upload buffer, userdata is the FileUpload
+size_t read_callback(char *buffer, size_t size, size_t nitems, void *userdata);
+
+// CURLOPT_SEEKFUNCTION so libcurl can rewind the chunk (e.g. on redirects)
+int seek_callback(void *userdata, curl_off_t offset, int origin);
+
+#endif
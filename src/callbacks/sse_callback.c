@@ -0,0 +1,127 @@
+#include "sse_callback.h"
+
+static const char *escaped_esc = "\\033";
+
+static void sse_print(SseStream *stream, char *text) {
+  if (*text == '\0')
+    return;
+
+  if (stream->chunks++ == 0 && stream->on_first_chunk)
+    stream->on_first_chunk(stream->on_first_chunk_arg);
+
+  fputs(text, stdout);
+  fflush(stdout);
+
+  write_callback(text, 1, strlen(text), &stream->text);
+}
+
+static void sse_emit(SseStream *stream, const char *text) {
+  size_t text_len = strlen(text);
+  size_t len = stream->pending_len + text_len;
+  char *combined = malloc(len + 1);
+  if (!combined)
+    return;
+
+  memcpy(combined, stream->pending, stream->pending_len);
+  memcpy(combined + stream->pending_len, text, text_len);
+  combined[len] = '\0';
+
+  // "\033" can be cut between two events, hold back any tail that could
+  // still become one so replace_escaped_ansi sees it whole next time
+  size_t hold = 0;
+  for (size_t k = 3; k > 0; k--) {
+    if (len >= k && strncmp(combined + len - k, escaped_esc, k) == 0) {
+      hold = k;
+      break;
+    }
+  }
+
+  memcpy(stream->pending, combined + len - hold, hold);
+  stream->pending_len = hold;
+  combined[len - hold] = '\0';
+
+  char *cleaned = replace_escaped_ansi(combined);
+  if (cleaned) {
+    sse_print(stream, cleaned);
+    free(cleaned);
+  }
+
+  free(combined);
+}
+
+static void sse_dispatch_event(SseStream *stream) {
+  if (stream->event.size == 0)
+    return;
+
+  char *text = json_concat_text(stream->event.response, stream->event.size,
+                                "candidates[0].content.parts");
+  if (text) {
+    sse_emit(stream, text);
+    free(text);
+  }
+
+  // kept whole, token_usage_parse() finds the counts in it later
+  if (strstr(stream->event.response, "\"usageMetadata\"")) {
+    memory_clear(&stream->usage);
+    memory_append(&stream->usage, stream->event.response, stream->event.size);
+  }
+
+  memory_clear(&stream->event);
+}
+
+size_t sse_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
+  size_t total_bytes = size * nmemb;
+  SseStream *stream = (SseStream *)userdata;
+
+  if (write_callback(ptr, size, nmemb, &stream->line) != total_bytes)
+    return 0;
+
+  char *line_start = stream->line.response;
+  char *end = line_start + stream->line.size;
+  char *new_line;
+
+  while ((new_line = memchr(line_start, '\n', end - line_start)) != NULL) {
+    size_t line_len = new_line - line_start;
+    if (line_len > 0 && line_start[line_len - 1] == '\r')
+      line_len--;
+
+    if (line_len == 0) {
+      // a blank line terminates the event
+      sse_dispatch_event(stream);
+    } else if (line_len >= 5 && strncmp(line_start, "data:", 5) == 0) {
+      char *data = line_start + 5;
+      size_t data_len = line_len - 5;
+      if (data_len > 0 && *data == ' ') {
+        data++;
+        data_len--;
+      }
+
+      if (stream->event.size > 0)
+        write_callback("\n", 1, 1, &stream->event);
+      write_callback(data, 1, data_len, &stream->event);
+    }
+
+    line_start = new_line + 1;
+  }
+
+  // keep the unfinished line for the next chunk
+  size_t left = end - line_start;
+  memmove(stream->line.response, line_start, left);
+  stream->line.size = left;
+  stream->line.response[left] = '\0';
+
+  return total_bytes;
+}
+
+void sse_stream_finish(SseStream *stream) {
+  // some servers close without the final blank line
+  sse_dispatch_event(stream);
+
+  if (stream->pending_len > 0) {
+    char tail[4];
+    memcpy(tail, stream->pending, stream->pending_len);
+    tail[stream->pending_len] = '\0';
+    stream->pending_len = 0;
+    sse_print(stream, tail);
+  }
+}
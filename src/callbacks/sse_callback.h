@@ -0,0 +1,21 @@
+#ifndef SSECALLBACK_H
+#define SSECALLBACK_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../types/types.h"
+#include "../utils/json_extract.h"
+#include "../utils/replace_escaped_ansii.h"
+#include "write_callback.h"
+
+// CURLOPT_WRITEFUNCTION for server-sent events, prints every text part of
+// each "data:" event as soon as it arrives, userdata is an SseStream
+size_t sse_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+// prints whatever was held back waiting for the rest of an escape sequence
+void sse_stream_finish(SseStream *stream);
+
+#endif
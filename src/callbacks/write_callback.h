@@ -6,6 +6,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "../types/types.h"
+#include "../utils/memory_buffer.h"
+
 size_t write_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
 
 #endif
@@ -0,0 +1,119 @@
+#include "attachment_plan.h"
+
+typedef struct Candidate {
+  size_t index;
+  long long size;
+} Candidate;
+
+static int candidate_compare(const void *a, const void *b) {
+  const Candidate *x = (const Candidate *)a;
+  const Candidate *y = (const Candidate *)b;
+
+  if (x->size != y->size)
+    return x->size < y->size ? -1 : 1;
+  return x->index < y->index ? -1 : x->index > y->index;
+}
+
+static long long path_size(const char *path) {
+  FILE *fptr = fopen(path, "rb");
+  if (!fptr)
+    return -1;
+
+  long long size = file_size(fptr);
+  fclose(fptr);
+
+  return size;
+}
+
+// whole file as base64, NULL if it changed size or can't be read
+static char *encode_file(const char *path, long long size, size_t *out_len) {
+  FILE *fptr = fopen(path, "rb");
+  if (!fptr)
+    return NULL;
+
+  unsigned char *data = malloc(size > 0 ? (size_t)size : 1);
+  size_t read_len = data ? fread(data, 1, (size_t)size, fptr) : 0;
+  fclose(fptr);
+
+  char *encoded = NULL;
+  if (data && read_len == (size_t)size)
+    encoded = base64_encode(data, read_len, out_len);
+
+  free(data);
+
+  return encoded;
+}
+
+int attachment_plan_build(AttachmentPlan *plan, const char **paths,
+                          size_t count, size_t inline_max, size_t body_budget) {
+  memset(plan, 0, sizeof(*plan));
+  if (count == 0)
+    return 0;
+
+  Candidate *candidates = malloc(count * sizeof(Candidate));
+  bool *inlined = calloc(count, sizeof(bool));
+  plan->inline_parts = calloc(count, sizeof(InlinePart));
+  plan->upload_index = malloc(count * sizeof(size_t));
+  if (!candidates || !inlined || !plan->inline_parts || !plan->upload_index) {
+    free(candidates);
+    free(inlined);
+    attachment_plan_free(plan);
+    return -1;
+  }
+
+  size_t candidate_count = 0;
+  for (size_t i = 0; i < count && inline_max > 0; i++) {
+    if (!get_file_mime_type(paths[i]))
+      continue;
+
+    long long size = path_size(paths[i]);
+    if (size < 0 || (unsigned long long)size > inline_max)
+      continue;
+
+    candidates[candidate_count].index = i;
+    candidates[candidate_count].size = size;
+    candidate_count++;
+  }
+
+  // smallest first keeps the most files out of the upload round trips
+  qsort(candidates, candidate_count, sizeof(Candidate), candidate_compare);
+
+  for (size_t i = 0; i < candidate_count; i++) {
+    size_t cost = BASE64_ENCODED_LEN((size_t)candidates[i].size) +
+                  ATTACHMENT_PART_OVERHEAD;
+    // the rest are bigger still
+    if (plan->inline_bytes + cost > body_budget)
+      break;
+
+    const char *path = paths[candidates[i].index];
+    InlinePart *part = &plan->inline_parts[plan->inline_count];
+    part->data = encode_file(path, candidates[i].size, &part->data_len);
+    if (!part->data)
+      continue;
+
+    part->mime = get_file_mime_type(path);
+    plan->inline_count++;
+    plan->inline_bytes += cost;
+    inlined[candidates[i].index] = true;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (!inlined[i])
+      plan->upload_index[plan->upload_count++] = i;
+  }
+
+  free(candidates);
+  free(inlined);
+
+  return 0;
+}
+
+void attachment_plan_free(AttachmentPlan *plan) {
+  for (size_t i = 0; plan->inline_parts && i < plan->inline_count; i++) {
+    free(plan->inline_parts[i].data);
+  }
+
+  free(plan->inline_parts);
+  free(plan->upload_index);
+  memset(plan, 0, sizeof(*plan));
+}
@@ -0,0 +1,43 @@
+#ifndef ATTACHMENTPLAN_H
+#define ATTACHMENTPLAN_H
+
+#include "../types/types.h"
+#include "../utils/base64.h"
+#include "../utils/file_offset.h"
+#include "../utils/get_file_mime_type.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// files up to this size go inline by default. a screenshot or a short pdf
+// is then one generate call instead of an upload start, the bytes and the
+// generate call
+#define ATTACHMENT_DEFAULT_INLINE_BYTES (1024 * 1024)
+// generateContent refuses bodies past 20 MB, inline data included
+#define ATTACHMENT_DEFAULT_REQUEST_LIMIT (20 * 1000 * 1000)
+// {"inline_data": {"mime_type": ..., "data": ""}} around each part
+#define ATTACHMENT_PART_OVERHEAD 64
+
+// which of a prompt's attachments ride in the body and which go through
+// the File API
+typedef struct AttachmentPlan {
+  InlinePart *inline_parts; // base64, smallest file first
+  size_t inline_count;
+  size_t inline_bytes; // what they add to the body
+
+  size_t *upload_index; // ascending positions in paths
+  size_t upload_count;
+} AttachmentPlan;
+
+// reads every file no bigger than inline_max and encodes it, smallest first,
+// while the parts together stay within body_budget bytes. the others (and
+// any that can't be read or have no known mime type, so the upload reports
+// them) are left to upload. inline_max 0 uploads everything. returns -1 when
+// out of memory, the plan is empty then
+int attachment_plan_build(AttachmentPlan *plan, const char **paths,
+                          size_t count, size_t inline_max, size_t body_budget);
+void attachment_plan_free(AttachmentPlan *plan);
+
+#endif
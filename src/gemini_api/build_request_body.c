@@ -0,0 +1,125 @@
+#include "build_request_body.h"
+
+// {"role": "user", "parts": [<inline>, <files>, {"text": <prefix><prompt>}]}
+static void write_user_turn(JsonWriter *w, GeminiClient *client,
+                            const char *prefix_json, size_t prefix_json_len,
+                            char **file_uris, char *prompt,
+                            char **file_mime_types, int file_count) {
+  json_begin_object(w);
+  json_key(w, "role");
+  json_string(w, "user");
+  json_key(w, "parts");
+  json_begin_array(w);
+
+  // base64 needs no escaping, it goes in as it is. the escaping append
+  // would reserve six times its size in a buffer that never shrinks
+  for (size_t i = 0; i < client->inline_count; i++) {
+    json_begin_object(w);
+    json_key(w, "inline_data");
+    json_begin_object(w);
+    json_key(w, "mime_type");
+    json_string(w, client->inline_parts[i].mime);
+    json_key(w, "data");
+    json_string_begin(w);
+    json_string_append_escaped(w, client->inline_parts[i].data,
+                               client->inline_parts[i].data_len);
+    json_string_end(w);
+    json_end_object(w);
+    json_end_object(w);
+  }
+
+  for (size_t i = 0; i < file_count; i++) {
+    json_begin_object(w);
+    json_key(w, "file_data");
+    json_begin_object(w);
+    json_key(w, "mime_type");
+    json_string(w, file_mime_types[i]);
+    json_key(w, "file_uri");
+    json_string(w, file_uris[i]);
+    json_end_object(w);
+    json_end_object(w);
+  }
+
+  json_begin_object(w);
+  json_key(w, "text");
+  json_string_begin(w);
+  if (prefix_json)
+    json_string_append_escaped(w, prefix_json, prefix_json_len);
+  json_string_append(w, prompt, strlen(prompt));
+  json_string_end(w);
+  json_end_object(w);
+
+  json_end_array(w);
+  json_end_object(w);
+}
+
+void write_request_contents(JsonWriter *w, GeminiClient *client,
+                            char **file_uris, char *prompt,
+                            char **file_mime_types, int file_count) {
+  json_key(w, "contents");
+  json_begin_array(w);
+  write_user_turn(w, client, client->prompt_prefix_json,
+                  client->prompt_prefix_json_len, file_uris, prompt,
+                  file_mime_types, file_count);
+  json_end_array(w);
+}
+
+static void write_system_instruction(JsonWriter *w, GeminiClient *client) {
+  json_key(w, "systemInstruction");
+  json_begin_object(w);
+  json_key(w, "parts");
+  json_begin_array(w);
+  json_begin_object(w);
+  json_key(w, "text");
+  json_string_begin(w);
+  json_string_append_escaped(w, client->system_prompt_json,
+                             client->system_prompt_json_len);
+  json_string_end(w);
+  json_end_object(w);
+  json_end_array(w);
+  json_end_object(w);
+}
+
+const char *build_request_body(GeminiClient *client, char **file_uris,
+                               char *prompt, char **file_mime_types,
+                               int file_count, const char *cached_content,
+                               size_t *out_len) {
+  JsonWriter *w = &client->body;
+  Conversation *conversation = client->conversation;
+  json_writer_reset(w);
+
+  json_begin_object(w);
+
+  if (!conversation && !cached_content) {
+    // single turn, the system prompt rides in front of the question
+    write_request_contents(w, client, file_uris, prompt, file_mime_types,
+                           file_count);
+  } else {
+    // the cache already holds the system prompt and the files
+    if (cached_content) {
+      json_key(w, "cachedContent");
+      json_string(w, cached_content);
+    } else if (client->system_prompt_json) {
+      write_system_instruction(w, client);
+    }
+
+    json_key(w, "contents");
+    json_begin_array(w);
+    if (conversation)
+      conversation_write_turns(conversation, w);
+    write_user_turn(w, client, NULL, 0, file_uris, prompt, file_mime_types,
+                    cached_content ? 0 : file_count);
+    json_end_array(w);
+  }
+
+  if (client->response_type)
+    structured_write_config(w, client->response_type);
+
+  json_end_object(w);
+
+  if (w->failed)
+    return NULL;
+
+  *out_len = w->len;
+  return w->data;
+}
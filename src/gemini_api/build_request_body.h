@@ -0,0 +1,29 @@
+#ifndef BUILDREQUESTBODY_H
+#define BUILDREQUESTBODY_H
+
+#include <stdlib.h>
+
+#include "../structured/structured_output.h"
+#include "../utils/json_writer.h"
+#include "conversation.h"
+#include "gemini_client.h"
+
+// "contents": [...] of one generateContent request into w, the system
+// prompt prefix goes in front of prompt. an object must be open in w
+void write_request_contents(JsonWriter *w, GeminiClient *client,
+                            char **file_uris, char *prompt,
+                            char **file_mime_types, int file_count);
+
+// generateContent body shared by the blocking and streaming requests,
+// written into client->body and only valid until the next call. the
+// client's conversation (if set) goes in front of the prompt as earlier
+// turns, with the system prompt as systemInstruction. with cached_content
+// (a cachedContents name holding the system prompt and these files) the
+// files are not sent again. the client's inline parts always are, and its
+// response_type asks for JSON in that schema
+const char *build_request_body(GeminiClient *client, char **file_uris,
+                               char *prompt, char **file_mime_types,
+                               int file_count, const char *cached_content,
+                               size_t *out_len);
+
+#endif
@@ -0,0 +1,150 @@
+#include "connection_warmup.h"
+
+// "https://host:port/path?q" -> "https://host:port/", -1 without a host
+static int host_root(const char *url, char *out, size_t size) {
+  const char *scheme_end = strstr(url, "://");
+  if (!scheme_end)
+    return -1;
+
+  const char *path = strchr(scheme_end + 3, '/');
+  size_t len = path ? (size_t)(path - url) : strlen(url);
+  if (len + 2 > size)
+    return -1;
+
+  snprintf(out, size, "%.*s/", (int)len, url);
+
+  return 0;
+}
+
+static void add_host(ConnectionWarmup *warmup, const char *url) {
+  char root[sizeof(warmup->hosts[0])];
+  if (!url || host_root(url, root, sizeof(root)) != 0)
+    return;
+
+  for (int i = 0; i < warmup->host_count; i++) {
+    if (strcmp(warmup->hosts[i], root) == 0)
+      return;
+  }
+
+  if (warmup->host_count < CONNECTION_WARMUP_MAX_HOSTS)
+    memcpy(warmup->hosts[warmup->host_count++], root, sizeof(root));
+}
+
+// a HEAD on a host root. the answer (usually a 404) doesn't matter, the
+// connection it leaves in curl and the DNS entry and TLS session it leaves
+// in the share do. resolve looks the name up again on a new connection,
+// replacing the pinned entry before it goes stale
+static void warm_host(ConnectionWarmup *warmup, CURL *curl, const char *root,
+                      bool resolve) {
+  gemini_client_prepare(warmup->client, curl);
+
+  curl_easy_setopt(curl, CURLOPT_URL, root);
+  curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+  if (resolve) {
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 0L);
+    curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+  }
+
+  CURLcode result = curl_easy_perform(curl);
+  net_telemetry_record(warmup->client->policy->telemetry, "warmup", curl,
+                       result);
+}
+
+static void warm_round(ConnectionWarmup *warmup, CURL *curl, bool resolve) {
+  for (int i = 0; i < warmup->host_count && warmup->running; i++) {
+    warm_host(warmup, curl, warmup->hosts[i], resolve);
+  }
+}
+
+// connections aren't shared between handles, so the client's own handles
+// connect to the host they talk to. nothing else uses them until
+// connection_warmup_wait() returns
+static void warm_client(ConnectionWarmup *warmup) {
+  GeminiClient *client = warmup->client;
+  char root[sizeof(warmup->hosts[0])];
+
+  if (host_root(client->api_url, root, sizeof(root)) == 0 && warmup->running)
+    warm_host(warmup, client->api_handle, root, false);
+
+  if (host_root(client->file_url, root, sizeof(root)) == 0) {
+    if (warmup->running)
+      warm_host(warmup, client->upload_handle, root, false);
+    if (warmup->running)
+      warm_host(warmup, client->file_handle, root, false);
+  }
+}
+
+static void *connection_warmup_thread(void *arg) {
+  ConnectionWarmup *warmup = (ConnectionWarmup *)arg;
+
+  double start = get_time_ms();
+  warm_client(warmup);
+  warmup->first_round_ms = get_time_ms() - start;
+  warmup->warmed = true;
+
+  // own handle from here on, the client's handles belong to the main loop
+  CURL *curl = curl_easy_init();
+  if (!curl)
+    return NULL;
+
+  // pins are refreshed at three quarters of their life, so no request
+  // ever waits for a lookup
+  long pin_s = warmup->client->dns_pin_s;
+  long interval_s = CONNECTION_WARMUP_KEEPALIVE_S;
+  if (pin_s > 0 && pin_s * 3 / 4 < interval_s)
+    interval_s = pin_s * 3 / 4 > 0 ? pin_s * 3 / 4 : 1;
+  double resolved_at = start;
+
+  while (warmup->running) {
+    for (long i = 0; i < interval_s && warmup->running; i++) {
+      delay(1000);
+    }
+    if (!warmup->running)
+      break;
+
+    bool resolve = pin_s > 0 && get_time_ms() - resolved_at >= pin_s * 750.0;
+    warm_round(warmup, curl, resolve);
+    if (resolve)
+      resolved_at = get_time_ms();
+  }
+
+  curl_easy_cleanup(curl);
+
+  return NULL;
+}
+
+int connection_warmup_start(ConnectionWarmup *warmup, GeminiClient *client) {
+  if (!client || !client->transport->network)
+    return -1;
+
+  warmup->client = client;
+  warmup->host_count = 0;
+  add_host(warmup, client->api_url);
+  add_host(warmup, client->file_url);
+  if (warmup->host_count == 0)
+    return -1;
+
+  warmup->running = true;
+  if (pthread_create(&warmup->thread, NULL, connection_warmup_thread,
+                     warmup) != 0) {
+    warmup->running = false;
+    return -1;
+  }
+
+  return 0;
+}
+
+void connection_warmup_wait(ConnectionWarmup *warmup) {
+  while (warmup->running && !warmup->warmed) {
+    delay(10);
+  }
+}
+
+void connection_warmup_stop(ConnectionWarmup *warmup) {
+  if (!warmup->running)
+    return;
+
+  warmup->running = false;
+  pthread_join(warmup->thread, NULL);
+}
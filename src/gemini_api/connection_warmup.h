@@ -0,0 +1,44 @@
+#ifndef CONNECTIONWARMUP_H
+#define CONNECTIONWARMUP_H
+
+#include "../utils/delay.h"
+#include "../utils/get_time_ms.h"
+#include "gemini_client.h"
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// api and upload hosts, the same one unless env.json points them apart
+#define CONNECTION_WARMUP_MAX_HOSTS 2
+// the hosts are visited this often so the TLS sessions in the share stay
+// fresh and a reconnect after an idle spell resumes one
+#define CONNECTION_WARMUP_KEEPALIVE_S 90
+
+typedef struct ConnectionWarmup {
+  pthread_t thread;
+  volatile bool running;
+  GeminiClient *client;
+
+  char hosts[CONNECTION_WARMUP_MAX_HOSTS][256]; // "https://host[:port]/"
+  int host_count;
+
+  volatile bool warmed; // first round finished, first_round_ms is set
+  double first_round_ms;
+} ConnectionWarmup;
+
+// resolves and connects (TCP and TLS) the client's own handles to the api
+// and upload hosts on a background thread, so the first prompt finds a live
+// connection instead of paying for DNS and a handshake. the thread then
+// uses a handle of its own to keep the share's TLS sessions fresh and to
+// re-resolve pinned addresses before client->dns_pin_s runs out. nothing
+// happens for transports that never touch the network
+int connection_warmup_start(ConnectionWarmup *warmup, GeminiClient *client);
+// returns once the client's handles are free again, call it before the
+// client makes its first request
+void connection_warmup_wait(ConnectionWarmup *warmup);
+void connection_warmup_stop(ConnectionWarmup *warmup);
+
+#endif
@@ -0,0 +1,419 @@
+#include "context_cache.h"
+
+// ".../v1beta/models/gemini-2.5-flash:generateContent?k=v" ->
+// "models/gemini-2.5-flash", caches belong to one model
+static char *make_model_name(const char *api_url) {
+  const char *models = strstr(api_url, "/models/");
+  if (!models)
+    return NULL;
+  models++;
+
+  size_t len = strcspn(models, ":?");
+  char *model = malloc(len + 1);
+  if (!model)
+    return NULL;
+
+  memcpy(model, models, len);
+  model[len] = '\0';
+
+  return model;
+}
+
+ContextCache *context_cache_create(const char *api_url) {
+  ContextCache *cache = calloc(1, sizeof(ContextCache));
+  if (!cache)
+    return NULL;
+
+  // without a model in the url every request simply goes inline
+  cache->model = make_model_name(api_url);
+  cache->ttl_s = CONTEXT_CACHE_DEFAULT_TTL;
+  pthread_mutex_init(&cache->lock, NULL);
+
+  return cache;
+}
+
+void context_cache_destroy(ContextCache *cache) {
+  if (!cache)
+    return;
+
+  pthread_mutex_destroy(&cache->lock);
+  free(cache->model);
+  free(cache);
+}
+
+static void entry_key(GeminiClient *client, ContextCache *cache,
+                      char **file_uris, char **file_mime_types,
+                      int file_count, char out_key[65]) {
+  Sha256 ctx;
+  sha256_init(&ctx);
+
+  sha256_update(&ctx, cache->model, strlen(cache->model) + 1);
+  sha256_update(&ctx, client->system_prompt_json,
+                client->system_prompt_json_len + 1);
+  for (int i = 0; i < file_count; i++) {
+    sha256_update(&ctx, file_uris[i], strlen(file_uris[i]) + 1);
+    sha256_update(&ctx, file_mime_types[i], strlen(file_mime_types[i]) + 1);
+  }
+
+  sha256_final_hex(&ctx, out_key);
+}
+
+// one call on the client's api handle, returns the HTTP status
+static long cache_request(GeminiClient *client, const char *name,
+                          const char *query, const char *method,
+                          const char *body, size_t body_len, Memory *mem) {
+  char url[1024];
+  snprintf(url, sizeof(url), "%s%s%s", client->api_root, name, query);
+
+  CURL *curl = client->api_handle;
+  struct curl_slist *list = NULL;
+  list = curl_slist_append(list, client->auth_header);
+  list = curl_slist_append(list, "Content-Type: application/json");
+
+  gemini_client_prepare(client, curl);
+
+  RequestCall call = {0};
+  call.request.endpoint = "cache";
+  call.request.method = method;
+  call.request.url = url;
+  call.request.headers = list;
+  call.request.body = body;
+  call.request.body_len = body_len;
+  char *gzip_body = gemini_client_compress_body(client, &call.request);
+  call.request.on_body = write_callback;
+  call.request.body_data = (void *)mem;
+  call.body = mem;
+  call.deadline_ms = CONTEXT_CACHE_REQUEST_DEADLINE_MS;
+  call.priority = client->priority;
+
+  long status = 0;
+  if (request_perform(client->transport, client->policy, client->cancel, curl,
+                      &call) == CURLE_OK)
+    status = call.status;
+
+  curl_slist_free_all(list);
+  free(gzip_body);
+
+  return status;
+}
+
+static void write_ttl(JsonWriter *w, long ttl_s) {
+  char ttl[32];
+  snprintf(ttl, sizeof(ttl), "%lds", ttl_s);
+
+  json_key(w, "ttl");
+  json_string(w, ttl);
+}
+
+// POST cachedContents with the system prompt as systemInstruction and the
+// files as the first user turn
+static int create_entry(GeminiClient *client, ContextCache *cache,
+                        char **file_uris, char **file_mime_types,
+                        int file_count, char out_name[CONTEXT_CACHE_NAME_MAX]) {
+  JsonWriter w = {0};
+
+  json_begin_object(&w);
+  json_key(&w, "model");
+  json_string(&w, cache->model);
+  json_key(&w, "displayName");
+  json_string(&w, "success context");
+  write_ttl(&w, cache->ttl_s);
+
+  json_key(&w, "systemInstruction");
+  json_begin_object(&w);
+  json_key(&w, "parts");
+  json_begin_array(&w);
+  json_begin_object(&w);
+  json_key(&w, "text");
+  json_string_begin(&w);
+  json_string_append_escaped(&w, client->system_prompt_json,
+                             client->system_prompt_json_len);
+  json_string_end(&w);
+  json_end_object(&w);
+  json_end_array(&w);
+  json_end_object(&w);
+
+  json_key(&w, "contents");
+  json_begin_array(&w);
+  json_begin_object(&w);
+  json_key(&w, "role");
+  json_string(&w, "user");
+  json_key(&w, "parts");
+  json_begin_array(&w);
+  for (int i = 0; i < file_count; i++) {
+    json_begin_object(&w);
+    json_key(&w, "file_data");
+    json_begin_object(&w);
+    json_key(&w, "mime_type");
+    json_string(&w, file_mime_types[i]);
+    json_key(&w, "file_uri");
+    json_string(&w, file_uris[i]);
+    json_end_object(&w);
+    json_end_object(&w);
+  }
+  json_end_array(&w);
+  json_end_object(&w);
+  json_end_array(&w);
+
+  json_end_object(&w);
+
+  if (w.failed) {
+    json_writer_free(&w);
+    return -1;
+  }
+
+  Memory mem;
+  memory_init(&mem);
+
+  long status =
+      cache_request(client, "cachedContents", "", "POST", w.data, w.len, &mem);
+  json_writer_free(&w);
+
+  int rc = -1;
+  JsonSlice name;
+  if (status == 200 &&
+      json_find(mem.response, mem.size, "name", &name) == 0) {
+    char *text = json_slice_string(&name);
+    if (text && strlen(text) < CONTEXT_CACHE_NAME_MAX) {
+      strcpy(out_name, text);
+      rc = 0;
+    }
+    free(text);
+  } else if (status != 0) {
+    // usually too few tokens for the model's minimum, not worth an error
+    JsonSlice error_message;
+    char *message = NULL;
+    if (json_find(mem.response, mem.size, "error.message", &error_message) ==
+        0)
+      message = json_slice_string(&error_message);
+
+    fprintf(stderr,
+            "[INFO] Not caching the attachments (HTTP %ld): %s\n", status,
+            message ? message : "(no message)");
+    free(message);
+  }
+
+  memory_release(&mem);
+
+  return rc;
+}
+
+// PATCH the ttl, returns the HTTP status
+static long refresh_entry(GeminiClient *client, ContextCache *cache,
+                          const char *name) {
+  JsonWriter w = {0};
+  json_begin_object(&w);
+  write_ttl(&w, cache->ttl_s);
+  json_end_object(&w);
+
+  Memory mem;
+  memory_init(&mem);
+
+  long status = w.failed ? 0
+                         : cache_request(client, name, "?updateMask=ttl",
+                                         "PATCH", w.data, w.len, &mem);
+
+  json_writer_free(&w);
+  memory_release(&mem);
+
+  return status;
+}
+
+static void delete_entry(GeminiClient *client, const char *name) {
+  Memory mem;
+  memory_init(&mem);
+
+  cache_request(client, name, "", "DELETE", NULL, 0, &mem);
+
+  memory_release(&mem);
+}
+
+// cache lock held, the server just set the entry's ttl
+static void entry_renewed(ContextCache *cache, ContextCacheEntry *entry,
+                          double now) {
+  double ttl_ms = cache->ttl_s * 1000.0;
+  double margin_ms = CONTEXT_CACHE_EXPIRY_MARGIN_MS;
+  if (margin_ms > ttl_ms / 4)
+    margin_ms = ttl_ms / 4;
+
+  entry->refresh_at = now + ttl_ms / 2;
+  entry->expires_at = now + ttl_ms - margin_ms;
+}
+
+// cache lock held, expired entries are forgotten on the way
+static ContextCacheEntry *find_entry(ContextCache *cache, const char *key,
+                                     double now) {
+  for (int i = 0; i < CONTEXT_CACHE_SLOTS; i++) {
+    ContextCacheEntry *entry = &cache->entries[i];
+
+    if (entry->state != CONTEXT_CACHE_EMPTY &&
+        entry->state != CONTEXT_CACHE_CREATING && !entry->refreshing &&
+        now >= entry->expires_at)
+      entry->state = CONTEXT_CACHE_EMPTY;
+
+    if (entry->state != CONTEXT_CACHE_EMPTY && strcmp(entry->key, key) == 0)
+      return entry;
+  }
+
+  return NULL;
+}
+
+// cache lock held, an empty slot or the least recently used one. a live
+// evicted entry's name is left in out_evicted for deletion
+static ContextCacheEntry *claim_entry(ContextCache *cache, char *out_evicted) {
+  ContextCacheEntry *victim = NULL;
+  out_evicted[0] = '\0';
+
+  for (int i = 0; i < CONTEXT_CACHE_SLOTS; i++) {
+    ContextCacheEntry *entry = &cache->entries[i];
+
+    if (entry->state == CONTEXT_CACHE_EMPTY)
+      return entry;
+    if (entry->state == CONTEXT_CACHE_CREATING || entry->refreshing)
+      continue;
+    if (!victim || entry->last_used < victim->last_used)
+      victim = entry;
+  }
+
+  if (victim && victim->state == CONTEXT_CACHE_READY)
+    strcpy(out_evicted, victim->name);
+
+  return victim;
+}
+
+// a hit, extending the ttl when due. -1 when the server lost the entry
+static int use_entry(GeminiClient *client, ContextCache *cache,
+                     ContextCacheEntry *entry, double now,
+                     char out_name[CONTEXT_CACHE_NAME_MAX]) {
+  cache->hits++;
+  entry->last_used = now;
+  strcpy(out_name, entry->name);
+
+  bool refresh = now >= entry->refresh_at && !entry->refreshing;
+  if (refresh)
+    entry->refreshing = true;
+  pthread_mutex_unlock(&cache->lock);
+
+  if (!refresh)
+    return 0;
+
+  long status = refresh_entry(client, cache, out_name);
+  now = get_time_ms();
+
+  // refreshing entries are never evicted, entry is still out_name's
+  pthread_mutex_lock(&cache->lock);
+  entry->refreshing = false;
+  if (status == 200) {
+    entry_renewed(cache, entry, now);
+    cache->refreshes++;
+  } else if (status == 403 || status == 404) {
+    entry->state = CONTEXT_CACHE_EMPTY;
+  }
+  bool usable = entry->state == CONTEXT_CACHE_READY;
+  pthread_mutex_unlock(&cache->lock);
+
+  // other failures are left to the expiry margin, the entry still works
+  return usable ? 0 : -1;
+}
+
+int context_cache_acquire(GeminiClient *client, char **file_uris,
+                          char **file_mime_types, int file_count,
+                          char out_name[CONTEXT_CACHE_NAME_MAX]) {
+  ContextCache *cache = client->context_cache;
+
+  // the system prompt alone is below every model's minimum cache size
+  if (!cache || !cache->model || cache->ttl_s <= 0 || file_count <= 0 ||
+      !client->api_root || !client->system_prompt_json)
+    return -1;
+
+  char key[65];
+  entry_key(client, cache, file_uris, file_mime_types, file_count, key);
+
+  double now = get_time_ms();
+
+  pthread_mutex_lock(&cache->lock);
+  ContextCacheEntry *entry = find_entry(cache, key, now);
+
+  if (entry && entry->state == CONTEXT_CACHE_READY)
+    return use_entry(client, cache, entry, now, out_name);
+
+  // another worker is creating it, or it can't be cached
+  if (entry || !(entry = claim_entry(cache, out_name))) {
+    pthread_mutex_unlock(&cache->lock);
+    return -1;
+  }
+
+  memcpy(entry->key, key, sizeof(entry->key));
+  entry->state = CONTEXT_CACHE_CREATING;
+  entry->last_used = now;
+  pthread_mutex_unlock(&cache->lock);
+
+  if (out_name[0])
+    delete_entry(client, out_name);
+
+  char name[CONTEXT_CACHE_NAME_MAX];
+  int rc = create_entry(client, cache, file_uris, file_mime_types, file_count,
+                        name);
+  now = get_time_ms();
+
+  // creating entries are never evicted or invalidated, the slot is ours
+  pthread_mutex_lock(&cache->lock);
+  if (rc == 0) {
+    strcpy(entry->name, name);
+    entry->state = CONTEXT_CACHE_READY;
+    entry_renewed(cache, entry, now);
+    cache->creates++;
+  } else {
+    entry->state = CONTEXT_CACHE_UNCACHEABLE;
+    entry->expires_at = now + cache->ttl_s * 1000.0;
+  }
+  pthread_mutex_unlock(&cache->lock);
+
+  if (rc == 0)
+    strcpy(out_name, name);
+
+  return rc;
+}
+
+bool context_cache_rejected(long status) {
+  return status == 400 || status == 403 || status == 404;
+}
+
+void context_cache_invalidate(GeminiClient *client, const char *name) {
+  ContextCache *cache = client->context_cache;
+  if (!cache)
+    return;
+
+  pthread_mutex_lock(&cache->lock);
+  for (int i = 0; i < CONTEXT_CACHE_SLOTS; i++) {
+    ContextCacheEntry *entry = &cache->entries[i];
+    if (entry->state == CONTEXT_CACHE_READY && !entry->refreshing &&
+        strcmp(entry->name, name) == 0)
+      entry->state = CONTEXT_CACHE_EMPTY;
+  }
+  pthread_mutex_unlock(&cache->lock);
+}
+
+void context_cache_clear(GeminiClient *client) {
+  ContextCache *cache = client->context_cache;
+  if (!cache || !client->api_root)
+    return;
+
+  char names[CONTEXT_CACHE_SLOTS][CONTEXT_CACHE_NAME_MAX];
+  int count = 0;
+  double now = get_time_ms();
+
+  pthread_mutex_lock(&cache->lock);
+  for (int i = 0; i < CONTEXT_CACHE_SLOTS; i++) {
+    ContextCacheEntry *entry = &cache->entries[i];
+    if (entry->state == CONTEXT_CACHE_READY && now < entry->expires_at)
+      strcpy(names[count++], entry->name);
+    if (entry->state != CONTEXT_CACHE_CREATING)
+      entry->state = CONTEXT_CACHE_EMPTY;
+  }
+  pthread_mutex_unlock(&cache->lock);
+
+  for (int i = 0; i < count; i++) {
+    delete_entry(client, names[i]);
+  }
+}
@@ -0,0 +1,82 @@
+#ifndef CONTEXTCACHE_H
+#define CONTEXTCACHE_H
+
+#include "../callbacks/write_callback.h"
+#include "../types/types.h"
+#include "../utils/get_time_ms.h"
+#include "../utils/json_extract.h"
+#include "../utils/json_writer.h"
+#include "../utils/memory_buffer.h"
+#include "../utils/sha256.h"
+#include "gemini_client.h"
+#include "request_policy.h"
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define CONTEXT_CACHE_DEFAULT_TTL 600 // seconds, 0 disables caching
+#define CONTEXT_CACHE_SLOTS 16
+#define CONTEXT_CACHE_NAME_MAX 128
+// stop using an entry this long (at most a quarter of the ttl) before the
+// server drops it
+#define CONTEXT_CACHE_EXPIRY_MARGIN_MS 30000
+// creating a cache over large files takes a while, still bound it
+#define CONTEXT_CACHE_REQUEST_DEADLINE_MS 30000
+
+typedef enum ContextCacheState {
+  CONTEXT_CACHE_EMPTY,
+  CONTEXT_CACHE_CREATING,    // one worker is creating it, others go inline
+  CONTEXT_CACHE_READY,
+  CONTEXT_CACHE_UNCACHEABLE, // creation failed (e.g. too few tokens), don't
+                             // try again until it expires
+} ContextCacheState;
+
+typedef struct ContextCacheEntry {
+  char key[65]; // sha256 over model, system prompt and attachments
+  char name[CONTEXT_CACHE_NAME_MAX]; // "cachedContents/<id>"
+  ContextCacheState state;
+  bool refreshing;
+  // get_time_ms() clock
+  double refresh_at; // past this, the next use extends the ttl
+  double expires_at;
+  double last_used;
+} ContextCacheEntry;
+
+// cachedContents entries holding the system prompt and attached files, so
+// follow-up questions about the same files only send the question. one per
+// client, clones borrow the parent's
+typedef struct ContextCache {
+  pthread_mutex_t lock;
+  char *model;  // "models/<id>" taken from GEMINI_API_URL
+  long ttl_s;   // lifetime on the server, renewed while in use
+  ContextCacheEntry entries[CONTEXT_CACHE_SLOTS];
+
+  // counters since startup
+  unsigned long long hits;
+  unsigned long long creates;
+  unsigned long long refreshes;
+} ContextCache;
+
+ContextCache *context_cache_create(const char *api_url);
+void context_cache_destroy(ContextCache *cache);
+
+// name of a cache holding the system prompt and these files, created on the
+// first use and its ttl extended once half of it has passed. returns -1 when
+// the request should carry everything inline instead
+int context_cache_acquire(GeminiClient *client, char **file_uris,
+                          char **file_mime_types, int file_count,
+                          char out_name[CONTEXT_CACHE_NAME_MAX]);
+
+// whether a generateContent status naming a cache means the cache is gone:
+// expired early, deleted or its files no longer readable
+bool context_cache_rejected(long status);
+
+// a request naming it was rejected, the server no longer has it
+void context_cache_invalidate(GeminiClient *client, const char *name);
+
+// deletes every live entry on the server, storage is billed until expiry
+void context_cache_clear(GeminiClient *client);
+
+#endif
@@ -0,0 +1,188 @@
+#include "conversation.h"
+
+Conversation *conversation_create(size_t token_budget) {
+  Conversation *conversation = calloc(1, sizeof(Conversation));
+  if (!conversation)
+    return NULL;
+
+  conversation->token_budget =
+      token_budget > 0 ? token_budget : CONVERSATION_DEFAULT_TOKEN_BUDGET;
+
+  return conversation;
+}
+
+void conversation_destroy(Conversation *conversation) {
+  if (!conversation)
+    return;
+
+  free(conversation->arena);
+  free(conversation->turns);
+  free(conversation);
+}
+
+void conversation_clear(Conversation *conversation) {
+  conversation->arena_len = 0;
+  conversation->first = 0;
+  conversation->count = 0;
+  conversation->tokens = 0;
+}
+
+size_t conversation_turns(const Conversation *conversation) {
+  return conversation->count - conversation->first;
+}
+
+static size_t estimate_tokens(size_t text_len) {
+  return (text_len + CONVERSATION_BYTES_PER_TOKEN - 1) /
+             CONVERSATION_BYTES_PER_TOKEN +
+         CONVERSATION_TURN_OVERHEAD_TOKENS;
+}
+
+static int reserve_arena(Conversation *conversation, size_t extra) {
+  size_t needed = conversation->arena_len + extra;
+  if (needed <= conversation->arena_cap)
+    return 0;
+
+  size_t cap = conversation->arena_cap ? conversation->arena_cap : 4096;
+  while (cap < needed) {
+    cap *= 2;
+  }
+
+  char *arena = realloc(conversation->arena, cap);
+  if (!arena)
+    return -1;
+
+  conversation->arena = arena;
+  conversation->arena_cap = cap;
+
+  return 0;
+}
+
+static int reserve_turns(Conversation *conversation, size_t extra) {
+  size_t needed = conversation->count + extra;
+  if (needed <= conversation->turn_cap)
+    return 0;
+
+  size_t cap = conversation->turn_cap ? conversation->turn_cap * 2 : 16;
+  while (cap < needed) {
+    cap *= 2;
+  }
+
+  ConversationTurn *turns =
+      realloc(conversation->turns, cap * sizeof(ConversationTurn));
+  if (!turns)
+    return -1;
+
+  conversation->turns = turns;
+  conversation->turn_cap = cap;
+
+  return 0;
+}
+
+// moves the kept turns to the front once the trimmed ones take up more
+// room than they do, so each byte is moved a bounded number of times
+static void compact(Conversation *conversation) {
+  size_t dead = conversation->first < conversation->count
+                    ? conversation->turns[conversation->first].offset
+                    : conversation->arena_len;
+  size_t live = conversation->arena_len - dead;
+
+  if (conversation->first == 0 || dead < live)
+    return;
+
+  memmove(conversation->arena, conversation->arena + dead, live);
+  conversation->arena_len = live;
+
+  size_t kept = conversation->count - conversation->first;
+  memmove(conversation->turns, conversation->turns + conversation->first,
+          kept * sizeof(ConversationTurn));
+  conversation->first = 0;
+  conversation->count = kept;
+
+  for (size_t i = 0; i < kept; i++) {
+    conversation->turns[i].offset -= dead;
+  }
+
+  // one huge answer shouldn't pin its arena for the rest of the session
+  if (conversation->arena_cap > CONVERSATION_ARENA_SHRINK_AT &&
+      live < conversation->arena_cap / 4) {
+    size_t cap = live > 4096 ? live * 2 : 4096;
+    char *arena = realloc(conversation->arena, cap);
+    if (arena) {
+      conversation->arena = arena;
+      conversation->arena_cap = cap;
+    }
+  }
+}
+
+// drops whole exchanges, oldest first, until the kept turns fit the budget
+static void trim(Conversation *conversation) {
+  while (conversation->tokens > conversation->token_budget &&
+         conversation->first + 2 <= conversation->count) {
+    conversation->tokens -= conversation->turns[conversation->first].tokens;
+    conversation->tokens -=
+        conversation->turns[conversation->first + 1].tokens;
+    conversation->first += 2;
+    conversation->trimmed_exchanges++;
+  }
+
+  compact(conversation);
+}
+
+static void push_turn(Conversation *conversation, bool model,
+                      const char *escaped, size_t escaped_len,
+                      size_t text_len) {
+  ConversationTurn *turn = &conversation->turns[conversation->count++];
+  turn->model = model;
+  turn->offset = conversation->arena_len;
+  turn->len = escaped_len;
+  turn->tokens = estimate_tokens(text_len);
+
+  memcpy(conversation->arena + conversation->arena_len, escaped, escaped_len);
+  conversation->arena_len += escaped_len;
+  conversation->tokens += turn->tokens;
+}
+
+int conversation_add_exchange(Conversation *conversation, const char *prompt,
+                              const char *answer) {
+  size_t prompt_len = 0;
+  size_t answer_len = 0;
+  char *prompt_json = json_escape(prompt, &prompt_len);
+  char *answer_json = json_escape(answer, &answer_len);
+
+  int rc = -1;
+  if (prompt_json && answer_json &&
+      reserve_arena(conversation, prompt_len + answer_len) == 0 &&
+      reserve_turns(conversation, 2) == 0) {
+    push_turn(conversation, false, prompt_json, prompt_len, strlen(prompt));
+    push_turn(conversation, true, answer_json, answer_len, strlen(answer));
+    trim(conversation);
+    rc = 0;
+  }
+
+  free(prompt_json);
+  free(answer_json);
+
+  return rc;
+}
+
+void conversation_write_turns(const Conversation *conversation,
+                              JsonWriter *w) {
+  for (size_t i = conversation->first; i < conversation->count; i++) {
+    const ConversationTurn *turn = &conversation->turns[i];
+
+    json_begin_object(w);
+    json_key(w, "role");
+    json_string(w, turn->model ? "model" : "user");
+    json_key(w, "parts");
+    json_begin_array(w);
+    json_begin_object(w);
+    json_key(w, "text");
+    json_string_begin(w);
+    json_string_append_escaped(w, conversation->arena + turn->offset,
+                               turn->len);
+    json_string_end(w);
+    json_end_object(w);
+    json_end_array(w);
+    json_end_object(w);
+  }
+}
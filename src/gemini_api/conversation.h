@@ -0,0 +1,69 @@
+#ifndef CONVERSATION_H
+#define CONVERSATION_H
+
+#include "../utils/json_writer.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONVERSATION_DEFAULT_TOKEN_BUDGET 8192
+// rough tokens per byte of text, good enough to bound request size
+#define CONVERSATION_BYTES_PER_TOKEN 4
+// role and framing around each turn's text
+#define CONVERSATION_TURN_OVERHEAD_TOKENS 4
+// an arena this big that is mostly free after a trim is given back
+#define CONVERSATION_ARENA_SHRINK_AT (1024 * 1024)
+
+typedef struct ConversationTurn {
+  bool model;    // "model" turn, otherwise "user"
+  size_t offset; // escaped text in the arena
+  size_t len;
+  size_t tokens; // estimated
+} ConversationTurn;
+
+// the exchanges so far, oldest first. every turn's text is stored JSON
+// escaped back to back in one arena so a request copies it as is. whole
+// exchanges are dropped oldest first once the estimated tokens go over
+// token_budget, so memory and request size stay bounded however long the
+// session runs. attachments are not kept, attach them again to ask about
+// them (the context cache makes that cheap)
+//
+// not locked: the UI only adds to it while no request is reading it
+typedef struct Conversation {
+  char *arena;
+  size_t arena_len; // bytes in use, including trimmed turns before first
+  size_t arena_cap;
+
+  ConversationTurn *turns;
+  size_t first; // oldest kept turn, the ones before it were trimmed
+  size_t count;
+  size_t turn_cap;
+
+  size_t tokens; // estimated tokens of the kept turns
+  size_t token_budget;
+
+  unsigned long long trimmed_exchanges; // since startup
+} Conversation;
+
+Conversation *conversation_create(size_t token_budget);
+void conversation_destroy(Conversation *conversation);
+
+// forgets every turn, keeps the buffers for the next conversation
+void conversation_clear(Conversation *conversation);
+
+// records a question and its answer, then trims to the budget. returns -1
+// when out of memory, the conversation is unchanged then
+int conversation_add_exchange(Conversation *conversation, const char *prompt,
+                              const char *answer);
+
+// kept turns, 0 at the start of a conversation
+size_t conversation_turns(const Conversation *conversation);
+
+// {"role": ..., "parts": [{"text": ...}]} of every kept turn into an open
+// contents array
+void conversation_write_turns(const Conversation *conversation,
+                              JsonWriter *w);
+
+#endif
@@ -0,0 +1,75 @@
+#include "file_metadata.h"
+
+static long file_request(GeminiClient *client, CURL *curl, const char *name,
+                         const char *method, Memory *mem) {
+  if (!client->api_root)
+    return 0;
+
+  char url[1024];
+  snprintf(url, sizeof(url), "%s%s", client->api_root, name);
+
+  struct curl_slist *list = NULL;
+  list = curl_slist_append(list, client->auth_header);
+
+  gemini_client_prepare(client, curl);
+
+  RequestCall call = {0};
+  call.request.endpoint = "files";
+  call.request.method = method;
+  call.request.url = url;
+  call.request.headers = list;
+  call.request.on_body = write_callback;
+  call.request.body_data = (void *)mem;
+  call.body = mem;
+
+  // metadata calls are small, don't let a brownout hold them for minutes
+  call.deadline_ms = FILE_REQUEST_DEADLINE_MS;
+  // only the file cache refresher asks, nobody waits on it
+  call.priority = REQUEST_PRIORITY_BACKGROUND;
+
+  long status = 0;
+  if (request_perform(client->transport, client->policy, client->cancel, curl,
+                      &call) == CURLE_OK)
+    status = call.status;
+
+  curl_slist_free_all(list);
+
+  return status;
+}
+
+long get_file_metadata(GeminiClient *client, CURL *curl, const char *name,
+                       GeminiFile *out) {
+  Memory mem;
+  memory_init(&mem);
+
+  long status = file_request(client, curl, name, "GET", &mem);
+
+  if (status == 200) {
+    JsonSlice file = {mem.response, mem.size};
+    JsonSlice state;
+
+    // a file that failed processing is as good as gone
+    if (json_slice_find(&file, "state", &state) == 0 &&
+        state.len == sizeof("\"FAILED\"") - 1 &&
+        memcmp(state.start, "\"FAILED\"", state.len) == 0) {
+      status = 404;
+    } else if (gemini_file_from_json(&file, out) != 0) {
+      status = 0;
+    }
+  }
+
+  memory_release(&mem);
+
+  return status;
+}
+
+long delete_file(GeminiClient *client, CURL *curl, const char *name) {
+  Memory mem;
+  memory_init(&mem);
+
+  long status = file_request(client, curl, name, "DELETE", &mem);
+
+  memory_release(&mem);
+
+  return status;
+}
@@ -0,0 +1,23 @@
+#ifndef FILEMETADATA_H
+#define FILEMETADATA_H
+
+#include "../callbacks/write_callback.h"
+#include "../types/types.h"
+#include "gemini_client.h"
+#include "get_file_uri.h"
+#include "request_policy.h"
+
+#include <curl/curl.h>
+#include <stdlib.h>
+
+#define FILE_REQUEST_DEADLINE_MS 15000
+
+// GET files/<id>, fills out when the file exists and returns the HTTP
+// status (0 on transport errors). curl is any handle owned by the caller
+long get_file_metadata(GeminiClient *client, CURL *curl, const char *name,
+                       GeminiFile *out);
+
+// DELETE files/<id>, returns the HTTP status
+long delete_file(GeminiClient *client, CURL *curl, const char *name);
+
+#endif
@@ -0,0 +1,356 @@
+#include "gemini_batch.h"
+
+static const struct {
+  const char *suffix;
+  GeminiBatchState state;
+} batch_states[] = {
+    {"PENDING", GEMINI_BATCH_PENDING},
+    {"RUNNING", GEMINI_BATCH_RUNNING},
+    {"SUCCEEDED", GEMINI_BATCH_SUCCEEDED},
+    {"FAILED", GEMINI_BATCH_FAILED},
+    {"CANCELLED", GEMINI_BATCH_CANCELLED},
+    {"EXPIRED", GEMINI_BATCH_EXPIRED},
+};
+
+// "BATCH_STATE_RUNNING" and friends
+static GeminiBatchState parse_state(const char *text) {
+  if (!text)
+    return GEMINI_BATCH_UNKNOWN;
+
+  const char *suffix = strrchr(text, '_');
+  suffix = suffix ? suffix + 1 : text;
+
+  for (size_t i = 0; i < sizeof(batch_states) / sizeof(batch_states[0]);
+       i++) {
+    if (strcmp(suffix, batch_states[i].suffix) == 0)
+      return batch_states[i].state;
+  }
+
+  return GEMINI_BATCH_UNKNOWN;
+}
+
+bool gemini_batch_is_final(GeminiBatchState state) {
+  return state == GEMINI_BATCH_SUCCEEDED || state == GEMINI_BATCH_FAILED ||
+         state == GEMINI_BATCH_CANCELLED || state == GEMINI_BATCH_EXPIRED;
+}
+
+const char *gemini_batch_state_name(GeminiBatchState state) {
+  for (size_t i = 0; i < sizeof(batch_states) / sizeof(batch_states[0]);
+       i++) {
+    if (batch_states[i].state == state)
+      return batch_states[i].suffix;
+  }
+
+  return "UNKNOWN";
+}
+
+// one call on the main client's api handle, returns the HTTP status
+static long batch_request(GeminiClient *client, const char *url,
+                          const char *method, const char *body,
+                          size_t body_len, Memory *mem) {
+  CURL *curl = client->api_handle;
+  struct curl_slist *list = NULL;
+  list = curl_slist_append(list, client->auth_header);
+  list = curl_slist_append(list, "Content-Type: application/json");
+
+  gemini_client_prepare(client, curl);
+
+  RequestCall call = {0};
+  call.request.endpoint = "batch";
+  call.request.method = method;
+  call.request.url = url;
+  call.request.headers = list;
+  call.request.body = body;
+  call.request.body_len = body_len;
+  char *gzip_body = gemini_client_compress_body(client, &call.request);
+  call.request.on_body = write_callback;
+  call.request.body_data = (void *)mem;
+  call.body = mem;
+  // the batch API is for work that can wait, never hold up a prompt
+  call.priority = REQUEST_PRIORITY_BACKGROUND;
+
+  long status = 0;
+  if (request_perform(client->transport, client->policy, client->cancel, curl,
+                      &call) == CURLE_OK)
+    status = call.status;
+
+  curl_slist_free_all(list);
+  free(gzip_body);
+
+  return status;
+}
+
+static void report_error(const char *what, long status, Memory *mem) {
+  JsonSlice error_message;
+  char *message = NULL;
+  if (json_find(mem->response, mem->size, "error.message", &error_message) ==
+      0)
+    message = json_slice_string(&error_message);
+
+  fprintf(stderr, "[ERROR] %s failed with HTTP %ld: %s\n", what, status,
+          message ? message : "(no message)");
+  free(message);
+}
+
+int gemini_batch_submit(GeminiClient *client, GeminiBatch *batch,
+                        const char *display_name) {
+  if (!client->batch_url) {
+    fprintf(stderr, "[ERROR] GEMINI_API_URL has no :generateContent method "
+                    "to batch.\n");
+    return -1;
+  }
+
+  JsonWriter w = {0};
+
+  json_begin_object(&w);
+  json_key(&w, "batch");
+  json_begin_object(&w);
+  json_key(&w, "display_name");
+  json_string(&w, display_name);
+  json_key(&w, "input_config");
+  json_begin_object(&w);
+  json_key(&w, "requests");
+  json_begin_object(&w);
+  json_key(&w, "requests");
+  json_begin_array(&w);
+
+  for (size_t i = 0; i < batch->count; i++) {
+    GeminiBatchItem *item = &batch->items[i];
+
+    json_begin_object(&w);
+    json_key(&w, "request");
+    json_begin_object(&w);
+    write_request_contents(&w, client, item->file_uris, item->prompt,
+                           item->file_mime_types, item->file_count);
+    if (client->response_type)
+      structured_write_config(&w, client->response_type);
+    json_end_object(&w);
+    json_key(&w, "metadata");
+    json_begin_object(&w);
+    json_key(&w, "key");
+    json_string(&w, item->key);
+    json_end_object(&w);
+    json_end_object(&w);
+  }
+
+  json_end_array(&w);
+  json_end_object(&w);
+  json_end_object(&w);
+  json_end_object(&w);
+  json_end_object(&w);
+
+  if (w.failed) {
+    json_writer_free(&w);
+    return -1;
+  }
+
+  if (w.len > BATCH_MAX_BODY_BYTES) {
+    fprintf(stderr,
+            "[ERROR] Batch of %zu requests is %zu bytes, over the %d byte "
+            "limit for inlined requests.\n",
+            batch->count, w.len, BATCH_MAX_BODY_BYTES);
+    json_writer_free(&w);
+    return -1;
+  }
+
+  if (!gemini_client_within_budget(client, w.len)) {
+    json_writer_free(&w);
+    return -1;
+  }
+
+  Memory mem;
+  memory_init(&mem);
+
+  long status =
+      batch_request(client, client->batch_url, NULL, w.data, w.len, &mem);
+  json_writer_free(&w);
+
+  JsonSlice name;
+  int rc = -1;
+  if (status != 200) {
+    report_error("Batch submit", status, &mem);
+  } else if (json_find(mem.response, mem.size, "name", &name) == 0) {
+    free(batch->name);
+    batch->name = json_slice_string(&name);
+    batch->state = GEMINI_BATCH_PENDING;
+    batch->polls = 0;
+    rc = batch->name ? 0 : -1;
+  }
+
+  memory_release(&mem);
+
+  return rc;
+}
+
+static GeminiBatchItem *find_item(GeminiBatch *batch, size_t index,
+                                  const JsonSlice *element) {
+  JsonSlice key_value;
+  if (json_slice_find(element, "metadata.key", &key_value) != 0) {
+    // no metadata echoed back, responses come in request order
+    return index < batch->count ? &batch->items[index] : NULL;
+  }
+
+  char *key = json_slice_string(&key_value);
+  if (!key)
+    return NULL;
+
+  // usually in order, so look where it should be before searching
+  GeminiBatchItem *found = NULL;
+  if (index < batch->count && strcmp(batch->items[index].key, key) == 0) {
+    found = &batch->items[index];
+  } else {
+    for (size_t i = 0; i < batch->count && !found; i++) {
+      if (strcmp(batch->items[i].key, key) == 0)
+        found = &batch->items[i];
+    }
+  }
+  free(key);
+
+  return found;
+}
+
+static void demux_responses(GeminiClient *client, GeminiBatch *batch,
+                            const JsonSlice *responses) {
+  const char *cursor = NULL;
+  JsonSlice element;
+  size_t index = 0;
+
+  while (json_array_next(responses, &cursor, &element) == 0) {
+    GeminiBatchItem *item = find_item(batch, index++, &element);
+    if (!item)
+      continue;
+
+    TokenUsage usage;
+    if (token_usage_parse(element.start, element.len,
+                          "response.usageMetadata", &usage) == 0)
+      gemini_client_account(client, "batch", &usage);
+
+    char *text = json_concat_text(element.start, element.len,
+                                  "response.candidates[0].content.parts");
+    if (text) {
+      free(item->response);
+      if (client->response_type) {
+        item->response = text;
+      } else {
+        item->response = replace_escaped_ansi(text);
+        free(text);
+      }
+      continue;
+    }
+
+    JsonSlice error_message;
+    free(item->error);
+    item->error =
+        json_slice_find(&element, "error.message", &error_message) == 0
+            ? json_slice_string(&error_message)
+            : strdup("response has no text");
+  }
+}
+
+int gemini_batch_poll(GeminiClient *client, GeminiBatch *batch) {
+  if (!batch->name || !client->api_root)
+    return -1;
+
+  char url[1024];
+  snprintf(url, sizeof(url), "%s%s", client->api_root, batch->name);
+
+  Memory mem;
+  memory_init(&mem);
+
+  long status = batch_request(client, url, NULL, NULL, 0, &mem);
+  batch->polls++;
+
+  if (status != 200) {
+    report_error("Batch poll", status, &mem);
+    memory_release(&mem);
+    return -1;
+  }
+
+  // an Operation wrapping the batch, or the batch resource itself
+  JsonSlice state_value;
+  if (json_find(mem.response, mem.size, "metadata.state", &state_value) == 0 ||
+      json_find(mem.response, mem.size, "state", &state_value) == 0) {
+    char *state = json_slice_string(&state_value);
+    batch->state = parse_state(state);
+    free(state);
+  }
+
+  JsonSlice error_value;
+  if (json_find(mem.response, mem.size, "error", &error_value) == 0) {
+    report_error("Batch", status, &mem);
+    batch->state = GEMINI_BATCH_FAILED;
+  }
+
+  JsonSlice responses;
+  if (batch->state == GEMINI_BATCH_SUCCEEDED) {
+    if (json_find(mem.response, mem.size,
+                  "response.inlinedResponses.inlinedResponses",
+                  &responses) == 0 ||
+        json_find(mem.response, mem.size,
+                  "output.inlinedResponses.inlinedResponses",
+                  &responses) == 0) {
+      demux_responses(client, batch, &responses);
+    } else {
+      fprintf(stderr, "[ERROR] Batch %s finished without inlined "
+                      "responses.\n",
+              batch->name);
+    }
+  }
+
+  memory_release(&mem);
+
+  return 0;
+}
+
+GeminiBatchState gemini_batch_wait(GeminiClient *client, GeminiBatch *batch,
+                                   bool (*stop)(void *arg), void *stop_arg) {
+  long interval_ms = BATCH_POLL_FIRST_MS;
+
+  while (!gemini_batch_is_final(batch->state)) {
+    for (long waited = 0; waited < interval_ms; waited += 50) {
+      if (stop && stop(stop_arg))
+        return batch->state;
+      delay(50);
+    }
+
+    // a failed poll is retried at the next interval, the batch goes on
+    gemini_batch_poll(client, batch);
+
+    interval_ms = interval_ms * 3 / 2;
+    if (interval_ms > BATCH_POLL_MAX_MS)
+      interval_ms = BATCH_POLL_MAX_MS;
+  }
+
+  return batch->state;
+}
+
+int gemini_batch_cancel(GeminiClient *client, GeminiBatch *batch) {
+  if (!batch->name || !client->api_root)
+    return -1;
+
+  char url[1024];
+  snprintf(url, sizeof(url), "%s%s:cancel", client->api_root, batch->name);
+
+  Memory mem;
+  memory_init(&mem);
+
+  long status = batch_request(client, url, "POST", "", 0, &mem);
+  if (status != 200)
+    report_error("Batch cancel", status, &mem);
+
+  memory_release(&mem);
+
+  return status == 200 ? 0 : -1;
+}
+
+void gemini_batch_free(GeminiBatch *batch) {
+  free(batch->name);
+  batch->name = NULL;
+
+  for (size_t i = 0; i < batch->count; i++) {
+    free(batch->items[i].response);
+    free(batch->items[i].error);
+    batch->items[i].response = NULL;
+    batch->items[i].error = NULL;
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef GEMINIBATCH_H
+#define GEMINIBATCH_H
+
+#include "../callbacks/write_callback.h"
+#include "../types/types.h"
+#include "../utils/delay.h"
+#include "../utils/json_extract.h"
+#include "../utils/json_writer.h"
+#include "../utils/memory_buffer.h"
+#include "../utils/replace_escaped_ansii.h"
+#include "build_request_body.h"
+#include "gemini_client.h"
+#include "request_policy.h"
+
+#include <curl/curl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// inlined batch requests must stay under the API's 20 MB body limit
+#define BATCH_MAX_BODY_BYTES (20 * 1000 * 1000)
+// polling starts fast for small batches and backs off for long ones
+#define BATCH_POLL_FIRST_MS 2000
+#define BATCH_POLL_MAX_MS 30000
+
+typedef enum GeminiBatchState {
+  GEMINI_BATCH_UNKNOWN,
+  GEMINI_BATCH_PENDING,
+  GEMINI_BATCH_RUNNING,
+  GEMINI_BATCH_SUCCEEDED, // every item has a response or an error
+  GEMINI_BATCH_FAILED,
+  GEMINI_BATCH_CANCELLED,
+  GEMINI_BATCH_EXPIRED,
+} GeminiBatchState;
+
+// one generateContent request of a batch
+typedef struct GeminiBatchItem {
+  const char *key; // unique in the batch, how its answer is found again
+  char *prompt;
+  char **file_uris;
+  char **file_mime_types;
+  int file_count;
+
+  char *response; // cleaned answer once the batch succeeded
+  char *error;    // or why this item failed
+} GeminiBatchItem;
+
+typedef struct GeminiBatch {
+  char *name; // "batches/<id>"
+  GeminiBatchState state;
+  GeminiBatchItem *items;
+  size_t count;
+  int polls;
+} GeminiBatch;
+
+// packs every item into one batchGenerateContent job, returns 0 and sets
+// batch->name once the server accepted it. with the client's response_type
+// set every item asks for that schema, keep it set while polling so the
+// answers come back untouched for structured_decode()
+int gemini_batch_submit(GeminiClient *client, GeminiBatch *batch,
+                        const char *display_name);
+
+// one GET of the batch, updates state and, when it just finished, hands
+// every inlined response to its item by key. returns -1 on request errors
+int gemini_batch_poll(GeminiClient *client, GeminiBatch *batch);
+
+// polls with growing intervals until the batch is final or stop (optional,
+// checked every 50 ms) returns true
+GeminiBatchState gemini_batch_wait(GeminiClient *client, GeminiBatch *batch,
+                                   bool (*stop)(void *arg), void *stop_arg);
+
+// asks the server to stop working on the batch
+int gemini_batch_cancel(GeminiClient *client, GeminiBatch *batch);
+
+bool gemini_batch_is_final(GeminiBatchState state);
+const char *gemini_batch_state_name(GeminiBatchState state);
+
+// frees name and every item's response and error, not the items array
+void gemini_batch_free(GeminiBatch *batch);
+
+#endif
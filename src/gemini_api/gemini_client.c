@@ -0,0 +1,380 @@
+#include "gemini_client.h"
+#include "context_cache.h"
+
+static void share_lock(CURL *handle, curl_lock_data data,
+                       curl_lock_access access, void *userptr) {
+  GeminiClient *client = (GeminiClient *)userptr;
+  pthread_mutex_lock(&client->share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr) {
+  GeminiClient *client = (GeminiClient *)userptr;
+  pthread_mutex_unlock(&client->share_locks[data]);
+}
+
+// progress callback, a non-zero return aborts the transfer
+static int cancel_check(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                        curl_off_t ultotal, curl_off_t ulnow) {
+  volatile int *cancel = (volatile int *)clientp;
+  return *cancel ? 1 : 0;
+}
+
+char *gemini_stream_url(const char *api_url) {
+  const char *method = ":generateContent";
+  const char *found = strstr(api_url, method);
+  if (!found)
+    return NULL;
+
+  const char *rest = found + strlen(method);
+  size_t prefix_len = found - api_url;
+  size_t len = prefix_len + strlen(rest) + 64;
+  char *url = malloc(len);
+  if (!url)
+    return NULL;
+
+  snprintf(url, len, "%.*s:streamGenerateContent?alt=sse%s%s", (int)prefix_len,
+           api_url, *rest == '?' ? "&" : "", *rest == '?' ? rest + 1 : rest);
+
+  return url;
+}
+
+// ".../models/x:generateContent?k=v" -> ".../models/x:batchGenerateContent",
+// batches take no streaming or other query options
+static char *make_batch_url(const char *api_url) {
+  const char *found = strstr(api_url, ":generateContent");
+  if (!found)
+    return NULL;
+
+  size_t prefix_len = found - api_url;
+  size_t len = prefix_len + 32;
+  char *url = malloc(len);
+  if (!url)
+    return NULL;
+
+  snprintf(url, len, "%.*s:batchGenerateContent", (int)prefix_len, api_url);
+
+  return url;
+}
+
+// ".../upload/v1beta/files" -> ".../v1beta/", resource calls such as file
+// metadata live next to the upload endpoint without the upload segment
+static char *make_api_root(const char *file_url) {
+  const char *upload = strstr(file_url, "/upload/");
+  const char *files = strstr(file_url, "/files");
+  if (!files)
+    return NULL;
+
+  size_t len = strlen(file_url) + 2;
+  char *root = malloc(len);
+  if (!root)
+    return NULL;
+
+  if (upload && upload < files) {
+    snprintf(root, len, "%.*s/%.*s/", (int)(upload - file_url), file_url,
+             (int)(files - upload - 8), upload + 8);
+  } else {
+    snprintf(root, len, "%.*s/", (int)(files - file_url), file_url);
+  }
+
+  return root;
+}
+
+GeminiClient *gemini_client_create(const char *api_url, const char *file_url,
+                                   const char *api_key) {
+  if (!api_url || !file_url || !api_key)
+    return NULL;
+
+  GeminiClient *client = calloc(1, sizeof(GeminiClient));
+  if (!client)
+    return NULL;
+
+  for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+    pthread_mutex_init(&client->share_locks[i], NULL);
+  }
+
+  client->share = curl_share_init();
+  client->policy = request_policy_create();
+  client->transport = transport_curl_create();
+  client->context_cache = context_cache_create(api_url);
+  if (client->share) {
+    curl_share_setopt(client->share, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(client->share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(client->share, CURLSHOPT_USERDATA, (void *)client);
+    // only what libcurl can share between threads under these locks. the
+    // connection cache isn't, every easy handle keeps its own connections
+    // alive instead
+    curl_share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(client->share, CURLSHOPT_SHARE,
+                      CURL_LOCK_DATA_SSL_SESSION);
+  }
+
+  client->api_handle = curl_easy_init();
+  client->upload_handle = curl_easy_init();
+  client->file_handle = curl_easy_init();
+  client->multi = curl_multi_init();
+
+  client->api_url = strdup(api_url);
+  client->stream_url = gemini_stream_url(api_url);
+  client->batch_url = make_batch_url(api_url);
+  client->file_url = strdup(file_url);
+  client->api_root = make_api_root(file_url);
+  client->api_key = strdup(api_key);
+
+  snprintf(client->auth_header, sizeof(client->auth_header), "%s %s",
+           "x-goog-api-key:", api_key);
+  client->dns_pin_s = GEMINI_CLIENT_DEFAULT_DNS_PIN_S;
+  client->inline_attachment_bytes = ATTACHMENT_DEFAULT_INLINE_BYTES;
+  client->request_limit = ATTACHMENT_DEFAULT_REQUEST_LIMIT;
+
+  if (!client->api_handle || !client->upload_handle || !client->file_handle ||
+      !client->multi || !client->api_url || !client->file_url ||
+      !client->api_key || !client->policy || !client->transport ||
+      !client->context_cache) {
+    fprintf(stderr, "[ERROR] Failed to create gemini client.\n");
+    gemini_client_destroy(client);
+    return NULL;
+  }
+
+  return client;
+}
+
+void gemini_client_destroy(GeminiClient *client) {
+  if (!client)
+    return;
+
+  // easy handles must go before the share they are attached to
+  if (client->multi)
+    curl_multi_cleanup(client->multi);
+  curl_easy_cleanup(client->api_handle);
+  curl_easy_cleanup(client->upload_handle);
+  curl_easy_cleanup(client->file_handle);
+
+  if (!client->is_clone) {
+    if (client->share)
+      curl_share_cleanup(client->share);
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+      pthread_mutex_destroy(&client->share_locks[i]);
+    }
+
+    request_policy_destroy(client->policy);
+    transport_destroy(client->transport);
+    curl_slist_free_all(client->resolve);
+    free(client->ca_bundle);
+    context_cache_destroy(client->context_cache);
+  }
+
+  free(client->api_url);
+  free(client->stream_url);
+  free(client->batch_url);
+  free(client->file_url);
+  free(client->api_root);
+  free(client->api_key);
+  free(client->prompt_prefix_json);
+  free(client->system_prompt_json);
+  json_writer_free(&client->body);
+  free(client);
+}
+
+GeminiClient *gemini_client_clone(GeminiClient *parent) {
+  GeminiClient *client = calloc(1, sizeof(GeminiClient));
+  if (!client)
+    return NULL;
+
+  // the share's lock callbacks keep pointing at the parent's mutexes,
+  // latencies from every worker land in the same policy windows and every
+  // worker finds the caches the others created
+  client->share = parent->share;
+  client->policy = parent->policy;
+  client->transport = parent->transport;
+  client->dns_pin_s = parent->dns_pin_s;
+  client->gzip_request_bytes = parent->gzip_request_bytes;
+  client->inline_attachment_bytes = parent->inline_attachment_bytes;
+  client->request_limit = parent->request_limit;
+  client->usage = parent->usage;
+  client->user = parent->user;
+  client->resolve = parent->resolve;
+  client->ca_bundle = parent->ca_bundle;
+  client->context_cache = parent->context_cache;
+  client->router = parent->router;
+  client->is_clone = true;
+
+  client->api_handle = curl_easy_init();
+  client->upload_handle = curl_easy_init();
+  client->file_handle = curl_easy_init();
+  client->multi = curl_multi_init();
+
+  client->api_url = strdup(parent->api_url);
+  client->stream_url = parent->stream_url ? strdup(parent->stream_url) : NULL;
+  client->batch_url = parent->batch_url ? strdup(parent->batch_url) : NULL;
+  client->file_url = strdup(parent->file_url);
+  client->api_root = parent->api_root ? strdup(parent->api_root) : NULL;
+  client->api_key = strdup(parent->api_key);
+  memcpy(client->auth_header, parent->auth_header, sizeof(client->auth_header));
+
+  if (parent->prompt_prefix_json) {
+    client->prompt_prefix_json = malloc(parent->prompt_prefix_json_len + 1);
+    if (client->prompt_prefix_json) {
+      memcpy(client->prompt_prefix_json, parent->prompt_prefix_json,
+             parent->prompt_prefix_json_len + 1);
+      client->prompt_prefix_json_len = parent->prompt_prefix_json_len;
+    }
+  }
+
+  if (parent->system_prompt_json) {
+    client->system_prompt_json = malloc(parent->system_prompt_json_len + 1);
+    if (client->system_prompt_json) {
+      memcpy(client->system_prompt_json, parent->system_prompt_json,
+             parent->system_prompt_json_len + 1);
+      client->system_prompt_json_len = parent->system_prompt_json_len;
+    }
+  }
+
+  if (!client->api_handle || !client->upload_handle || !client->file_handle ||
+      !client->multi || !client->api_url || !client->file_url ||
+      !client->api_key ||
+      (parent->prompt_prefix_json && !client->prompt_prefix_json) ||
+      (parent->system_prompt_json && !client->system_prompt_json)) {
+    fprintf(stderr, "[ERROR] Failed to clone gemini client.\n");
+    gemini_client_destroy(client);
+    return NULL;
+  }
+
+  return client;
+}
+
+int gemini_client_set_system_prompt(GeminiClient *client,
+                                    const char *system_prompt) {
+  size_t len = strlen(system_prompt) + 64;
+  char *prefix = malloc(len);
+  if (!prefix)
+    return -1;
+
+  snprintf(prefix, len, "System Prompt: %s\nUser Prompt: ", system_prompt);
+
+  free(client->prompt_prefix_json);
+  client->prompt_prefix_json =
+      json_escape(prefix, &client->prompt_prefix_json_len);
+  free(prefix);
+
+  free(client->system_prompt_json);
+  client->system_prompt_json =
+      json_escape(system_prompt, &client->system_prompt_json_len);
+
+  return client->prompt_prefix_json && client->system_prompt_json ? 0 : -1;
+}
+
+int gemini_client_set_ca_bundle(GeminiClient *client, const char *path) {
+  char *bundle = exe_relative_path(path);
+  if (!bundle)
+    return -1;
+
+  FILE *fptr = fopen(bundle, "rb");
+  if (!fptr) {
+    free(bundle);
+    return -1;
+  }
+  fclose(fptr);
+
+  free(client->ca_bundle);
+  client->ca_bundle = bundle;
+
+  return 0;
+}
+
+void gemini_client_prepare(GeminiClient *client, CURL *curl) {
+  // curl_easy_reset keeps the live connections, DNS and session caches of
+  // the handle but clears every option, including CURLOPT_SHARE
+  curl_easy_reset(curl);
+
+  if (client->share)
+    curl_easy_setopt(curl, CURLOPT_SHARE, client->share);
+
+  curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, client->dns_pin_s);
+  if (client->resolve)
+    curl_easy_setopt(curl, CURLOPT_RESOLVE, client->resolve);
+
+  // "" offers every encoding this libcurl decodes (gzip, deflate and br or
+  // zstd when built in), JSON answers shrink several times on the wire
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+
+  curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 5000L);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
+  curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+  // a file rather than CURLOPT_CAINFO_BLOB: libcurl caches the store it
+  // parsed from a file in the multi handle the transfer runs on (an easy
+  // handle's own when it runs alone) for the next handshakes there, a blob
+  // is parsed again on every one. a fresh handle or multi handle parses the
+  // file again, hence client->multi. the cache is skipped while a CA
+  // directory is set too, and builds often default to one
+  if (client->ca_bundle) {
+    curl_easy_setopt(curl, CURLOPT_CAINFO, client->ca_bundle);
+    curl_easy_setopt(curl, CURLOPT_CA_CACHE_TIMEOUT, GEMINI_CLIENT_CA_CACHE_S);
+    curl_easy_setopt(curl, CURLOPT_CAPATH, NULL);
+  }
+
+  if (client->cancel) {
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, cancel_check);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void *)client->cancel);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+  }
+}
+
+char *gemini_client_compress_body(GeminiClient *client, TransportRequest *req) {
+  req->plain_len = 0;
+  if (!client->gzip_request_bytes || !req->body ||
+      req->body_len < client->gzip_request_bytes)
+    return NULL;
+
+  size_t gzip_len = 0;
+  char *gzip = gzip_compress(req->body, req->body_len, GZIP_DEFAULT_LEVEL,
+                             &gzip_len);
+  if (!gzip)
+    return NULL;
+
+  req->headers = curl_slist_append(req->headers, "Content-Encoding: gzip");
+  req->plain_len = req->body_len;
+  req->body = gzip;
+  req->body_len = gzip_len;
+
+  return gzip;
+}
+
+size_t gemini_client_prompt_bytes(GeminiClient *client, const char *prompt) {
+  size_t bytes = strlen(prompt);
+  if (client->conversation)
+    bytes += client->conversation->tokens * CONVERSATION_BYTES_PER_TOKEN;
+
+  return bytes;
+}
+
+bool gemini_client_within_budget(GeminiClient *client, size_t body_len) {
+  if (!client->usage)
+    return true;
+
+  const char *user = client->user ? client->user : "guest";
+  if (body_len > client->inline_bytes)
+    body_len -= client->inline_bytes;
+  long long estimate = (long long)(body_len / CONVERSATION_BYTES_PER_TOKEN);
+  if (token_ledger_allow(client->usage, user, estimate))
+    return true;
+
+  fprintf(stderr,
+          "[ERROR] Daily budget of %lld tokens reached for %s (%lld used "
+          "today), request not sent.\n",
+          token_ledger_budget(client->usage, user),
+          user, token_ledger_used_today(client->usage, user));
+
+  return false;
+}
+
+void gemini_client_account(GeminiClient *client, const char *feature,
+                           const TokenUsage *usage) {
+  if (!feature)
+    feature = client->feature ? client->feature : "prompt";
+
+  token_ledger_add(client->usage, client->user ? client->user : "guest",
+                   feature, usage);
+}
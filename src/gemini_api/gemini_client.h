@@ -0,0 +1,170 @@
+#ifndef GEMINICLIENT_H
+#define GEMINICLIENT_H
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../stats/token_usage.h"
+#include "../types/types.h"
+#include "../utils/gzip.h"
+#include "../utils/json_writer.h"
+#include "../utils/exe_path.h"
+#include "attachment_plan.h"
+#include "conversation.h"
+#include "request_policy.h"
+
+struct ContextCache;
+struct ModelRouter;
+struct StructuredType;
+
+// how long resolved addresses stay in the shared DNS cache by default,
+// libcurl's own default
+#define GEMINI_CLIENT_DEFAULT_DNS_PIN_S 60
+// root certificates, relative to the executable's directory
+#define GEMINI_CLIENT_DEFAULT_CA_BUNDLE "../cacert-2025-09-09.pem"
+// how long a multi handle (an easy handle's own while it runs alone) keeps
+// the parsed root certificates for its next handshakes, libcurl's default
+#define GEMINI_CLIENT_CA_CACHE_S 86400L
+
+// long-lived state shared by every gemini_api call, create it once at startup
+// so DNS lookups, TLS sessions and open connections survive between prompts
+typedef struct GeminiClient {
+  CURLSH *share;
+  pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+  bool is_clone; // borrows the parent's share and policy, see below
+
+  // one reusable easy handle per endpoint, reset before each call
+  CURL *api_handle;    // generateContent
+  CURL *upload_handle; // resumable upload start
+  CURL *file_handle;   // upload, finalize
+  // runs hedged calls and concurrent uploads. libcurl keeps the parsed CA
+  // store and the open connections per multi handle, so it lives as long
+  // as the client instead of one per call
+  CURLM *multi;
+
+  char *api_url;
+  char *stream_url; // api_url pointed at streamGenerateContent?alt=sse
+  char *batch_url;  // api_url pointed at batchGenerateContent
+  char *file_url;
+  char *api_root; // ".../v1beta/", base for files/<id> and other resources
+  char *api_key;
+  char auth_header[512]; // "x-goog-api-key: <key>"
+
+  // resolved addresses are pinned in the shared DNS cache this long, -1
+  // for ever. the connection warmup re-resolves them before they run out
+  long dns_pin_s;
+  // fixed "host:port:address" entries (CURLOPT_RESOLVE), owned by the
+  // parent, NULL to resolve normally
+  struct curl_slist *resolve;
+  // absolute path of the PEM root certificates set by
+  // gemini_client_set_ca_bundle(), owned by the parent. NULL leaves
+  // libcurl's built-in CA file
+  char *ca_bundle;
+
+  // request bodies at least this long go out gzipped, 0 never. responses
+  // are always asked for compressed, see gemini_client_prepare()
+  size_t gzip_request_bytes;
+
+  // attachments up to this size are sent base64 inline instead of through
+  // the File API, 0 uploads all of them. inline ones together stay within
+  // request_limit, the largest generate body the API takes
+  size_t inline_attachment_bytes;
+  size_t request_limit;
+
+  // "System Prompt: <prompt>\nUser Prompt: " escaped once at startup
+  char *prompt_prefix_json;
+  size_t prompt_prefix_json_len;
+  // the system prompt alone, for a cache's systemInstruction
+  char *system_prompt_json;
+  size_t system_prompt_json_len;
+  JsonWriter body; // generateContent body, reused by every request
+
+  RequestPolicy *policy; // deadlines, retries and hedging of every call
+  Transport *transport;  // libcurl unless recording or replaying
+  struct ContextCache *context_cache; // system prompt and files kept server
+                                      // side, see context_cache.h
+  // picks a model per generate call and falls back on failures, owned by
+  // whoever set it. NULL always asks api_url
+  struct ModelRouter *router;
+  // api_url of the model the last generate answer came from, NULL when
+  // none did. a route's answer can then be told from the primary's
+  const char *answered_url;
+
+  // generate calls are checked against user's daily token budget before
+  // they go out and their usageMetadata is booked under user and feature.
+  // the ledger is shared with clones, NULL accounts nothing
+  TokenLedger *usage;
+  const char *user;    // "guest" unless someone logged in
+  const char *feature; // set by the caller per call, NULL for "prompt"
+  // who waits on this client's generate calls, set by the caller per call
+  RequestPriority priority;
+
+  // while set and non-zero, every transfer of this client aborts with
+  // CURLE_ABORTED_BY_CALLBACK, see gemini_client_prepare()
+  volatile int *cancel;
+  // while set, generate requests carry its turns before the prompt
+  Conversation *conversation;
+  // while set, generate requests carry these parts before the file uris
+  const InlinePart *inline_parts;
+  size_t inline_count;
+  size_t inline_bytes; // their share of the body, kept out of estimates
+  // while set, generate requests ask for a JSON array of this type instead
+  // of prose, see gemini_request_structured()
+  const struct StructuredType *response_type;
+} GeminiClient;
+
+GeminiClient *gemini_client_create(const char *api_url, const char *file_url,
+                                   const char *api_key);
+void gemini_client_destroy(GeminiClient *client);
+
+// a client with its own handles and body buffer for another thread, sharing
+// the parent's DNS and TLS session caches, policy, transport and context
+// cache. its handles keep their own connections. destroy it first
+GeminiClient *gemini_client_clone(GeminiClient *parent);
+
+// ".../models/x:generateContent?k=v" -> ".../models/x:streamGenerateContent
+// ?alt=sse&k=v", the SSE variant takes the same body. NULL without a
+// :generateContent method
+char *gemini_stream_url(const char *api_url);
+
+// sent ahead of every user prompt, escaped here once instead of per request
+int gemini_client_set_system_prompt(GeminiClient *client,
+                                    const char *system_prompt);
+
+// verifies peers against the PEM bundle at path, relative paths resolved
+// against the executable's directory so the working directory doesn't
+// matter. call before cloning. returns -1 (keeping the previous bundle)
+// when it can't be opened
+int gemini_client_set_ca_bundle(GeminiClient *client, const char *path);
+
+// resets a handle owned by the client (or a fresh one) and applies the
+// options every request shares: share handle, DNS pins, compressed
+// responses, timeouts, CA bundle
+// and the cancel check
+void gemini_client_prepare(GeminiClient *client, CURL *curl);
+
+// gzips req's in-memory body when it reaches client->gzip_request_bytes and
+// appends Content-Encoding to req->headers (which must not be NULL). returns
+// the buffer req->body now points into, free it once the call is done, or
+// NULL when the body goes as it is
+char *gemini_client_compress_body(GeminiClient *client, TransportRequest *req);
+
+// the question plus the earlier turns going with it, what the router sizes
+// a request by
+size_t gemini_client_prompt_bytes(GeminiClient *client, const char *prompt);
+
+// false, after saying so, when a request body of body_len bytes would take
+// the user past today's token budget. attachments, inline ones included,
+// are not in the estimate
+bool gemini_client_within_budget(GeminiClient *client, size_t body_len);
+
+// books an answer's usage under the client's user and feature, or under
+// feature when it is not NULL
+void gemini_client_account(GeminiClient *client, const char *feature,
+                           const TokenUsage *usage);
+
+#endif
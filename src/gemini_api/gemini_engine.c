@@ -0,0 +1,366 @@
+#include "gemini_engine.h"
+
+static bool job_finished(GeminiJobStatus status) {
+  return status == GEMINI_JOB_DONE || status == GEMINI_JOB_FAILED ||
+         status == GEMINI_JOB_CANCELLED;
+}
+
+// engine lock held
+static void job_finish(GeminiEngine *engine, GeminiJob *job,
+                       GeminiJobStatus status) {
+  job->status = status;
+  pthread_cond_broadcast(&engine->done);
+}
+
+// what inline attachments may add to the body once the prompt, system
+// prompt and earlier turns are in, with room for the framing around them
+static size_t inline_budget(GeminiClient *client, GeminiJob *job) {
+  size_t text = strlen(job->prompt) + client->prompt_prefix_json_len +
+                client->system_prompt_json_len + 4096;
+  if (job->conversation)
+    text += job->conversation->tokens * CONVERSATION_BYTES_PER_TOKEN;
+
+  return client->request_limit > text ? client->request_limit - text : 0;
+}
+
+// small attachments go inline, the rest are uploaded, then ask, all on the
+// worker's own client
+static void job_run(GeminiWorker *worker, GeminiJob *job) {
+  GeminiClient *client = worker->client;
+  GeminiEngine *engine = worker->engine;
+
+  client->cancel = &job->cancel;
+  client->conversation = job->conversation;
+  client->feature = job->feature;
+  client->priority = job->priority;
+
+  int file_count = 0;
+  char **file_uris = NULL;
+  char **file_mime_types = NULL;
+
+  AttachmentPlan plan = {0};
+  if (job->path_count > 0 &&
+      attachment_plan_build(&plan, job->paths, job->path_count,
+                            client->inline_attachment_bytes,
+                            inline_budget(client, job)) != 0)
+    fprintf(stderr, "[ERROR] Out of memory planning %zu attachments.\n",
+            job->path_count);
+
+  client->inline_parts = plan.inline_parts;
+  client->inline_count = plan.inline_count;
+  client->inline_bytes = plan.inline_bytes;
+
+  if (plan.upload_count > 0) {
+    // the uploads take the front slots, upload_files matches hashes by
+    // position. positions only move forward, so this is safe in place
+    const char **upload_paths = malloc(plan.upload_count * sizeof(char *));
+    for (size_t i = 0; upload_paths && i < plan.upload_count; i++) {
+      upload_paths[i] = job->paths[plan.upload_index[i]];
+      memmove(job->files[i].hash, job->files[plan.upload_index[i]].hash,
+              sizeof(job->files[i].hash));
+    }
+
+    // every file's start and upload requests run concurrently, files
+    // uploaded before are served from the local cache
+    if (upload_paths)
+      file_count = upload_files(client, engine->file_cache, upload_paths,
+                                plan.upload_count, engine->upload_concurrency,
+                                job->files);
+    free(upload_paths);
+
+    file_uris = malloc((file_count + 1) * sizeof(char *));
+    file_mime_types = malloc((file_count + 1) * sizeof(char *));
+    if (!file_uris || !file_mime_types)
+      file_count = 0;
+
+    for (int i = 0; i < file_count; i++) {
+      file_uris[i] = job->files[i].uri;
+      file_mime_types[i] = (char *)job->files[i].mime;
+    }
+  }
+
+  if (!job->cancel) {
+    bool query_with_file = file_count > 0;
+
+    if (job->stream) {
+      job->response = gemini_request_stream(
+          client, query_with_file ? file_uris : NULL, job->prompt,
+          query_with_file ? file_mime_types : NULL, file_count,
+          job->on_first_chunk, job->on_first_chunk_arg, &job->complete);
+    } else {
+      job->response = gemini_request(
+          client, query_with_file ? file_uris : NULL, job->prompt,
+          query_with_file ? file_mime_types : NULL, file_count);
+      job->complete = job->response != NULL;
+    }
+    if (job->response && client->answered_url)
+      job->model_url = strdup(client->answered_url);
+  }
+
+  client->cancel = NULL;
+  client->conversation = NULL;
+  client->feature = NULL;
+  client->priority = REQUEST_PRIORITY_INTERACTIVE;
+  client->inline_parts = NULL;
+  client->inline_count = 0;
+  client->inline_bytes = 0;
+
+  attachment_plan_free(&plan);
+  free(file_uris);
+  free(file_mime_types);
+}
+
+static void *worker_main(void *arg) {
+  GeminiWorker *worker = (GeminiWorker *)arg;
+  GeminiEngine *engine = worker->engine;
+
+  pthread_mutex_lock(&engine->lock);
+  while (1) {
+    while (!engine->head && !engine->stopping) {
+      pthread_cond_wait(&engine->work, &engine->lock);
+    }
+    if (!engine->head)
+      break;
+
+    GeminiJob *job = engine->head;
+    engine->head = job->next;
+    if (!engine->head)
+      engine->tail = NULL;
+    job->next = NULL;
+
+    job->status = GEMINI_JOB_RUNNING;
+    worker->job = job;
+    pthread_mutex_unlock(&engine->lock);
+
+    job_run(worker, job);
+
+    // a cancelled stream can still hold the partial answer, drop it
+    GeminiJobStatus status = GEMINI_JOB_DONE;
+    if (job->cancel) {
+      status = GEMINI_JOB_CANCELLED;
+      free(job->response);
+      job->response = NULL;
+      job->complete = false;
+    } else if (!job->response) {
+      status = GEMINI_JOB_FAILED;
+    }
+
+    // the job is still RUNNING for pollers, so on_done can use it freely
+    if (job->on_done)
+      job->on_done(job, job->on_done_arg);
+
+    pthread_mutex_lock(&engine->lock);
+    worker->job = NULL;
+    job_finish(engine, job, status);
+  }
+  pthread_mutex_unlock(&engine->lock);
+
+  return NULL;
+}
+
+GeminiEngine *gemini_engine_create(GeminiClient *client, FileCache *file_cache,
+                                   int worker_count, int upload_concurrency) {
+  if (!client)
+    return NULL;
+
+  if (worker_count < 1)
+    worker_count = GEMINI_ENGINE_DEFAULT_WORKERS;
+
+  GeminiEngine *engine = calloc(1, sizeof(GeminiEngine));
+  if (!engine)
+    return NULL;
+
+  engine->file_cache = file_cache;
+  engine->upload_concurrency = upload_concurrency;
+  pthread_mutex_init(&engine->lock, NULL);
+  pthread_cond_init(&engine->work, NULL);
+  pthread_cond_init(&engine->done, NULL);
+
+  engine->workers = calloc(worker_count, sizeof(GeminiWorker));
+  if (!engine->workers) {
+    gemini_engine_destroy(engine);
+    return NULL;
+  }
+
+  for (int i = 0; i < worker_count; i++) {
+    GeminiWorker *worker = &engine->workers[i];
+    worker->engine = engine;
+    worker->client = gemini_client_clone(client);
+    if (!worker->client ||
+        pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+      fprintf(stderr, "[ERROR] Failed to start request worker %d.\n", i);
+      gemini_client_destroy(worker->client);
+      worker->client = NULL;
+      break;
+    }
+    engine->worker_count++;
+  }
+
+  if (engine->worker_count == 0) {
+    gemini_engine_destroy(engine);
+    return NULL;
+  }
+
+  return engine;
+}
+
+void gemini_engine_destroy(GeminiEngine *engine) {
+  if (!engine)
+    return;
+
+  pthread_mutex_lock(&engine->lock);
+  engine->stopping = true;
+
+  for (GeminiJob *job = engine->head; job; job = job->next) {
+    job->cancel = 1;
+    job_finish(engine, job, GEMINI_JOB_CANCELLED);
+  }
+  engine->head = NULL;
+  engine->tail = NULL;
+
+  for (int i = 0; i < engine->worker_count; i++) {
+    if (engine->workers[i].job)
+      engine->workers[i].job->cancel = 1;
+  }
+
+  pthread_cond_broadcast(&engine->work);
+  pthread_mutex_unlock(&engine->lock);
+
+  for (int i = 0; i < engine->worker_count; i++) {
+    pthread_join(engine->workers[i].thread, NULL);
+    gemini_client_destroy(engine->workers[i].client);
+  }
+
+  pthread_cond_destroy(&engine->work);
+  pthread_cond_destroy(&engine->done);
+  pthread_mutex_destroy(&engine->lock);
+  free(engine->workers);
+  free(engine);
+}
+
+GeminiJob *gemini_job_create(const char *prompt, const char **paths,
+                             const GeminiFile *files, size_t path_count) {
+  GeminiJob *job = calloc(1, sizeof(GeminiJob));
+  if (!job)
+    return NULL;
+
+  job->prompt = strdup(prompt);
+  job->path_count = path_count;
+  job->paths = malloc((path_count + 1) * sizeof(char *));
+  job->files = calloc(path_count + 1, sizeof(GeminiFile));
+
+  if (!job->prompt || !job->paths || !job->files) {
+    gemini_job_free(job);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < path_count; i++) {
+    job->paths[i] = paths[i];
+    if (files)
+      memcpy(job->files[i].hash, files[i].hash, sizeof(job->files[i].hash));
+  }
+
+  return job;
+}
+
+void gemini_engine_submit(GeminiEngine *engine, GeminiJob *job) {
+  pthread_mutex_lock(&engine->lock);
+  job->engine = engine;
+
+  if (engine->stopping) {
+    job_finish(engine, job, GEMINI_JOB_CANCELLED);
+    pthread_mutex_unlock(&engine->lock);
+    return;
+  }
+
+  job->status = GEMINI_JOB_QUEUED;
+  job->next = NULL;
+  if (engine->tail)
+    engine->tail->next = job;
+  else
+    engine->head = job;
+  engine->tail = job;
+
+  pthread_cond_signal(&engine->work);
+  pthread_mutex_unlock(&engine->lock);
+}
+
+GeminiJobStatus gemini_job_poll(GeminiJob *job) {
+  GeminiEngine *engine = job->engine;
+  if (!engine)
+    return job->status;
+
+  pthread_mutex_lock(&engine->lock);
+  GeminiJobStatus status = job->status;
+  pthread_mutex_unlock(&engine->lock);
+
+  return status;
+}
+
+GeminiJobStatus gemini_job_wait(GeminiJob *job) {
+  GeminiEngine *engine = job->engine;
+  if (!engine)
+    return job->status;
+
+  pthread_mutex_lock(&engine->lock);
+  while (!job_finished(job->status)) {
+    pthread_cond_wait(&engine->done, &engine->lock);
+  }
+  GeminiJobStatus status = job->status;
+  pthread_mutex_unlock(&engine->lock);
+
+  return status;
+}
+
+void gemini_job_cancel(GeminiJob *job) {
+  GeminiEngine *engine = job->engine;
+  job->cancel = 1;
+  if (!engine)
+    return;
+
+  pthread_mutex_lock(&engine->lock);
+  if (job->status == GEMINI_JOB_QUEUED) {
+    GeminiJob **link = &engine->head;
+    GeminiJob *prev = NULL;
+    while (*link && *link != job) {
+      prev = *link;
+      link = &(*link)->next;
+    }
+    if (*link) {
+      *link = job->next;
+      if (engine->tail == job)
+        engine->tail = prev;
+      job->next = NULL;
+    }
+    job_finish(engine, job, GEMINI_JOB_CANCELLED);
+  }
+  pthread_mutex_unlock(&engine->lock);
+}
+
+char *gemini_job_take_response(GeminiJob *job) {
+  if (gemini_job_poll(job) != GEMINI_JOB_DONE)
+    return NULL;
+
+  char *response = job->response;
+  job->response = NULL;
+
+  return response;
+}
+
+void gemini_job_free(GeminiJob *job) {
+  if (!job)
+    return;
+
+  if (job->files) {
+    for (size_t i = 0; i < job->path_count; i++) {
+      gemini_file_free(&job->files[i]);
+    }
+  }
+
+  free(job->prompt);
+  free(job->paths);
+  free(job->files);
+  free(job->response);
+  free(job->model_url);
+  free(job);
+}
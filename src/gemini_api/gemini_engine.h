@@ -0,0 +1,105 @@
+#ifndef GEMINIENGINE_H
+#define GEMINIENGINE_H
+
+#include "../cache/file_cache.h"
+#include "../types/types.h"
+#include "gemini_client.h"
+#include "gemini_request.h"
+#include "gemini_request_stream.h"
+#include "upload_files.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define GEMINI_ENGINE_DEFAULT_WORKERS 2
+
+typedef enum GeminiJobStatus {
+  GEMINI_JOB_QUEUED,
+  GEMINI_JOB_RUNNING,
+  GEMINI_JOB_DONE,   // response holds the answer
+  GEMINI_JOB_FAILED, // nothing came back
+  GEMINI_JOB_CANCELLED,
+} GeminiJobStatus;
+
+typedef struct GeminiJob GeminiJob;
+
+// one prompt with its attachments: inline or upload them, then generate
+struct GeminiJob {
+  char *prompt;
+  const char **paths; // own array, the strings must outlive the job
+  GeminiFile *files;  // path_count slots, hashes copied in, uploads out
+  size_t path_count;
+
+  // set between gemini_job_create() and gemini_engine_submit()
+  bool stream;
+  void (*on_first_chunk)(void *arg); // streaming only, worker thread
+  void *on_first_chunk_arg;
+  void (*on_done)(GeminiJob *job, void *arg); // worker thread, before the
+  void *on_done_arg;                          // status turns final
+  Conversation *conversation; // earlier turns to send, must not change
+                              // until the job is final
+  const char *feature; // what its tokens are booked under, NULL: "prompt"
+  RequestPriority priority; // interactive unless set
+
+  volatile int cancel;
+  GeminiJobStatus status; // read it with gemini_job_poll()
+  char *response;
+  bool complete; // response is the whole answer, not a cut off stream
+  char *model_url; // api_url of the model that answered, NULL if none did
+
+  struct GeminiEngine *engine;
+  GeminiJob *next;
+};
+
+typedef struct GeminiWorker {
+  pthread_t thread;
+  GeminiClient *client; // a clone, so workers never share easy handles
+  GeminiJob *job;       // running job, NULL while idle
+  struct GeminiEngine *engine;
+} GeminiWorker;
+
+// a queue of jobs drained by worker threads, the UI submits and polls
+typedef struct GeminiEngine {
+  FileCache *file_cache;
+  int upload_concurrency;
+
+  pthread_mutex_t lock;
+  pthread_cond_t work; // a job was queued or the engine is stopping
+  pthread_cond_t done; // a job reached a final status
+  GeminiJob *head;
+  GeminiJob *tail;
+  bool stopping;
+
+  GeminiWorker *workers;
+  int worker_count;
+} GeminiEngine;
+
+// clones client once per worker, so set the system prompt before this
+GeminiEngine *gemini_engine_create(GeminiClient *client, FileCache *file_cache,
+                                   int worker_count, int upload_concurrency);
+// cancels everything still queued or running and joins the workers
+void gemini_engine_destroy(GeminiEngine *engine);
+
+// files may be NULL, else its hashes (if set) are reused for the uploads
+GeminiJob *gemini_job_create(const char *prompt, const char **paths,
+                             const GeminiFile *files, size_t path_count);
+// hands the job to the engine, it stays the caller's to free once final
+void gemini_engine_submit(GeminiEngine *engine, GeminiJob *job);
+
+// current status, never blocks
+GeminiJobStatus gemini_job_poll(GeminiJob *job);
+// blocks until the job is done, failed or cancelled
+GeminiJobStatus gemini_job_wait(GeminiJob *job);
+
+// a queued job is dropped right away, a running one aborts its transfers
+void gemini_job_cancel(GeminiJob *job);
+
+// the answer, the caller frees it. NULL unless the job is done. a
+// streamed one cut off mid-way comes with job->complete false
+char *gemini_job_take_response(GeminiJob *job);
+
+// only once the status is final (or the job was never submitted)
+void gemini_job_free(GeminiJob *job);
+
+#endif
@@ -1,99 +1,208 @@
 #include "gemini_request.h"
 
-char *gemini_request(char *gemini_url, char **file_uris, char *gemini_api_key,
-                     char *fullPrompt, char **file_mime_types, int file_count) {
-  Memory mem = {malloc(1), 0};
-
-  cJSON *req_body_json = cJSON_CreateObject();
-  cJSON *contents = cJSON_CreateArray();
-  cJSON_AddItemToObject(req_body_json, "contents", contents);
-
-  cJSON *content = cJSON_CreateObject();
-  cJSON_AddItemToArray(contents, content);
-  cJSON *parts = cJSON_CreateArray();
-  cJSON_AddItemToObject(content, "parts", parts);
-
-  for (size_t i = 0; i < file_count; i++) {
-    cJSON *part_file = cJSON_CreateObject();
-    cJSON *file_data = cJSON_CreateObject();
-    cJSON_AddItemToObject(part_file, "file_data", file_data);
-    cJSON_AddStringToObject(file_data, "mime_type", file_mime_types[i]);
-    cJSON_AddStringToObject(file_data, "file_uri", file_uris[i]);
-    cJSON_AddItemToArray(parts, part_file);
+// one generateContent call to url. a rejected cached_content sets *stale
+// instead of reporting, the caller asks again without it. *final is set
+// when no other model should be asked either: the request went through and
+// was refused (4xx), came back without text (a safety block) or too big.
+// only transport errors, 408, 429 and 5xx are the model's fault.
+// *first_byte_ms is how long the answer that was kept took to start
+static char *request_once(GeminiClient *client, const char *url,
+                          char **file_uris, char *prompt,
+                          char **file_mime_types, int file_count,
+                          const char *cached_content, bool *stale,
+                          bool *final, long *first_byte_ms) {
+  *first_byte_ms = -1;
+
+  size_t req_body_len = 0;
+  const char *req_body_json_str =
+      build_request_body(client, file_uris, prompt, file_mime_types,
+                         file_count, cached_content, &req_body_len);
+  if (!req_body_json_str)
+    return NULL;
+  if (!gemini_client_within_budget(client, req_body_len)) {
+    *final = true;
+    return NULL;
   }
 
-  cJSON *part_text = cJSON_CreateObject();
-  cJSON_AddStringToObject(part_text, "text", fullPrompt);
-  cJSON_AddItemToArray(parts, part_text);
+  Memory mem;
+  memory_init(&mem);
+  // a big body goes to a temp file instead of a doubling heap buffer, a
+  // runaway one aborts the transfer
+  mem.spill_at = memory_spill_at();
+  mem.limit = memory_limit();
 
-  char *req_body_json_str = cJSON_Print(req_body_json);
-
-  CURL *curl = curl_easy_init();
+  CURL *curl = client->api_handle;
   if (curl) {
     struct curl_slist *list = NULL;
-    char api_key[512];
-    char *header_name = "x-goog-api-key:";
     char *content_type = "Content-Type: application/json";
 
-    snprintf(api_key, sizeof(api_key), "%s %s", header_name, gemini_api_key);
-
-    list = curl_slist_append(list, api_key);
+    list = curl_slist_append(list, client->auth_header);
     list = curl_slist_append(list, content_type);
 
-    curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 5000L);
-    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
-    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
-
-    // verbose logging
-    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-
-    curl_easy_setopt(curl, CURLOPT_URL, gemini_url);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req_body_json_str);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE,
-                     (long)strlen(req_body_json_str));
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&mem);
-
-    curl_easy_setopt(curl, CURLOPT_CAINFO, "../cacert-2025-09-09.pem");
-
-    curl_easy_perform(curl);
+    gemini_client_prepare(client, curl);
+
+    RequestCall call = {0};
+    call.request.endpoint = "generate";
+    call.priority = client->priority;
+    call.request.url = url;
+    call.request.headers = list;
+    call.request.body = req_body_json_str;
+    call.request.body_len = req_body_len;
+    char *gzip_body = gemini_client_compress_body(client, &call.request);
+    call.request.on_body = write_callback;
+    call.request.body_data = (void *)&mem;
+    call.body = &mem;
+
+    // generating twice is safe, so slow calls may be hedged
+    call.hedge = true;
+    call.multi = client->multi;
+    call.latency = client->policy ? &client->policy->generate_latency : NULL;
+
+    CURLcode res = request_perform(client->transport, client->policy,
+                                   client->cancel, curl, &call);
+    *first_byte_ms = call.first_byte_ms;
 
     // printf("%s\n", mem.response);
 
-    cJSON *mem_res = cJSON_Parse(mem.response);
-    cJSON *candidates = cJSON_GetObjectItemCaseSensitive(mem_res, "candidates");
-    cJSON *first_candidate = cJSON_GetArrayItem(candidates, 0);
-    cJSON *content_obj =
-        cJSON_GetObjectItemCaseSensitive(first_candidate, "content");
-    cJSON *parts_obj = cJSON_GetObjectItemCaseSensitive(content_obj, "parts");
-    cJSON *first_part = cJSON_GetArrayItem(parts_obj, 0);
-    cJSON *text = cJSON_GetObjectItemCaseSensitive(first_part, "text");
-
-    // printf("im here\n");
+    // in place, mapped from disk when it was spilled
+    const char *body = memory_body(&mem);
+    size_t body_len = body ? memory_body_len(&mem) : 0;
+    if (!body)
+      body = "";
 
+    // the answer can be split over several parts, take them all
     char *gemini_response = NULL;
-    char *cleaned_text = replace_escaped_ansi(text->valuestring);
-    gemini_response = strdup(cleaned_text);
+    char *text =
+        json_concat_text(body, body_len, "candidates[0].content.parts");
+
+    if (res == CURLE_ABORTED_BY_CALLBACK) {
+      // cancelled, nothing to report
+    } else if (memory_over_limit(&mem)) {
+      fprintf(stderr,
+              "[ERROR] Gemini response is over the %zu byte limit.\n",
+              mem.limit);
+      *final = true;
+    } else if (res != CURLE_OK) {
+      fprintf(stderr, "[ERROR] Request failed: %s\n", curl_easy_strerror(res));
+    } else if (cached_content && context_cache_rejected(call.status)) {
+      *stale = true;
+    } else if (call.status != 200) {
+      JsonSlice error_message;
+      char *message = NULL;
+      if (json_find(body, body_len, "error.message", &error_message) == 0)
+        message = json_slice_string(&error_message);
+
+      fprintf(stderr,
+              "[ERROR] Gemini returned HTTP %ld after %d attempt(s): %s\n",
+              call.status, call.attempts, message ? message : "(no message)");
+      free(message);
+      *final = !request_policy_retryable(res, call.status);
+    } else if (text) {
+      // JSON answers go to the decoder exactly as the model wrote them
+      if (client->response_type) {
+        gemini_response = text;
+        text = NULL;
+      } else {
+        gemini_response = replace_escaped_ansi(text);
+      }
+
+      TokenUsage usage;
+      if (token_usage_parse(body, body_len, "usageMetadata", &usage) == 0)
+        gemini_client_account(client, NULL, &usage);
+    } else {
+      JsonSlice error_message;
+      char *message = NULL;
+      if (json_find(body, body_len, "error.message", &error_message) == 0)
+        message = json_slice_string(&error_message);
+
+      fprintf(stderr, "[ERROR] Gemini response has no text: %s\n",
+              message ? message : "(no error message)");
+      free(message);
+      *final = true;
+    }
+    free(text);
 
     // printf("gemini_res: %s\n", gemini_response);
 
-    cJSON_Delete(mem_res);
-
-    free(req_body_json_str);
-    cJSON_Delete(req_body_json);
     curl_slist_free_all(list);
-    curl_easy_cleanup(curl);
-    free(mem.response);
-    free(cleaned_text);
+    free(gzip_body);
+    memory_release(&mem);
 
     return gemini_response;
   }
 
-  free(req_body_json_str);
-  cJSON_Delete(req_body_json);
-  free(mem.response);
-  curl_easy_cleanup(curl);
+  memory_release(&mem);
 
   return NULL;
 }
+
+// one model's answer. the context cache belongs to the api_url model, the
+// others get the files inline
+static char *request_model(GeminiClient *client, const char *url,
+                           char **file_uris, char *prompt,
+                           char **file_mime_types, int file_count,
+                           bool *final, long *first_byte_ms) {
+  // follow-ups about the same files only send the question
+  char cached_content[CONTEXT_CACHE_NAME_MAX];
+  bool cached = strcmp(url, client->api_url) == 0 &&
+                context_cache_acquire(client, file_uris, file_mime_types,
+                                      file_count, cached_content) == 0;
+
+  bool stale = false;
+  char *gemini_response =
+      request_once(client, url, file_uris, prompt, file_mime_types, file_count,
+                   cached ? cached_content : NULL, &stale, final,
+                   first_byte_ms);
+
+  // the cache expired or was deleted early, everything goes inline again
+  if (stale) {
+    context_cache_invalidate(client, cached_content);
+    gemini_response =
+        request_once(client, url, file_uris, prompt, file_mime_types,
+                     file_count, NULL, &stale, final, first_byte_ms);
+  }
+
+  return gemini_response;
+}
+
+char *gemini_request(GeminiClient *client, char **file_uris, char *prompt,
+                     char **file_mime_types, int file_count) {
+  ModelRouter *router = client->router;
+  int order[MODEL_ROUTER_MAX_MODELS];
+  size_t prompt_bytes = gemini_client_prompt_bytes(client, prompt);
+  bool attachments = file_count > 0 || client->inline_count > 0;
+  int count = model_router_plan(router, prompt_bytes, attachments, order);
+  bool final = false;
+  long first_byte_ms = -1;
+  client->answered_url = NULL;
+
+  if (count == 0) {
+    char *gemini_response =
+        request_model(client, client->api_url, file_uris, prompt,
+                      file_mime_types, file_count, &final, &first_byte_ms);
+    if (gemini_response)
+      client->answered_url = client->api_url;
+    return gemini_response;
+  }
+
+  // best model first, the next one only when it failed outright
+  char *gemini_response = NULL;
+  for (int i = 0; i < count && !gemini_response && !final; i++) {
+    ModelRoute *route = &router->routes[order[i]];
+    if (i > 0)
+      fprintf(stderr, "[INFO] Asking %s instead\n", route->name);
+
+    gemini_response = request_model(client, route->api_url, file_uris, prompt,
+                                    file_mime_types, file_count, &final,
+                                    &first_byte_ms);
+    if (client->cancel && *client->cancel)
+      break;
+    if (!final)
+      model_router_record(router, order[i], gemini_response != NULL,
+                          first_byte_ms);
+    if (gemini_response)
+      client->answered_url = route->api_url;
+  }
+
+  return gemini_response;
+}
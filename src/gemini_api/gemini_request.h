@@ -3,13 +3,21 @@
 
 #include "../callbacks/write_callback.h"
 #include "../types/types.h"
+#include "build_request_body.h"
+#include "context_cache.h"
+#include "gemini_client.h"
+#include "model_router.h"
+#include "request_policy.h"
+#include "../utils/json_extract.h"
 #include "../utils/replace_escaped_ansii.h"
 
-#include <cjson/cJSON.h>
 #include <curl/curl.h>
+#include <stdbool.h>
 #include <stdlib.h>
 
-char *gemini_request(char *gemini_url, char **file_uris, char *gemini_api_key,
-                     char *fullPrompt, char **file_mime_types, int file_count);
+// answers prompt with the client's router picking the model (api_url
+// without one), the next best model is asked when one fails
+char *gemini_request(GeminiClient *client, char **file_uris, char *prompt,
+                     char **file_mime_types, int file_count);
 
 #endif
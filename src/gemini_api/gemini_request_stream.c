@@ -0,0 +1,214 @@
+#include "gemini_request_stream.h"
+
+// a failed attempt printed nothing, start the next one from a clean state
+static void stream_reset(void *arg) {
+  SseStream *stream = (SseStream *)arg;
+
+  memory_clear(&stream->line);
+  memory_clear(&stream->event);
+  memory_clear(&stream->text);
+  memory_clear(&stream->usage);
+  stream->pending_len = 0;
+}
+
+// one streamGenerateContent call to url. a rejected cached_content sets
+// *stale instead of reporting, nothing was printed and the caller asks
+// again. *final is set when no other model should be asked either: the
+// request was refused (4xx) or answered without text (a safety block).
+// only transport errors, 408, 429 and 5xx are the model's fault. *complete
+// tells a finished answer from one cut off by an error or a cancel,
+// *first_byte_ms how long the transfer that was kept took to start
+static char *stream_once(GeminiClient *client, const char *url,
+                         char **file_uris, char *prompt,
+                         char **file_mime_types, int file_count,
+                         const char *cached_content,
+                         void (*on_first_chunk)(void *arg),
+                         void *on_first_chunk_arg, bool *stale, bool *final,
+                         bool *complete, long *first_byte_ms) {
+  *complete = false;
+  *first_byte_ms = -1;
+
+  size_t req_body_len = 0;
+  const char *req_body_json_str =
+      build_request_body(client, file_uris, prompt, file_mime_types,
+                         file_count, cached_content, &req_body_len);
+  if (!req_body_json_str)
+    return NULL;
+  if (!gemini_client_within_budget(client, req_body_len)) {
+    *final = true;
+    return NULL;
+  }
+
+  SseStream stream = {0};
+  memory_init(&stream.line);
+  memory_init(&stream.event);
+  memory_init(&stream.text);
+  memory_init(&stream.usage);
+  stream.on_first_chunk = on_first_chunk;
+  stream.on_first_chunk_arg = on_first_chunk_arg;
+
+  CURL *curl = client->api_handle;
+  struct curl_slist *list = NULL;
+  char *content_type = "Content-Type: application/json";
+  char *accept = "Accept: text/event-stream";
+
+  list = curl_slist_append(list, client->auth_header);
+  list = curl_slist_append(list, content_type);
+  list = curl_slist_append(list, accept);
+
+  gemini_client_prepare(client, curl);
+
+  RequestCall call = {0};
+  call.request.endpoint = "stream";
+  call.priority = client->priority;
+  call.request.url = url;
+  call.request.headers = list;
+  call.request.body = req_body_json_str;
+  call.request.body_len = req_body_len;
+  char *gzip_body = gemini_client_compress_body(client, &call.request);
+  call.request.on_body = sse_callback;
+  call.request.body_data = (void *)&stream;
+
+  // retried only while nothing has been printed, never hedged
+  call.committed = &stream.chunks;
+  call.on_retry = stream_reset;
+  call.on_retry_arg = &stream;
+
+  CURLcode res = request_perform(client->transport, client->policy,
+                                 client->cancel, curl, &call);
+  *first_byte_ms = call.first_byte_ms;
+
+  sse_stream_finish(&stream);
+
+  if (res != CURLE_OK && res != CURLE_ABORTED_BY_CALLBACK) {
+    fprintf(stderr, "\n[ERROR] Streaming request failed: %s\n",
+            curl_easy_strerror(res));
+  } else if (res == CURLE_OK && cached_content && stream.chunks == 0 &&
+             context_cache_rejected(call.status)) {
+    *stale = true;
+  } else if (res == CURLE_OK && call.status != 200) {
+    fprintf(stderr, "\n[ERROR] Gemini returned HTTP %ld after %d attempt(s)\n",
+            call.status, call.attempts);
+    *final = !request_policy_retryable(res, call.status);
+  } else if (res == CURLE_OK && stream.text.size == 0) {
+    *final = true;
+  }
+
+  // every event carries the counts so far, the last one the final ones.
+  // booked even when cancelled, what was generated is billed
+  TokenUsage usage;
+  if (token_usage_parse(stream.usage.response, stream.usage.size,
+                        "usageMetadata", &usage) == 0)
+    gemini_client_account(client, NULL, &usage);
+
+  char *gemini_response = NULL;
+  if (stream.text.size > 0) {
+    *complete = res == CURLE_OK && call.status == 200;
+    gemini_response = memory_detach(&stream.text);
+  } else {
+    memory_release(&stream.text);
+  }
+
+  curl_slist_free_all(list);
+  free(gzip_body);
+  memory_release(&stream.line);
+  memory_release(&stream.event);
+  memory_release(&stream.usage);
+
+  return gemini_response;
+}
+
+// one model's answer. the context cache belongs to the api_url model, the
+// others get the files inline
+static char *stream_model(GeminiClient *client, const char *url,
+                          char **file_uris, char *prompt,
+                          char **file_mime_types, int file_count,
+                          void (*on_first_chunk)(void *arg),
+                          void *on_first_chunk_arg, bool *final,
+                          bool *complete, long *first_byte_ms) {
+  // follow-ups about the same files only send the question
+  char cached_content[CONTEXT_CACHE_NAME_MAX];
+  bool cached = client->stream_url && strcmp(url, client->stream_url) == 0 &&
+                context_cache_acquire(client, file_uris, file_mime_types,
+                                      file_count, cached_content) == 0;
+
+  bool stale = false;
+  char *gemini_response = stream_once(
+      client, url, file_uris, prompt, file_mime_types, file_count,
+      cached ? cached_content : NULL, on_first_chunk, on_first_chunk_arg,
+      &stale, final, complete, first_byte_ms);
+
+  // the cache expired or was deleted early, everything goes inline again
+  if (stale) {
+    context_cache_invalidate(client, cached_content);
+    free(gemini_response);
+    gemini_response = stream_once(client, url, file_uris, prompt,
+                                  file_mime_types, file_count, NULL,
+                                  on_first_chunk, on_first_chunk_arg, &stale,
+                                  final, complete, first_byte_ms);
+  }
+
+  return gemini_response;
+}
+
+char *gemini_request_stream(GeminiClient *client, char **file_uris,
+                            char *prompt, char **file_mime_types,
+                            int file_count, void (*on_first_chunk)(void *arg),
+                            void *on_first_chunk_arg, bool *complete) {
+  bool finished = false;
+  if (!complete)
+    complete = &finished;
+  *complete = false;
+
+  ModelRouter *router = client->router;
+  int order[MODEL_ROUTER_MAX_MODELS];
+  size_t prompt_bytes = gemini_client_prompt_bytes(client, prompt);
+  bool attachments = file_count > 0 || client->inline_count > 0;
+  int count = model_router_plan(router, prompt_bytes, attachments, order);
+  bool final = false;
+  long first_byte_ms = -1;
+  client->answered_url = NULL;
+
+  if (count == 0 && !client->stream_url) {
+    fprintf(stderr, "[ERROR] GEMINI_API_URL has no :generateContent method "
+                    "to stream from.\n");
+    return NULL;
+  }
+
+  if (count == 0) {
+    char *gemini_response =
+        stream_model(client, client->stream_url, file_uris, prompt,
+                     file_mime_types, file_count, on_first_chunk,
+                     on_first_chunk_arg, &final, complete, &first_byte_ms);
+    if (gemini_response)
+      client->answered_url = client->api_url;
+    return gemini_response;
+  }
+
+  // best model first, the next one only when it failed before printing
+  // anything, a partial answer is returned as it is
+  char *gemini_response = NULL;
+  bool asked = false;
+  for (int i = 0; i < count && !gemini_response && !final; i++) {
+    ModelRoute *route = &router->routes[order[i]];
+    if (!route->stream_url)
+      continue;
+    if (asked)
+      fprintf(stderr, "[INFO] Asking %s instead\n", route->name);
+    asked = true;
+
+    gemini_response = stream_model(client, route->stream_url, file_uris,
+                                   prompt, file_mime_types, file_count,
+                                   on_first_chunk, on_first_chunk_arg, &final,
+                                   complete, &first_byte_ms);
+    if (client->cancel && *client->cancel)
+      break;
+    if (!final)
+      model_router_record(router, order[i], gemini_response != NULL,
+                          first_byte_ms);
+    if (gemini_response)
+      client->answered_url = route->api_url;
+  }
+
+  return gemini_response;
+}
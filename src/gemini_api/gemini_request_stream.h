@@ -0,0 +1,27 @@
+#ifndef GEMINIREQUESTSTREAM_H
+#define GEMINIREQUESTSTREAM_H
+
+#include "../callbacks/sse_callback.h"
+#include "../types/types.h"
+#include "build_request_body.h"
+#include "context_cache.h"
+#include "gemini_client.h"
+#include "model_router.h"
+#include "request_policy.h"
+
+#include <curl/curl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// same request as gemini_request() but over streamGenerateContent, text is
+// printed while it arrives and the whole cleaned answer is returned after,
+// on_first_chunk (optional) runs right before the first text is printed.
+// another model is only asked while nothing has been printed. what was
+// printed of an answer cut off by an error or a cancel is returned too,
+// with *complete (may be NULL) false, don't keep that one as the answer
+char *gemini_request_stream(GeminiClient *client, char **file_uris,
+                            char *prompt, char **file_mime_types,
+                            int file_count, void (*on_first_chunk)(void *arg),
+                            void *on_first_chunk_arg, bool *complete);
+
+#endif
@@ -0,0 +1,25 @@
+#include "gemini_request_structured.h"
+
+void *gemini_request_structured(GeminiClient *client,
+                                const StructuredType *type, char **file_uris,
+                                char *prompt, char **file_mime_types,
+                                int file_count, size_t *out_count) {
+  *out_count = 0;
+
+  client->response_type = type;
+  char *answer =
+      gemini_request(client, file_uris, prompt, file_mime_types, file_count);
+  client->response_type = NULL;
+
+  if (!answer)
+    return NULL;
+
+  void *items = structured_decode(type, answer, strlen(answer), out_count);
+  if (!items)
+    fprintf(stderr, "[ERROR] Gemini answer has no usable %s items.\n",
+            type->name);
+
+  free(answer);
+
+  return items;
+}
@@ -0,0 +1,28 @@
+#ifndef GEMINIREQUESTSTRUCTURED_H
+#define GEMINIREQUESTSTRUCTURED_H
+
+#include "../structured/structured_output.h"
+#include "gemini_client.h"
+#include "gemini_request.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// asks for a JSON array of type (responseMimeType application/json with its
+// responseSchema) and decodes the answer straight into type structs, e.g.
+//
+//   size_t count;
+//   Flashcard *cards = gemini_request_structured(client, &Flashcard_schema,
+//                                                uris, prompt, mimes, n,
+//                                                &count);
+//   ...
+//   structured_free(&Flashcard_schema, cards, count);
+//
+// routing, caching and budgets are those of gemini_request(). NULL with
+// *out_count 0 when the request failed or nothing decoded
+void *gemini_request_structured(GeminiClient *client,
+                                const StructuredType *type, char **file_uris,
+                                char *prompt, char **file_mime_types,
+                                int file_count, size_t *out_count);
+
+#endif
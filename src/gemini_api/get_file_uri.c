@@ -1,64 +1,299 @@
 #include "get_file_uri.h"
 
-char *get_file_uri(unsigned char *image_data, long int image_len,
-                   char *image_path, char *upload_url, char *gemini_api_key,
-                   char *file_mime_type) {
-  Memory mem = {malloc(1), 0};
+int file_upload_open(FileUpload *upload, const char *path) {
+  upload->fptr = fopen(path, "rb");
+  if (!upload->fptr)
+    return -1;
+
+  // curl's upload buffer is the only copy we need, skip stdio's
+  setvbuf(upload->fptr, NULL, _IONBF, 0);
+
+  upload->size = file_size(upload->fptr);
+  if (upload->size < 0) {
+    fclose(upload->fptr);
+    upload->fptr = NULL;
+    return -1;
+  }
+
+  upload->offset = 0;
+  upload->resumes = 0;
+  memory_init(&upload->headers);
+
+  return 0;
+}
+
+void file_upload_close(FileUpload *upload) {
+  if (upload->fptr)
+    fclose(upload->fptr);
+  upload->fptr = NULL;
+
+  memory_release(&upload->headers);
+}
+
+struct curl_slist *get_file_uri_prepare(GeminiClient *client, CURL *curl,
+                                        FileUpload *upload, Memory *mem,
+                                        TransportRequest *req) {
+  upload->chunk_len = upload->size - upload->offset;
+  if (upload->chunk_len > UPLOAD_CHUNK_SIZE)
+    upload->chunk_len = UPLOAD_CHUNK_SIZE;
+  upload->remaining = upload->chunk_len;
+  upload->finalize = upload->offset + upload->chunk_len == upload->size;
 
-  CURL *curl = curl_easy_init();
+  file_seek(upload->fptr, upload->offset);
+  memory_clear(&upload->headers);
 
   struct curl_slist *list = NULL;
-  char auth_header[512];
-  char *api_key = "x-goog-api-key:";
-  char *content_length = "Content-Length:";
-  char *upload_offset = "X-Goog-Upload-Offset: 0";
-  char *upload_command = "X-Goog-Upload-Command: upload, finalize";
+  char upload_offset[128];
+  char *upload_command = upload->finalize
+                             ? "X-Goog-Upload-Command: upload, finalize"
+                             : "X-Goog-Upload-Command: upload";
   char content_type[512];
-  char length[512];
 
-  snprintf(auth_header, sizeof(auth_header), "%s %s", api_key, gemini_api_key);
-  snprintf(length, sizeof(length), "%s %ld", content_length, image_len);
-  snprintf(content_type, sizeof(length), "%s %s",
-           "Content-Type:", file_mime_type);
+  snprintf(upload_offset, sizeof(upload_offset), "%s %lld",
+           "X-Goog-Upload-Offset:", upload->offset);
+  snprintf(content_type, sizeof(content_type), "%s %s",
+           "Content-Type:", upload->mime);
 
-  list = curl_slist_append(list, auth_header);
-  list = curl_slist_append(list, length);
+  list = curl_slist_append(list, client->auth_header);
   list = curl_slist_append(list, upload_offset);
   list = curl_slist_append(list, upload_command);
   list = curl_slist_append(list, content_type);
+  // libcurl sends Content-Length from POSTFIELDSIZE, no 100-continue wait
+  list = curl_slist_append(list, "Expect:");
 
-  curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 5000L);
-  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
-  curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+  gemini_client_prepare(client, curl);
+  request_policy_limit(client->policy, curl);
 
-  curl_easy_setopt(curl, CURLOPT_URL, upload_url);
-  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, image_data);
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)image_len);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&mem);
+  memset(req, 0, sizeof(TransportRequest));
+  req->url = upload->upload_url;
+  req->headers = list;
+  req->read = read_callback;
+  req->seek = seek_callback;
+  req->read_data = (void *)upload;
+  req->read_len = upload->chunk_len;
+  req->on_body = write_callback;
+  req->body_data = (void *)mem;
+  req->on_header = write_callback;
+  req->header_data = (void *)&upload->headers;
+  req->cancel = client->cancel;
+  req->endpoint = "upload";
+
+  return list;
+}
 
-  curl_easy_setopt(curl, CURLOPT_CAINFO, "../cacert-2025-09-09.pem");
+static UploadChunkResult retry_or_fail(FileUpload *upload) {
+  if (++upload->resumes > UPLOAD_MAX_RESUMES)
+    return UPLOAD_CHUNK_FAILED;
 
-  curl_easy_perform(curl);
+  return UPLOAD_CHUNK_RESUME;
+}
 
-  // printf("GET FILE URI:\n%s\n", mem.response);
+static int is_retryable_status(long status) {
+  return status == 0 || status == 408 || status == 429 || status >= 500;
+}
 
-  char *result_uri = NULL;
-  cJSON *parsed_json = cJSON_Parse(mem.response);
-  cJSON *file = cJSON_GetObjectItemCaseSensitive(parsed_json, "file");
-  // char *req_body_json_str = cJSON_Print(file);
-  // printf("im here uri: %s\n", req_body_json_str);
-  cJSON *uri = cJSON_GetObjectItemCaseSensitive(file, "uri");
-  result_uri = strdup(uri->valuestring);
+UploadChunkResult get_file_uri_chunk_result(FileUpload *upload,
+                                            CURLcode result, long status) {
+  if (result != CURLE_OK || is_retryable_status(status))
+    return retry_or_fail(upload);
 
-  // printf("im here uri: %s\n", uri->valuestring);
+  if (status != 200)
+    return UPLOAD_CHUNK_FAILED;
 
-  cJSON_Delete(parsed_json);
+  upload->offset += upload->chunk_len;
+  return upload->finalize ? UPLOAD_CHUNK_FINISHED : UPLOAD_CHUNK_NEXT;
+}
+
+struct curl_slist *get_upload_offset_prepare(GeminiClient *client, CURL *curl,
+                                             FileUpload *upload, Memory *mem,
+                                             TransportRequest *req) {
+  memory_clear(&upload->headers);
+
+  struct curl_slist *list = NULL;
+
+  list = curl_slist_append(list, client->auth_header);
+  list = curl_slist_append(list, "X-Goog-Upload-Command: query");
+
+  gemini_client_prepare(client, curl);
+  request_policy_limit(client->policy, curl);
+
+  memset(req, 0, sizeof(TransportRequest));
+  req->url = upload->upload_url;
+  req->headers = list;
+  req->body = "";
+  req->body_len = 0;
+  req->on_body = write_callback;
+  req->body_data = (void *)mem;
+  req->on_header = write_callback;
+  req->header_data = (void *)&upload->headers;
+  req->cancel = client->cancel;
+  req->endpoint = "upload_offset";
+
+  return list;
+}
+
+UploadChunkResult get_upload_offset_result(FileUpload *upload,
+                                           CURLcode result, long status) {
+  if (result != CURLE_OK || is_retryable_status(status))
+    return retry_or_fail(upload);
+
+  char *upload_status =
+      grep_header(upload->headers.response, "X-Goog-Upload-Status");
+  char *received =
+      grep_header(upload->headers.response, "X-Goog-Upload-Size-Received");
+
+  UploadChunkResult chunk_result = UPLOAD_CHUNK_FAILED;
+
+  if (upload_status && strcmp(upload_status, "final") == 0) {
+    upload->offset = upload->size;
+    chunk_result = UPLOAD_CHUNK_FINISHED;
+  } else if (received) {
+    long long offset = strtoll(received, NULL, 10);
+    if (offset >= 0 && offset <= upload->size) {
+      upload->offset = offset;
+      chunk_result = UPLOAD_CHUNK_NEXT;
+    }
+  }
+
+  free(upload_status);
+  free(received);
+
+  return chunk_result;
+}
+
+// a chunk or query request with a scheduler token around it like every
+// request_perform() attempt, so uploads keep to the endpoint's rate and
+// make way for interactive work. the queueing counts against the deadline
+static CURLcode upload_perform(GeminiClient *client, CURL *curl,
+                               TransportRequest *req) {
+  RequestScheduler *scheduler =
+      client->policy ? client->policy->scheduler : NULL;
+  long max_wait_ms = client->policy ? client->policy->deadline_ms : 0;
+
+  double queued_ms = 0;
+  CURLcode result =
+      request_scheduler_acquire(scheduler, req->endpoint, client->priority,
+                                client->cancel, max_wait_ms, &queued_ms);
+  if (result != CURLE_OK)
+    return result;
+
+  result = transport_perform(client->transport, curl, req);
+
+  // time to first byte includes sending the chunk, it says nothing about
+  // how fast answers come back
+  request_scheduler_release(scheduler, req->endpoint, client->priority,
+                            req->status, -1);
+
+  return result;
+}
+
+int gemini_file_from_json(const JsonSlice *file, GeminiFile *out) {
+  JsonSlice uri, name, expiration;
+
+  if (json_slice_find(file, "uri", &uri) != 0 || !json_slice_is_string(&uri))
+    return -1;
+
+  out->uri = json_slice_string(&uri);
+  out->name = json_slice_find(file, "name", &name) == 0
+                  ? json_slice_string(&name)
+                  : NULL;
+  out->expires_at = -1;
+
+  if (json_slice_find(file, "expirationTime", &expiration) == 0) {
+    char *expiration_str = json_slice_string(&expiration);
+    if (expiration_str)
+      out->expires_at = parse_rfc3339(expiration_str);
+    free(expiration_str);
+  }
+
+  // files are kept for 48 hours when the response does not say
+  if (out->expires_at < 0)
+    out->expires_at = (long long)time(NULL) + 48 * 3600;
+
+  return 0;
+}
+
+void gemini_file_free(GeminiFile *file) {
+  free(file->uri);
+  free(file->name);
+  file->uri = NULL;
+  file->name = NULL;
+}
+
+int get_file_uri_parse(Memory *mem, GeminiFile *out) {
+  // printf("GET FILE URI:\n%s\n", mem->response);
+
+  JsonSlice file;
+  int rc = json_find(mem->response, mem->size, "file", &file);
+  if (rc == 0)
+    rc = gemini_file_from_json(&file, out);
+  if (rc != 0)
+    fprintf(stderr, "[ERROR] Upload response has no file uri.\n");
+
+  return rc;
+}
+
+char *get_file_uri(GeminiClient *client, char *image_path, char *upload_url,
+                   char *file_mime_type) {
+  FileUpload upload = {0};
+  if (file_upload_open(&upload, image_path) != 0) {
+    fprintf(stderr, "[ERROR] Could not open %s\n", image_path);
+    return NULL;
+  }
+
+  upload.upload_url = upload_url;
+  upload.mime = file_mime_type;
+
+  Memory mem;
+  memory_init(&mem);
+
+  CURL *curl = client->file_handle;
+  UploadChunkResult chunk_result = UPLOAD_CHUNK_NEXT;
+
+  while (chunk_result == UPLOAD_CHUNK_NEXT ||
+         chunk_result == UPLOAD_CHUNK_RESUME) {
+    struct curl_slist *list = NULL;
+    TransportRequest req;
+
+    if (chunk_result == UPLOAD_CHUNK_NEXT) {
+      memory_clear(&mem);
+      list = get_file_uri_prepare(client, curl, &upload, &mem, &req);
+      CURLcode result = upload_perform(client, curl, &req);
+      chunk_result = get_file_uri_chunk_result(&upload, result, req.status);
+    } else {
+      // resume from the last acknowledged offset instead of restarting,
+      // once the server had time to recover
+      long wait_ms = request_policy_retry_ms(client->policy, upload.resumes,
+                                             &upload.headers, &mem);
+      if (!request_policy_sleep(wait_ms, client->cancel)) {
+        chunk_result = UPLOAD_CHUNK_FAILED;
+        break;
+      }
+
+      memory_clear(&mem);
+      list = get_upload_offset_prepare(client, curl, &upload, &mem, &req);
+      CURLcode result = upload_perform(client, curl, &req);
+      chunk_result = get_upload_offset_result(&upload, result, req.status);
+    }
+
+    curl_slist_free_all(list);
+  }
+
+  char *result_uri = NULL;
+  if (chunk_result == UPLOAD_CHUNK_FINISHED) {
+    GeminiFile file = {0};
+    if (get_file_uri_parse(&mem, &file) == 0) {
+      result_uri = file.uri;
+      file.uri = NULL;
+    }
+    gemini_file_free(&file);
+  } else {
+    fprintf(stderr, "[ERROR] Upload of %s failed at byte %lld.\n", image_path,
+            upload.offset);
+  }
 
-  curl_slist_free_all(list);
-  curl_easy_cleanup(curl);
-  free(mem.response);
+  file_upload_close(&upload);
+  memory_release(&mem);
 
   return result_uri;
 }
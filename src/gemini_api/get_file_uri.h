@@ -1,15 +1,66 @@
 #ifndef GETFILEURI_H
 #define GETFILEURI_H
 
+#include "../callbacks/read_callback.h"
 #include "../callbacks/write_callback.h"
 #include "../types/types.h"
+#include "../utils/file_offset.h"
+#include "../utils/grep_string.h"
+#include "../utils/json_extract.h"
+#include "../utils/parse_rfc3339.h"
+#include "gemini_client.h"
 
-#include <cjson/cJSON.h>
 #include <curl/curl.h>
 #include <stdlib.h>
+#include <time.h>
 
-char *get_file_uri(unsigned char *image_data, long int image_len,
-                   char *image_path, char *upload_url, char *gemini_api_key,
+// bytes per "upload" request, must be a multiple of the 256 KiB granularity
+// the File API asks for on every chunk but the last
+#define UPLOAD_CHUNK_SIZE (8LL * 1024 * 1024)
+// how many times a failed chunk is resumed before giving up
+#define UPLOAD_MAX_RESUMES 5
+
+typedef enum UploadChunkResult {
+  UPLOAD_CHUNK_NEXT,     // chunk acknowledged, send the next one
+  UPLOAD_CHUNK_FINISHED, // finalize acknowledged, body holds file.uri
+  UPLOAD_CHUNK_RESUME,   // ask the server how much it has, then resend
+  UPLOAD_CHUNK_FAILED,
+} UploadChunkResult;
+
+// opens path for a chunked upload, returns 0 on success
+int file_upload_open(FileUpload *upload, const char *path);
+void file_upload_close(FileUpload *upload);
+
+// prepares curl and fills req with the chunk starting at upload->offset,
+// the returned header list must stay alive until the transfer is done
+struct curl_slist *get_file_uri_prepare(GeminiClient *client, CURL *curl,
+                                        FileUpload *upload, Memory *mem,
+                                        TransportRequest *req);
+
+// classifies a finished chunk transfer and advances upload->offset
+UploadChunkResult get_file_uri_chunk_result(FileUpload *upload,
+                                            CURLcode result, long status);
+
+// fills req with a "query" request asking how many bytes the server has kept
+struct curl_slist *get_upload_offset_prepare(GeminiClient *client, CURL *curl,
+                                             FileUpload *upload, Memory *mem,
+                                             TransportRequest *req);
+
+// resumes upload->offset from the query response, UPLOAD_CHUNK_FINISHED
+// when the server already finalized the file
+UploadChunkResult get_upload_offset_result(FileUpload *upload,
+                                           CURLcode result, long status);
+
+// fills out from a File API "file" object, returns -1 without a uri
+int gemini_file_from_json(const JsonSlice *file, GeminiFile *out);
+void gemini_file_free(GeminiFile *file);
+
+// the file object from the finalize response, returns -1 when missing
+int get_file_uri_parse(Memory *mem, GeminiFile *out);
+
+// uploads path in UPLOAD_CHUNK_SIZE pieces to an upload url from
+// get_upload_url(), memory use does not grow with the file size
+char *get_file_uri(GeminiClient *client, char *image_path, char *upload_url,
                    char *file_mime_type);
 
 #endif
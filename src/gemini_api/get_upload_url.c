@@ -1,14 +1,10 @@
 #include "get_upload_url.h"
 
-char *get_upload_url(long int image_len, char *gemini_file_url,
-                     char *gemini_api_key, char *file_mime_type) {
-  Memory mem = {malloc(1), 0};
-
-  CURL *curl = curl_easy_init();
-
+struct curl_slist *get_upload_url_prepare(GeminiClient *client, CURL *curl,
+                                          long long image_len,
+                                          char *file_mime_type, Memory *mem,
+                                          TransportRequest *req) {
   struct curl_slist *list = NULL;
-  char auth_header[512];
-  char *api_key = "x-goog-api-key:";
   char *upload_protocol = "X-Goog-Upload-Protocol: resumable";
   char *upload_command = "X-Goog-Upload-Command: start";
   char length[512];
@@ -17,13 +13,12 @@ char *get_upload_url(long int image_len, char *gemini_file_url,
   char *upload_header_content_type = "X-Goog-Upload-Header-Content-Type:";
   char *content_type = "Content-Type: application/json";
 
-  snprintf(auth_header, sizeof(auth_header), "%s %s", api_key, gemini_api_key);
-  snprintf(length, sizeof(length), "%s %ld", upload_header_content_length,
+  snprintf(length, sizeof(length), "%s %lld", upload_header_content_length,
            image_len);
   snprintf(type, sizeof(type), "%s %s", upload_header_content_type,
            file_mime_type);
 
-  list = curl_slist_append(list, auth_header);
+  list = curl_slist_append(list, client->auth_header);
   list = curl_slist_append(list, upload_protocol);
   list = curl_slist_append(list, upload_command);
   list = curl_slist_append(list, length);
@@ -32,31 +27,51 @@ char *get_upload_url(long int image_len, char *gemini_file_url,
 
   const char *req_json = "{'file': {'display_name': 'IMAGE'}}";
 
-  curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 5000L);
-  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
-  curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+  gemini_client_prepare(client, curl);
+  request_policy_limit(client->policy, curl);
 
   // verbose logging
   // curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
 
-  curl_easy_setopt(curl, CURLOPT_URL, gemini_file_url);
-  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req_json);
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)strlen(req_json));
-  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, write_callback);
-  curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)&mem);
+  memset(req, 0, sizeof(TransportRequest));
+  req->url = client->file_url;
+  req->headers = list;
+  req->body = req_json;
+  req->body_len = strlen(req_json);
+  req->on_header = write_callback;
+  req->header_data = (void *)mem;
+  // error bodies land after the headers instead of on stdout
+  req->on_body = write_callback;
+  req->body_data = (void *)mem;
+  req->cancel = client->cancel;
+  req->endpoint = "upload_start";
+
+  return list;
+}
+
+char *get_upload_url(GeminiClient *client, long long image_len,
+                     char *file_mime_type) {
+  Memory mem;
+  memory_init(&mem);
 
-  curl_easy_setopt(curl, CURLOPT_CAINFO, "../cacert-2025-09-09.pem");
+  CURL *curl = client->upload_handle;
+  RequestCall call = {0};
 
-  curl_easy_perform(curl);
+  struct curl_slist *list = get_upload_url_prepare(
+      client, curl, image_len, file_mime_type, &mem, &call.request);
+  call.headers = &mem;
+  call.priority = client->priority;
 
-  char *res_url = grep_string(mem.response);
+  char *res_url = NULL;
+  if (request_perform(client->transport, client->policy, client->cancel, curl,
+                      &call) == CURLE_OK &&
+      call.status == 200)
+    res_url = grep_string(mem.response);
 
   // printf("res_url: %s\n", res_url);
 
   curl_slist_free_all(list);
-  free(mem.response);
-  curl_easy_cleanup(curl);
+  memory_release(&mem);
 
   return res_url;
 }
@@ -3,13 +3,23 @@
 
 #include "../callbacks/write_callback.h"
 #include "../types/types.h"
+#include "gemini_client.h"
+#include "request_policy.h"
 #include "../utils/grep_string.h"
 
 #include <cjson/cJSON.h>
 #include <curl/curl.h>
 #include <stdlib.h>
 
-char *get_upload_url(long int image_len, char *gemini_file_url,
-                     char *gemini_api_key, char *file_mime_type);
+// prepares curl and fills req with the resumable "start" request, the
+// upload url comes back in the X-Goog-Upload-URL response header collected
+// into mem (followed by the body, if any)
+struct curl_slist *get_upload_url_prepare(GeminiClient *client, CURL *curl,
+                                          long long image_len,
+                                          char *file_mime_type, Memory *mem,
+                                          TransportRequest *req);
+
+char *get_upload_url(GeminiClient *client, long long image_len,
+                     char *file_mime_type);
 
 #endif
@@ -0,0 +1,32 @@
+#include "latency_window.h"
+
+static int compare_long(const void *a, const void *b) {
+  long x = *(const long *)a;
+  long y = *(const long *)b;
+  return (x > y) - (x < y);
+}
+
+long latency_window_p95(LatencyWindow *window) {
+  long sorted[LATENCY_WINDOW_SIZE];
+
+  pthread_mutex_lock(&window->lock);
+  int count = window->count;
+  memcpy(sorted, window->samples, count * sizeof(long));
+  pthread_mutex_unlock(&window->lock);
+
+  if (count < LATENCY_WINDOW_MIN_SAMPLES)
+    return -1;
+
+  qsort(sorted, count, sizeof(long), compare_long);
+
+  return sorted[(count * 95 - 1) / 100];
+}
+
+void latency_window_add(LatencyWindow *window, long ms) {
+  pthread_mutex_lock(&window->lock);
+  window->samples[window->next] = ms;
+  window->next = (window->next + 1) % LATENCY_WINDOW_SIZE;
+  if (window->count < LATENCY_WINDOW_SIZE)
+    window->count++;
+  pthread_mutex_unlock(&window->lock);
+}
@@ -0,0 +1,26 @@
+#ifndef LATENCYWINDOW_H
+#define LATENCYWINDOW_H
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LATENCY_WINDOW_SIZE 64
+// below this many samples the p95 means nothing, callers fall back to a
+// fixed value
+#define LATENCY_WINDOW_MIN_SAMPLES 8
+
+// the last LATENCY_WINDOW_SIZE latencies of one kind of call, init the lock
+// before use
+typedef struct LatencyWindow {
+  pthread_mutex_t lock;
+  long samples[LATENCY_WINDOW_SIZE];
+  int count;
+  int next;
+} LatencyWindow;
+
+// p95 of the window in ms, -1 until it has enough samples
+long latency_window_p95(LatencyWindow *window);
+void latency_window_add(LatencyWindow *window, long ms);
+
+#endif
@@ -0,0 +1,144 @@
+#include "model_router.h"
+
+ModelRouter *model_router_create(void) {
+  ModelRouter *router = calloc(1, sizeof(ModelRouter));
+  if (!router)
+    return NULL;
+
+  pthread_mutex_init(&router->lock, NULL);
+
+  return router;
+}
+
+void model_router_destroy(ModelRouter *router) {
+  if (!router)
+    return;
+
+  for (int i = 0; i < router->count; i++) {
+    free(router->routes[i].api_url);
+    free(router->routes[i].stream_url);
+  }
+
+  pthread_mutex_destroy(&router->lock);
+  free(router);
+}
+
+int model_router_add(ModelRouter *router, const char *name,
+                     const char *api_url, double cost, long latency_ms,
+                     size_t max_prompt_bytes, bool attachments) {
+  ModelRoute *route = NULL;
+  for (int i = 0; i < router->count; i++) {
+    if (strcmp(router->routes[i].api_url, api_url) == 0)
+      route = &router->routes[i];
+  }
+
+  if (!route) {
+    if (router->count == MODEL_ROUTER_MAX_MODELS)
+      return -1;
+
+    route = &router->routes[router->count];
+    route->api_url = strdup(api_url);
+    route->stream_url = gemini_stream_url(api_url);
+    if (!route->api_url) {
+      free(route->stream_url);
+      return -1;
+    }
+    router->count++;
+  }
+
+  snprintf(route->name, sizeof(route->name), "%s", name);
+  route->cost = cost;
+  route->latency_ms = latency_ms > 0 ? latency_ms
+                                     : MODEL_ROUTER_DEFAULT_LATENCY_MS;
+  route->max_prompt_bytes = max_prompt_bytes;
+  route->attachments = attachments;
+
+  return 0;
+}
+
+typedef struct RankedRoute {
+  int index;
+  bool down;
+  double score;
+} RankedRoute;
+
+static int ranked_compare(const void *a, const void *b) {
+  const RankedRoute *x = (const RankedRoute *)a;
+  const RankedRoute *y = (const RankedRoute *)b;
+
+  if (x->down != y->down)
+    return x->down ? 1 : -1;
+  if (x->score != y->score)
+    return x->score < y->score ? -1 : 1;
+  return x->index - y->index;
+}
+
+int model_router_plan(ModelRouter *router, size_t prompt_bytes,
+                      bool attachments, int order[MODEL_ROUTER_MAX_MODELS]) {
+  if (!router)
+    return 0;
+
+  RankedRoute ranked[MODEL_ROUTER_MAX_MODELS];
+  int count = 0;
+  double now = get_time_ms();
+
+  pthread_mutex_lock(&router->lock);
+  for (int i = 0; i < router->count; i++) {
+    ModelRoute *route = &router->routes[i];
+    if (attachments && !route->attachments)
+      continue;
+    if (route->max_prompt_bytes > 0 && prompt_bytes > route->max_prompt_bytes)
+      continue;
+
+    double latency = route->ewma_ms > 0 ? route->ewma_ms : route->latency_ms;
+    ranked[count].index = i;
+    ranked[count].down = route->down_until > now;
+    ranked[count].score = latency + route->cost * MODEL_ROUTER_MS_PER_COST;
+    count++;
+  }
+  pthread_mutex_unlock(&router->lock);
+
+  qsort(ranked, count, sizeof(RankedRoute), ranked_compare);
+  for (int i = 0; i < count; i++) {
+    order[i] = ranked[i].index;
+  }
+
+  return count;
+}
+
+void model_router_record(ModelRouter *router, int route, bool ok,
+                         long first_byte_ms) {
+  if (!router || route < 0 || route >= router->count)
+    return;
+
+  pthread_mutex_lock(&router->lock);
+  ModelRoute *r = &router->routes[route];
+  r->requests++;
+
+  if (!ok) {
+    r->failures++;
+    r->down_until = get_time_ms() + MODEL_ROUTER_DOWN_MS;
+  } else {
+    r->down_until = 0;
+  }
+
+  if (ok && first_byte_ms > 0) {
+    r->ewma_ms = r->ewma_ms > 0
+                     ? r->ewma_ms + MODEL_ROUTER_EWMA_ALPHA *
+                                        (first_byte_ms - r->ewma_ms)
+                     : first_byte_ms;
+  }
+  pthread_mutex_unlock(&router->lock);
+}
+
+int model_router_snapshot(ModelRouter *router, ModelRoute *out, int max) {
+  if (!router)
+    return 0;
+
+  pthread_mutex_lock(&router->lock);
+  int count = router->count < max ? router->count : max;
+  memcpy(out, router->routes, count * sizeof(ModelRoute));
+  pthread_mutex_unlock(&router->lock);
+
+  return count;
+}
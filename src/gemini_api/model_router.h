@@ -0,0 +1,74 @@
+#ifndef MODELROUTER_H
+#define MODELROUTER_H
+
+#include "../utils/get_time_ms.h"
+#include "gemini_client.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MODEL_ROUTER_MAX_MODELS 8
+// weight of each new first byte time in a model's moving average
+#define MODEL_ROUTER_EWMA_ALPHA 0.2
+// what an unmeasured model without a hint is assumed to take
+#define MODEL_ROUTER_DEFAULT_LATENCY_MS 3000
+// one unit of cost weighs as much as this much latency
+#define MODEL_ROUTER_MS_PER_COST 1000.0
+// a failed model is only tried after the others for this long
+#define MODEL_ROUTER_DOWN_MS 30000
+
+// one generateContent endpoint and what is known about it
+typedef struct ModelRoute {
+  char name[64];
+  char *api_url;    // ...:generateContent
+  char *stream_url; // NULL if api_url has no :generateContent to stream from
+
+  // hints from env.json
+  double cost;             // relative, any unit as long as it's the same
+  long latency_ms;         // assumed until the first answer is measured
+  size_t max_prompt_bytes; // longer prompts go elsewhere, 0 takes any
+  bool attachments;        // can read files
+
+  // measured
+  double ewma_ms; // time to first byte, 0 until measured
+  double down_until;
+  unsigned long long requests;
+  unsigned long long failures;
+} ModelRoute;
+
+// the models a generate call may go to, shared by a client and its clones.
+// each call ranks the models able to take it by expected latency plus cost
+// and tries them in that order until one answers
+typedef struct ModelRouter {
+  pthread_mutex_t lock;
+  ModelRoute routes[MODEL_ROUTER_MAX_MODELS];
+  int count;
+} ModelRouter;
+
+ModelRouter *model_router_create(void);
+void model_router_destroy(ModelRouter *router);
+
+// adds a model, or updates the hints of the one with the same api_url.
+// returns -1 when full or out of memory. call before any request
+int model_router_add(ModelRouter *router, const char *name,
+                     const char *api_url, double cost, long latency_ms,
+                     size_t max_prompt_bytes, bool attachments);
+
+// indices of the models that can take a prompt of prompt_bytes (with
+// attachments or not) into order, best first. models that failed recently
+// come last. returns how many, 0 when none fits or router is NULL
+int model_router_plan(ModelRouter *router, size_t prompt_bytes,
+                      bool attachments, int order[MODEL_ROUTER_MAX_MODELS]);
+
+// how a call to route went, first_byte_ms is the time to first byte of the
+// transfer that answered, -1 when unknown
+void model_router_record(ModelRouter *router, int route, bool ok,
+                         long first_byte_ms);
+
+// copies of the routes, returns how many. for the network stats page
+int model_router_snapshot(ModelRouter *router, ModelRoute *out, int max);
+
+#endif
@@ -0,0 +1,455 @@
+#include "request_policy.h"
+
+RequestPolicy *request_policy_create(void) {
+  RequestPolicy *policy = calloc(1, sizeof(RequestPolicy));
+  if (!policy)
+    return NULL;
+
+  policy->deadline_ms = REQUEST_DEFAULT_DEADLINE_MS;
+  policy->max_attempts = REQUEST_DEFAULT_MAX_ATTEMPTS;
+  policy->backoff_base_ms = REQUEST_DEFAULT_BACKOFF_BASE_MS;
+  policy->backoff_max_ms = REQUEST_DEFAULT_BACKOFF_MAX_MS;
+  policy->hedge_min_delay_ms = REQUEST_DEFAULT_HEDGE_MIN_DELAY_MS;
+  pthread_mutex_init(&policy->generate_latency.lock, NULL);
+  pthread_mutex_init(&policy->lock, NULL);
+
+  return policy;
+}
+
+void request_policy_destroy(RequestPolicy *policy) {
+  if (!policy)
+    return;
+
+  pthread_mutex_destroy(&policy->generate_latency.lock);
+  pthread_mutex_destroy(&policy->lock);
+  free(policy);
+}
+
+static bool status_ok(long status) { return status >= 200 && status < 300; }
+
+static bool status_retryable(long status) {
+  return status == 408 || status == 429 || status >= 500;
+}
+
+static bool transport_retryable(CURLcode result) {
+  switch (result) {
+  case CURLE_COULDNT_RESOLVE_HOST:
+  case CURLE_COULDNT_CONNECT:
+  case CURLE_OPERATION_TIMEDOUT:
+  case CURLE_SEND_ERROR:
+  case CURLE_RECV_ERROR:
+  case CURLE_GOT_NOTHING:
+  case CURLE_PARTIAL_FILE:
+  case CURLE_HTTP2:
+  case CURLE_HTTP2_STREAM:
+  case CURLE_SSL_CONNECT_ERROR:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// how long the server asked us to wait in ms, -1 when it did not say.
+// "Retry-After: <seconds>" or RetryInfo's "retryDelay": "<seconds>s"
+static long retry_after_ms(Memory *headers, Memory *body) {
+  if (headers && headers->response) {
+    char *retry_after = grep_header(headers->response, "Retry-After");
+    if (retry_after) {
+      char *end;
+      double seconds = strtod(retry_after, &end);
+      bool numeric = end != retry_after;
+      free(retry_after);
+      if (numeric && seconds >= 0)
+        return (long)(seconds * 1000.0);
+    }
+  }
+
+  const char *body_json = body ? memory_body(body) : NULL;
+  if (body_json) {
+    JsonSlice details, detail, delay_value;
+    const char *cursor = NULL;
+
+    if (json_find(body_json, memory_body_len(body), "error.details",
+                  &details) != 0)
+      return -1;
+
+    while (json_array_next(&details, &cursor, &detail) == 0) {
+      if (json_slice_find(&detail, "retryDelay", &delay_value) != 0)
+        continue;
+
+      char *text = json_slice_string(&delay_value);
+      if (!text)
+        continue;
+      double seconds = strtod(text, NULL);
+      free(text);
+
+      return (long)(seconds * 1000.0);
+    }
+  }
+
+  return -1;
+}
+
+// sleeps in short slices, false when cancelled meanwhile
+static bool backoff_sleep(long ms, volatile int *cancel) {
+  double until = get_time_ms() + ms;
+
+  while (get_time_ms() < until) {
+    if (cancel && *cancel)
+      return false;
+
+    long left = (long)(until - get_time_ms());
+    delay(left < 50 ? (left > 0 ? left : 1) : 50);
+  }
+
+  return !(cancel && *cancel);
+}
+
+static void count(RequestPolicy *policy, unsigned long long *counter) {
+  pthread_mutex_lock(&policy->lock);
+  (*counter)++;
+  pthread_mutex_unlock(&policy->lock);
+}
+
+// rand() shares one state between the workers and isn't thread-safe. this
+// seeds per call from the clock and the calling thread's stack, then
+// scrambles it (murmur3's finalizer) so near seeds land far apart
+static unsigned long jitter_random(void) {
+  int on_stack;
+  uint32_t x = (uint32_t)(get_time_ms() * 1000.0) ^
+               (uint32_t)(uintptr_t)&on_stack;
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
+
+  return x;
+}
+
+// a random wait in [0, min(max, base * 2^attempt)], "full jitter" so that
+// clients hit by the same brownout do not come back in lockstep
+static long backoff_ms(RequestPolicy *policy, int attempt) {
+  long ceiling = policy->backoff_base_ms;
+  for (int i = 1; i < attempt && ceiling < policy->backoff_max_ms; i++) {
+    ceiling *= 2;
+  }
+  if (ceiling > policy->backoff_max_ms)
+    ceiling = policy->backoff_max_ms;
+
+  return ceiling > 0 ? (long)(jitter_random() % (ceiling + 1)) : 0;
+}
+
+static long handle_status(CURL *curl) {
+  long status = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+  return status;
+}
+
+// how long the transfer on curl waited for its first byte, -1 when nothing
+// came back
+static long first_byte_ms(CURL *curl) {
+  curl_off_t first_byte_us = 0;
+  if (curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T,
+                        &first_byte_us) != CURLE_OK ||
+      first_byte_us <= 0)
+    return -1;
+
+  return (long)(first_byte_us / 1000.0);
+}
+
+static void swap_memory(Memory *a, Memory *b) {
+  Memory temp = *a;
+  *a = *b;
+  *b = temp;
+}
+
+// curl_easy_perform that sends a duplicate once the first has been quiet
+// for hedge_delay_ms, whichever answers well first wins. the loser is
+// aborted and a winning duplicate's bytes are swapped into call's buffers.
+// *kept_at_ms is when the kept transfer started, after the attempt did
+static CURLcode perform_hedged(Transport *transport, RequestPolicy *policy,
+                               CURL *curl, RequestCall *call,
+                               long hedge_delay_ms, long timeout_ms,
+                               double *kept_at_ms) {
+  *kept_at_ms = 0;
+  CURLM *multi = call->multi ? call->multi : curl_multi_init();
+  if (!multi) {
+    CURLcode result = transport_receive(transport, curl, &call->request);
+    call->status = call->request.status;
+    call->first_byte_ms = first_byte_ms(curl);
+    net_telemetry_record(policy->telemetry, call->request.endpoint, curl,
+                         result);
+    return result;
+  }
+
+  curl_multi_add_handle(multi, curl);
+
+  CURL *hedge = NULL;
+  Memory hedge_body = {0};
+  Memory hedge_headers = {0};
+  bool curl_running = true;
+  bool hedge_running = false;
+
+  CURL *winner = NULL;
+  CURLcode result = CURLE_OK;
+  double start = get_time_ms();
+  double hedged_at_ms = 0;
+
+  while (!winner) {
+    int running = 0;
+    curl_multi_perform(multi, &running);
+
+    CURLMsg *msg;
+    int msgs_left;
+    while (!winner && (msg = curl_multi_info_read(multi, &msgs_left))) {
+      if (msg->msg != CURLMSG_DONE)
+        continue;
+
+      CURL *done = msg->easy_handle;
+      CURLcode done_result = msg->data.result;
+      net_telemetry_record(policy->telemetry, call->request.endpoint, done,
+                           done_result);
+      bool other_running = done == curl ? hedge_running : curl_running;
+
+      if (done == curl)
+        curl_running = false;
+      else
+        hedge_running = false;
+
+      // a failure only counts when there is nothing else left to wait for
+      if ((done_result == CURLE_OK && status_ok(handle_status(done))) ||
+          !other_running) {
+        winner = done;
+        result = done_result;
+      }
+    }
+
+    if (winner)
+      break;
+
+    double elapsed = get_time_ms() - start;
+    if (!hedge && curl_running && elapsed >= hedge_delay_ms) {
+      hedge = curl_easy_duphandle(curl);
+      if (hedge) {
+        hedged_at_ms = elapsed;
+        memory_init(&hedge_body);
+        if (call->body) {
+          hedge_body.spill_at = call->body->spill_at;
+          hedge_body.limit = call->body->limit;
+        }
+        memory_init(&hedge_headers);
+        // the copied write function counts into call->request, not here
+        curl_easy_setopt(hedge, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(hedge, CURLOPT_WRITEDATA, (void *)&hedge_body);
+        curl_easy_setopt(hedge, CURLOPT_HEADERDATA, (void *)&hedge_headers);
+        if (timeout_ms > 0) {
+          long left = timeout_ms - (long)elapsed;
+          curl_easy_setopt(hedge, CURLOPT_TIMEOUT_MS, left > 1 ? left : 1L);
+        }
+        curl_multi_add_handle(multi, hedge);
+        hedge_running = true;
+        count(policy, &policy->hedges);
+      }
+    }
+
+    int wait_ms = 100;
+    if (!hedge && hedge_delay_ms - elapsed < wait_ms)
+      wait_ms = hedge_delay_ms - elapsed > 1 ? (int)(hedge_delay_ms - elapsed)
+                                             : 1;
+    curl_multi_poll(multi, NULL, 0, wait_ms, NULL);
+  }
+
+  curl_multi_remove_handle(multi, curl);
+  transport_count(transport, curl, &call->request);
+  if (hedge) {
+    curl_multi_remove_handle(multi, hedge);
+    transport_count(transport, hedge, NULL);
+
+    if (winner == hedge) {
+      count(policy, &policy->hedges_won);
+      if (call->body)
+        swap_memory(call->body, &hedge_body);
+      if (call->headers)
+        swap_memory(call->headers, &hedge_headers);
+      call->status = handle_status(hedge);
+      call->first_byte_ms = first_byte_ms(hedge);
+      *kept_at_ms = hedged_at_ms;
+    }
+
+    curl_easy_cleanup(hedge);
+    memory_release(&hedge_body);
+    memory_release(&hedge_headers);
+  }
+  if (multi != call->multi)
+    curl_multi_cleanup(multi);
+
+  if (winner == curl) {
+    call->status = handle_status(curl);
+    call->first_byte_ms = first_byte_ms(curl);
+  }
+
+  return result;
+}
+
+CURLcode request_perform(Transport *transport, RequestPolicy *policy,
+                         volatile int *cancel, CURL *curl, RequestCall *call) {
+  Memory own_headers = {0};
+  if (!call->headers) {
+    memory_init(&own_headers);
+    call->request.on_header = write_callback;
+    call->request.header_data = (void *)&own_headers;
+    call->headers = &own_headers;
+  }
+  call->request.cancel = cancel;
+
+  long deadline_ms = call->deadline_ms;
+  if (deadline_ms == 0 && policy)
+    deadline_ms = policy->deadline_ms;
+  int max_attempts = policy && policy->max_attempts > 0 ? policy->max_attempts
+                                                        : 1;
+
+  double start = get_time_ms();
+  CURLcode result = CURLE_OK;
+  call->attempts = 0;
+
+  while (1) {
+    long timeout_ms = 0;
+    if (deadline_ms > 0) {
+      timeout_ms = deadline_ms - (long)(get_time_ms() - start);
+      if (timeout_ms <= 0) {
+        result = CURLE_OPERATION_TIMEDOUT;
+        break;
+      }
+    }
+
+    // the endpoint's rate, and interactive work first. the wait counts
+    // against the deadline like a backoff does
+    double queued_ms = 0;
+    result = request_scheduler_acquire(policy ? policy->scheduler : NULL,
+                                       call->request.endpoint, call->priority,
+                                       cancel, timeout_ms, &queued_ms);
+    if (result != CURLE_OK)
+      break;
+
+    if (deadline_ms > 0) {
+      timeout_ms = deadline_ms - (long)(get_time_ms() - start);
+      curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms > 1 ? timeout_ms
+                                                                : 1L);
+    }
+
+    call->attempts++;
+    call->status = 0;
+    double attempt_start = get_time_ms();
+
+    // a duplicate needs a multi handle, the recorder and replayer only
+    // serve one request at a time
+    long hedge_delay_ms = -1;
+    if (policy && policy->hedge && call->hedge && transport->multi) {
+      hedge_delay_ms = call->latency ? latency_window_p95(call->latency) : -1;
+      if (hedge_delay_ms < policy->hedge_min_delay_ms)
+        hedge_delay_ms = policy->hedge_min_delay_ms;
+    }
+
+    call->first_byte_ms = -1;
+    double kept_at_ms = 0;
+    if (hedge_delay_ms > 0) {
+      result = transport_send(transport, curl, &call->request);
+      if (result == CURLE_OK)
+        result = perform_hedged(transport, policy, curl, call, hedge_delay_ms,
+                                timeout_ms, &kept_at_ms);
+    } else {
+      result = transport_perform(transport, curl, &call->request);
+      call->status = call->request.status;
+      call->first_byte_ms = first_byte_ms(curl);
+
+      // a replayed exchange has no timings worth keeping
+      if (policy && transport->network)
+        net_telemetry_record(policy->telemetry, call->request.endpoint, curl,
+                             result);
+    }
+
+    if (policy)
+      request_scheduler_release(
+          policy->scheduler, call->request.endpoint, call->priority,
+          call->status,
+          call->first_byte_ms >= 0
+              ? (long)(queued_ms + kept_at_ms) + call->first_byte_ms
+              : -1);
+
+    if (result == CURLE_OK && status_ok(call->status)) {
+      if (call->latency)
+        latency_window_add(call->latency,
+                           (long)(get_time_ms() - attempt_start));
+      break;
+    }
+
+    if (!request_policy_retryable(result, call->status) ||
+        call->attempts >= max_attempts ||
+        (call->committed && *call->committed) || (cancel && *cancel))
+      break;
+
+    long wait_ms = request_policy_retry_ms(policy, call->attempts,
+                                           call->headers, call->body);
+
+    // waiting past the deadline only to fail there helps nobody
+    if (deadline_ms > 0 &&
+        (get_time_ms() - start) + wait_ms >= (double)deadline_ms)
+      break;
+
+    if (result == CURLE_OK)
+      fprintf(stderr, "[INFO] Attempt %d got HTTP %ld, retrying in %ld ms\n",
+              call->attempts, call->status, wait_ms);
+    else
+      fprintf(stderr, "[INFO] Attempt %d failed (%s), retrying in %ld ms\n",
+              call->attempts, curl_easy_strerror(result), wait_ms);
+
+    if (!backoff_sleep(wait_ms, cancel)) {
+      result = CURLE_ABORTED_BY_CALLBACK;
+      break;
+    }
+
+    count(policy, &policy->retries);
+    if (call->body)
+      memory_clear(call->body);
+    memory_clear(call->headers);
+    if (call->on_retry)
+      call->on_retry(call->on_retry_arg);
+  }
+
+  if (call->headers == &own_headers) {
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, NULL);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, NULL);
+    call->request.on_header = NULL;
+    call->request.header_data = NULL;
+    call->headers = NULL;
+    memory_release(&own_headers);
+  }
+
+  return result;
+}
+
+bool request_policy_retryable(CURLcode result, long status) {
+  return result == CURLE_OK ? status_retryable(status)
+                            : transport_retryable(result);
+}
+
+long request_policy_retry_ms(RequestPolicy *policy, int attempt,
+                             Memory *headers, Memory *body) {
+  long wait_ms = policy ? backoff_ms(policy, attempt) : 0;
+  long asked_ms = retry_after_ms(headers, body);
+
+  return asked_ms > wait_ms ? asked_ms : wait_ms;
+}
+
+bool request_policy_sleep(long ms, volatile int *cancel) {
+  return backoff_sleep(ms, cancel);
+}
+
+void request_policy_limit(RequestPolicy *policy, CURL *curl) {
+  if (policy && policy->deadline_ms > 0)
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, policy->deadline_ms);
+
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)REQUEST_DEFAULT_STALL_S);
+}
@@ -0,0 +1,108 @@
+#ifndef REQUESTPOLICY_H
+#define REQUESTPOLICY_H
+
+#include "../callbacks/write_callback.h"
+#include "../types/types.h"
+#include "../utils/delay.h"
+#include "../utils/get_time_ms.h"
+#include "../utils/grep_string.h"
+#include "../utils/json_extract.h"
+#include "../stats/net_telemetry.h"
+#include "../utils/memory_buffer.h"
+#include "latency_window.h"
+#include "request_scheduler.h"
+#include "transport.h"
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define REQUEST_DEFAULT_DEADLINE_MS 120000
+#define REQUEST_DEFAULT_MAX_ATTEMPTS 4
+#define REQUEST_DEFAULT_BACKOFF_BASE_MS 500
+#define REQUEST_DEFAULT_BACKOFF_MAX_MS 20000
+// never hedge sooner than this, whatever the p95 says
+#define REQUEST_DEFAULT_HEDGE_MIN_DELAY_MS 1500
+// a transfer that moves nothing for this long has stalled
+#define REQUEST_DEFAULT_STALL_S 30
+
+// how gemini_api calls deal with slow or failing servers, one per client
+// (clones borrow the parent's)
+typedef struct RequestPolicy {
+  long deadline_ms; // whole call including retries and waits, 0 for none
+  int max_attempts;
+  long backoff_base_ms;
+  long backoff_max_ms;
+
+  bool hedge; // allow a duplicate of slow non-streamed generate calls
+  long hedge_min_delay_ms;
+
+  LatencyWindow generate_latency;
+  // curl's per-phase timings of every attempt that went over the network,
+  // NULL to keep none
+  NetTelemetry *telemetry;
+  // paces every attempt per endpoint and lets interactive calls go first,
+  // NULL sends right away
+  RequestScheduler *scheduler;
+
+  // counters since startup, every worker adds to them under lock
+  pthread_mutex_t lock;
+  unsigned long long retries;
+  unsigned long long hedges;
+  unsigned long long hedges_won;
+} RequestPolicy;
+
+// one call through request_perform(), zero it and fill the inputs
+typedef struct RequestCall {
+  TransportRequest request; // what to send and where the answer goes
+  Memory *body;    // what request.body_data points at, may be NULL
+  Memory *headers; // what request.header_data points at, NULL to let the
+                   // policy capture them for Retry-After
+  long deadline_ms;          // 0 uses the policy's
+  RequestPriority priority;  // interactive unless set
+  bool hedge;                // duplicate is safe: idempotent, not streamed
+  LatencyWindow *latency;    // successful latencies go here, may be NULL
+  const int *committed;      // retries stop once this is non-zero, e.g.
+                             // streamed text that was already printed
+  void (*on_retry)(void *arg); // resets caller state before a new attempt
+  void *on_retry_arg;
+  CURLM *multi; // hedges run on it (idle between calls), NULL for a new one
+
+  long status; // HTTP status of the last attempt, 0 without a response
+  int attempts;
+  // time to first byte of the last attempt's kept transfer, the
+  // duplicate's own when it won. -1 unknown
+  long first_byte_ms;
+} RequestCall;
+
+RequestPolicy *request_policy_create(void);
+void request_policy_destroy(RequestPolicy *policy);
+
+// sends call->request over transport on the prepared handle until it gets
+// a 2xx, a final error, runs out of attempts or hits the deadline. 408, 429
+// and 5xx responses and transport errors are retried with exponential
+// backoff and full jitter, at least as long as Retry-After (or the body's
+// RetryInfo) asks. every attempt waits its turn with the policy's
+// scheduler first. cancel is honored between attempts too. policy may be
+// NULL for a single attempt
+CURLcode request_perform(Transport *transport, RequestPolicy *policy,
+                         volatile int *cancel, CURL *curl, RequestCall *call);
+
+// the same rules for transfers request_perform() can't drive itself, like
+// the pipelined uploads. whether an attempt that ended with result and
+// status is worth another
+bool request_policy_retryable(CURLcode result, long status);
+// how long to wait before retrying after the attempt-th attempt: jittered
+// backoff, but at least what Retry-After in headers or the RetryInfo in
+// body (both may be NULL) ask for
+long request_policy_retry_ms(RequestPolicy *policy, int attempt,
+                             Memory *headers, Memory *body);
+// sleeps ms in short slices, false when cancel was set meanwhile
+bool request_policy_sleep(long ms, volatile int *cancel);
+// bounds one transfer on a prepared handle by the policy's deadline and
+// fails it once it stalls for REQUEST_DEFAULT_STALL_S
+void request_policy_limit(RequestPolicy *policy, CURL *curl);
+
+#endif
@@ -0,0 +1,229 @@
+#include "request_scheduler.h"
+
+RequestScheduler *request_scheduler_create(void) {
+  RequestScheduler *scheduler = calloc(1, sizeof(RequestScheduler));
+  if (!scheduler)
+    return NULL;
+
+  pthread_mutex_init(&scheduler->lock, NULL);
+  pthread_mutex_init(&scheduler->interactive_latency.lock, NULL);
+  scheduler->default_rate = REQUEST_SCHEDULER_DEFAULT_RATE;
+  scheduler->target_ms = REQUEST_SCHEDULER_DEFAULT_TARGET_MS;
+  scheduler->background_max = REQUEST_SCHEDULER_DEFAULT_BACKGROUND;
+  scheduler->background_limit = REQUEST_SCHEDULER_DEFAULT_BACKGROUND;
+
+  return scheduler;
+}
+
+void request_scheduler_destroy(RequestScheduler *scheduler) {
+  if (!scheduler)
+    return;
+
+  pthread_mutex_destroy(&scheduler->interactive_latency.lock);
+  pthread_mutex_destroy(&scheduler->lock);
+  free(scheduler);
+}
+
+// the endpoint's bucket, a new one while there is room. called locked
+static RateBucket *find_bucket(RequestScheduler *scheduler,
+                               const char *endpoint) {
+  if (!endpoint)
+    endpoint = "other";
+
+  for (int i = 0; i < scheduler->bucket_count; i++) {
+    if (strcmp(scheduler->buckets[i].endpoint, endpoint) == 0)
+      return &scheduler->buckets[i];
+  }
+
+  if (scheduler->bucket_count == REQUEST_SCHEDULER_MAX_ENDPOINTS)
+    return NULL;
+
+  RateBucket *bucket = &scheduler->buckets[scheduler->bucket_count++];
+  snprintf(bucket->endpoint, sizeof(bucket->endpoint), "%s", endpoint);
+  bucket->max_rate = scheduler->default_rate;
+  bucket->rate = bucket->max_rate;
+  bucket->tokens = 1.0;
+  bucket->refilled_at = get_time_ms();
+
+  return bucket;
+}
+
+void request_scheduler_set_rate(RequestScheduler *scheduler,
+                                const char *endpoint, double rate) {
+  if (!scheduler || rate <= 0)
+    return;
+
+  pthread_mutex_lock(&scheduler->lock);
+  if (!endpoint) {
+    scheduler->default_rate = rate;
+  } else {
+    RateBucket *bucket = find_bucket(scheduler, endpoint);
+    if (bucket) {
+      bucket->max_rate = rate;
+      bucket->rate = rate;
+    }
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+static void refill(RateBucket *bucket, double now) {
+  double cap = bucket->rate > 1.0 ? bucket->rate : 1.0;
+
+  bucket->tokens += (now - bucket->refilled_at) / 1000.0 * bucket->rate;
+  if (bucket->tokens > cap)
+    bucket->tokens = cap;
+  bucket->refilled_at = now;
+}
+
+// whether a background attempt has to let interactive work go first.
+// called locked
+static bool background_held(RequestScheduler *scheduler) {
+  bool interactive = scheduler->interactive_waiting > 0 ||
+                     scheduler->interactive_active > 0;
+  int limit =
+      interactive ? scheduler->background_limit : scheduler->background_max;
+
+  return scheduler->interactive_waiting > 0 ||
+         scheduler->background_active >= limit ||
+         (scheduler->over_target && scheduler->interactive_active > 0);
+}
+
+CURLcode request_scheduler_acquire(RequestScheduler *scheduler,
+                                   const char *endpoint,
+                                   RequestPriority priority,
+                                   volatile int *cancel, long max_wait_ms,
+                                   double *waited_ms) {
+  *waited_ms = 0;
+  if (!scheduler)
+    return CURLE_OK;
+
+  bool interactive = priority == REQUEST_PRIORITY_INTERACTIVE;
+  bool deferred = false;
+  CURLcode result = CURLE_OK;
+  double start = get_time_ms();
+
+  pthread_mutex_lock(&scheduler->lock);
+  if (interactive)
+    scheduler->interactive_waiting++;
+
+  while (1) {
+    if (cancel && *cancel) {
+      result = CURLE_ABORTED_BY_CALLBACK;
+      break;
+    }
+
+    double now = get_time_ms();
+    double wait_ms = 50;
+    bool held = !interactive && background_held(scheduler);
+
+    if (held && !deferred) {
+      deferred = true;
+      scheduler->background_deferred++;
+    }
+
+    if (!held) {
+      // out of endpoint slots, not worth refusing the request over
+      RateBucket *bucket = find_bucket(scheduler, endpoint);
+      if (!bucket)
+        break;
+
+      refill(bucket, now);
+      if (bucket->tokens >= 1.0) {
+        bucket->tokens -= 1.0;
+        bucket->granted++;
+        break;
+      }
+
+      wait_ms = (1.0 - bucket->tokens) / bucket->rate * 1000.0;
+    }
+
+    if (max_wait_ms > 0 && now - start + wait_ms >= max_wait_ms) {
+      result = CURLE_OPERATION_TIMEDOUT;
+      break;
+    }
+
+    // short slices, so cancel and interactive arrivals are noticed
+    pthread_mutex_unlock(&scheduler->lock);
+    delay(wait_ms < 1 ? 1 : (wait_ms > 50 ? 50 : (long)wait_ms));
+    pthread_mutex_lock(&scheduler->lock);
+  }
+
+  if (interactive)
+    scheduler->interactive_waiting--;
+  if (result == CURLE_OK) {
+    if (interactive)
+      scheduler->interactive_active++;
+    else
+      scheduler->background_active++;
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+
+  *waited_ms = get_time_ms() - start;
+
+  return result;
+}
+
+void request_scheduler_release(RequestScheduler *scheduler,
+                               const char *endpoint, RequestPriority priority,
+                               long status, long latency_ms) {
+  if (!scheduler)
+    return;
+
+  bool interactive = priority == REQUEST_PRIORITY_INTERACTIVE;
+  double now = get_time_ms();
+
+  pthread_mutex_lock(&scheduler->lock);
+  if (interactive)
+    scheduler->interactive_active--;
+  else
+    scheduler->background_active--;
+
+  RateBucket *bucket = find_bucket(scheduler, endpoint);
+  if (bucket && status == 429) {
+    bucket->throttled++;
+    if (now - bucket->cut_at >= REQUEST_SCHEDULER_CUT_COOLDOWN_MS) {
+      bucket->rate /= 2;
+      if (bucket->rate < REQUEST_SCHEDULER_MIN_RATE)
+        bucket->rate = REQUEST_SCHEDULER_MIN_RATE;
+      bucket->tokens = 0;
+      bucket->cut_at = now;
+      bucket->cuts++;
+    }
+  } else if (bucket && status >= 200 && status < 300 &&
+             bucket->rate < bucket->max_rate) {
+    bucket->rate += bucket->max_rate * REQUEST_SCHEDULER_RECOVER_SHARE;
+    if (bucket->rate > bucket->max_rate)
+      bucket->rate = bucket->max_rate;
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+
+  if (!interactive || latency_ms < 0 || scheduler->target_ms <= 0)
+    return;
+
+  latency_window_add(&scheduler->interactive_latency, latency_ms);
+  long p95 = latency_window_p95(&scheduler->interactive_latency);
+
+  pthread_mutex_lock(&scheduler->lock);
+  scheduler->over_target = p95 > scheduler->target_ms;
+  if (scheduler->over_target) {
+    scheduler->background_limit /= 2;
+    if (scheduler->background_limit < 1)
+      scheduler->background_limit = 1;
+  } else if (scheduler->background_limit < scheduler->background_max) {
+    scheduler->background_limit++;
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+int request_scheduler_snapshot(RequestScheduler *scheduler, RateBucket *out,
+                               int max) {
+  if (!scheduler)
+    return 0;
+
+  pthread_mutex_lock(&scheduler->lock);
+  int count = scheduler->bucket_count < max ? scheduler->bucket_count : max;
+  memcpy(out, scheduler->buckets, count * sizeof(RateBucket));
+  pthread_mutex_unlock(&scheduler->lock);
+
+  return count;
+}
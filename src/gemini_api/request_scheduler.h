@@ -0,0 +1,103 @@
+#ifndef REQUESTSCHEDULER_H
+#define REQUESTSCHEDULER_H
+
+#include "../utils/delay.h"
+#include "../utils/get_time_ms.h"
+#include "latency_window.h"
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REQUEST_SCHEDULER_MAX_ENDPOINTS 16
+// requests per second each endpoint starts at unless configured
+#define REQUEST_SCHEDULER_DEFAULT_RATE 4.0
+// a 429 halves the rate, never below this (one request every 20 s)
+#define REQUEST_SCHEDULER_MIN_RATE 0.05
+// 429s of requests already in flight say the same thing, one cut per window
+#define REQUEST_SCHEDULER_CUT_COOLDOWN_MS 1000
+// each success gives back this share of the configured rate
+#define REQUEST_SCHEDULER_RECOVER_SHARE 0.05
+// interactive time to first byte (queueing included) to protect
+#define REQUEST_SCHEDULER_DEFAULT_TARGET_MS 5000
+// background requests in flight at once while interactive ones are fast
+#define REQUEST_SCHEDULER_DEFAULT_BACKGROUND 2
+
+typedef enum RequestPriority {
+  REQUEST_PRIORITY_INTERACTIVE, // someone is waiting on the answer
+  REQUEST_PRIORITY_BACKGROUND,  // batches, refreshes, anything that can wait
+} RequestPriority;
+
+// client side token bucket of one endpoint. additive increase on success,
+// multiplicative decrease on 429, so it settles just below the quota
+typedef struct RateBucket {
+  char endpoint[32];
+  double max_rate; // requests per second
+  double rate;     // where 429s have pushed it, up to max_rate
+  double tokens;   // capped at one second's worth, or one
+  double refilled_at;
+  double cut_at;
+
+  unsigned long long granted;
+  unsigned long long throttled; // 429s
+  unsigned long long cuts;
+} RateBucket;
+
+// sits in front of every request_perform() attempt. interactive requests
+// always get the next token first, background ones also wait while
+// interactive p95 is over target_ms and one is in flight, and are capped
+// to background_limit at once while interactive work is around. the limit
+// halves while interactive requests are slow and grows back by one while
+// they are fast
+typedef struct RequestScheduler {
+  pthread_mutex_t lock;
+  RateBucket buckets[REQUEST_SCHEDULER_MAX_ENDPOINTS];
+  int bucket_count;
+  double default_rate;
+
+  long target_ms; // 0 doesn't hold background work back for latency
+  LatencyWindow interactive_latency;
+  bool over_target;
+
+  int interactive_waiting;
+  int interactive_active;
+  int background_active;
+  int background_limit;
+  int background_max;
+
+  unsigned long long background_deferred; // waits caused by interactive work
+} RequestScheduler;
+
+RequestScheduler *request_scheduler_create(void);
+void request_scheduler_destroy(RequestScheduler *scheduler);
+
+// requests per second of endpoint, NULL for every endpoint without its own.
+// rates <= 0 are ignored
+void request_scheduler_set_rate(RequestScheduler *scheduler,
+                                const char *endpoint, double rate);
+
+// blocks until an attempt on endpoint may go out. CURLE_OK with the wait
+// in *waited_ms, CURLE_ABORTED_BY_CALLBACK once cancel is set, or
+// CURLE_OPERATION_TIMEDOUT when nothing came up within max_wait_ms (0
+// waits as long as it takes). scheduler may be NULL
+CURLcode request_scheduler_acquire(RequestScheduler *scheduler,
+                                   const char *endpoint,
+                                   RequestPriority priority,
+                                   volatile int *cancel, long max_wait_ms,
+                                   double *waited_ms);
+
+// after every acquired attempt. status 429 slows endpoint down, 2xx speeds
+// it back up. latency_ms (queueing plus time to first byte, -1 unknown)
+// of interactive attempts drives the background limit
+void request_scheduler_release(RequestScheduler *scheduler,
+                               const char *endpoint, RequestPriority priority,
+                               long status, long latency_ms);
+
+// copies of the buckets, returns how many. for the network stats page
+int request_scheduler_snapshot(RequestScheduler *scheduler, RateBucket *out,
+                               int max);
+
+#endif
@@ -0,0 +1,167 @@
+#include "transport.h"
+
+typedef struct CurlTransport {
+  Transport base;
+  pthread_mutex_t lock; // clones on other threads count into the same stats
+  TransportStats stats;
+} CurlTransport;
+
+// between curl and req->on_body, after libcurl undid any Content-Encoding
+static size_t count_body(char *ptr, size_t size, size_t nmemb,
+                         void *userdata) {
+  TransportRequest *req = (TransportRequest *)userdata;
+
+  size_t taken = req->on_body(ptr, size, nmemb, req->body_data);
+  req->received += taken;
+
+  return taken;
+}
+
+static CURLcode curl_send(Transport *transport, CURL *curl,
+                          TransportRequest *req) {
+  curl_easy_setopt(curl, CURLOPT_URL, req->url);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req->headers);
+  if (req->method)
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, req->method);
+
+  if (req->read) {
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                     (curl_off_t)req->read_len);
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, req->read);
+    curl_easy_setopt(curl, CURLOPT_READDATA, req->read_data);
+    if (req->seek) {
+      curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, req->seek);
+      curl_easy_setopt(curl, CURLOPT_SEEKDATA, req->read_data);
+    }
+  } else if (req->body) {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req->body);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)req->body_len);
+  }
+
+  req->received = 0;
+  if (req->on_body) {
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, count_body);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)req);
+  }
+  if (req->on_header) {
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, req->on_header);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, req->header_data);
+  }
+
+  return CURLE_OK;
+}
+
+static CURLcode curl_receive(Transport *transport, CURL *curl,
+                             TransportRequest *req) {
+  CURLcode result = curl_easy_perform(curl);
+
+  req->status = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &req->status);
+  transport_count(transport, curl, req);
+
+  return result;
+}
+
+static void curl_stats(Transport *transport, TransportStats *out) {
+  CurlTransport *ct = (CurlTransport *)transport;
+
+  pthread_mutex_lock(&ct->lock);
+  out->requests += ct->stats.requests;
+  out->wire_sent += ct->stats.wire_sent;
+  out->wire_received += ct->stats.wire_received;
+  out->body_sent += ct->stats.body_sent;
+  out->body_received += ct->stats.body_received;
+  pthread_mutex_unlock(&ct->lock);
+}
+
+static void curl_destroy(Transport *transport) {
+  CurlTransport *ct = (CurlTransport *)transport;
+
+  pthread_mutex_destroy(&ct->lock);
+  free(ct);
+}
+
+static const TransportOps curl_ops = {curl_send, curl_receive, curl_stats,
+                                      curl_destroy};
+
+Transport *transport_curl_create(void) {
+  CurlTransport *ct = calloc(1, sizeof(CurlTransport));
+  if (!ct)
+    return NULL;
+
+  ct->base.ops = &curl_ops;
+  ct->base.name = "curl";
+  ct->base.multi = true;
+  ct->base.network = true;
+  pthread_mutex_init(&ct->lock, NULL);
+
+  return &ct->base;
+}
+
+CURLcode transport_send(Transport *transport, CURL *curl,
+                        TransportRequest *req) {
+  return transport->ops->send(transport, curl, req);
+}
+
+CURLcode transport_receive(Transport *transport, CURL *curl,
+                           TransportRequest *req) {
+  return transport->ops->receive(transport, curl, req);
+}
+
+CURLcode transport_perform(Transport *transport, CURL *curl,
+                           TransportRequest *req) {
+  CURLcode result = transport_send(transport, curl, req);
+  if (result != CURLE_OK) {
+    req->status = 0;
+    return result;
+  }
+
+  return transport_receive(transport, curl, req);
+}
+
+void transport_count(Transport *transport, CURL *curl,
+                     const TransportRequest *req) {
+  if (transport->ops != &curl_ops)
+    return;
+
+  CurlTransport *ct = (CurlTransport *)transport;
+
+  // libcurl counts bodies as they travel, before it decodes them
+  curl_off_t uploaded = 0;
+  curl_off_t downloaded = 0;
+  curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &uploaded);
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+
+  pthread_mutex_lock(&ct->lock);
+  ct->stats.requests++;
+  ct->stats.wire_sent += uploaded;
+  ct->stats.wire_received += downloaded;
+  if (req && req->plain_len)
+    ct->stats.body_sent += req->plain_len;
+  else
+    ct->stats.body_sent += uploaded;
+  if (req && req->on_body)
+    ct->stats.body_received += req->received;
+  else
+    ct->stats.body_received += downloaded;
+  pthread_mutex_unlock(&ct->lock);
+}
+
+void transport_stats(Transport *transport, TransportStats *out) {
+  memset(out, 0, sizeof(*out));
+  if (transport && transport->ops->stats)
+    transport->ops->stats(transport, out);
+}
+
+void transport_destroy(Transport *transport) {
+  if (transport)
+    transport->ops->destroy(transport);
+}
+
+const char *transport_method(const TransportRequest *req) {
+  if (req->method)
+    return req->method;
+
+  return req->body || req->read ? "POST" : "GET";
+}
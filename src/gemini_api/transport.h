@@ -0,0 +1,105 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// one HTTP exchange as the gemini_api calls describe it. the transport
+// turns it into curl options or serves it from somewhere else entirely
+typedef struct TransportRequest {
+  const char *endpoint; // telemetry label such as "generate", NULL: "other"
+  const char *method; // NULL: POST when there is a body, GET otherwise
+  const char *url;
+  struct curl_slist *headers;
+
+  // the body is either in memory...
+  const char *body;
+  size_t body_len;
+  size_t plain_len; // body_len before gzip, 0 when the body goes as is
+  // ...or read from read_data, read_len bytes of it (file uploads)
+  curl_read_callback read;
+  curl_seek_callback seek;
+  void *read_data;
+  long long read_len;
+
+  // where the answer goes, like CURLOPT_WRITEFUNCTION and HEADERFUNCTION.
+  // a NULL header sink drops the headers, a NULL body sink leaves curl's
+  // default (stdout) alone
+  curl_write_callback on_body;
+  void *body_data;
+  curl_write_callback on_header;
+  void *header_data;
+
+  volatile int *cancel; // waits that are not curl's own stop early when set
+
+  long status;     // set by receive, 0 without a response
+  size_t received; // decoded body bytes given to on_body by the last send
+  void *state; // the transport's own, from send to receive
+} TransportRequest;
+
+// body bytes a transport moved, as they crossed the wire (compressed) and
+// as the callers handed them over or got them back. headers are left out,
+// compression never touches them
+typedef struct TransportStats {
+  unsigned long long requests;
+  unsigned long long wire_sent;
+  unsigned long long wire_received;
+  unsigned long long body_sent;     // request bodies before gzip
+  unsigned long long body_received; // response bodies after decoding
+} TransportStats;
+
+typedef struct Transport Transport;
+
+typedef struct TransportOps {
+  // hands req over, for libcurl that means setting its options on curl
+  CURLcode (*send)(Transport *transport, CURL *curl, TransportRequest *req);
+  // waits for the answer to the last send of req and feeds it to req's
+  // callbacks
+  CURLcode (*receive)(Transport *transport, CURL *curl,
+                      TransportRequest *req);
+  // adds what went through so far to out, NULL when nothing is counted
+  void (*stats)(Transport *transport, TransportStats *out);
+  void (*destroy)(Transport *transport);
+} TransportOps;
+
+// implementations embed this first and cast back
+struct Transport {
+  const TransportOps *ops;
+  const char *name;
+  // a handle req was sent on may be driven by a curl multi handle (hedging,
+  // parallel uploads) instead of receive(). only plain libcurl allows it,
+  // the others run those requests one after the other
+  bool multi;
+  // talks to the real hosts, so warming up connections is worth it
+  bool network;
+};
+
+// straight to the network through libcurl, the default
+Transport *transport_curl_create(void);
+
+CURLcode transport_send(Transport *transport, CURL *curl,
+                        TransportRequest *req);
+CURLcode transport_receive(Transport *transport, CURL *curl,
+                           TransportRequest *req);
+
+// send and receive, what most calls want
+CURLcode transport_perform(Transport *transport, CURL *curl,
+                           TransportRequest *req);
+
+// a handle req was sent on and a curl multi handle finished, receive()
+// counts its own. req may be NULL for duplicates of a sent handle
+void transport_count(Transport *transport, CURL *curl,
+                     const TransportRequest *req);
+
+// totals since the transport was created
+void transport_stats(Transport *transport, TransportStats *out);
+
+void transport_destroy(Transport *transport);
+
+// "GET", "POST" or req->method
+const char *transport_method(const TransportRequest *req);
+
+#endif
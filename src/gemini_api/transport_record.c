@@ -0,0 +1,193 @@
+#include "transport_record.h"
+
+typedef struct Recorder {
+  Transport base;
+  Transport *inner;
+
+  pthread_mutex_t lock; // one exchange at a time goes into out
+  FILE *out;
+} Recorder;
+
+// one exchange between send and receive, the caller's callbacks are put
+// back once it is written
+typedef struct RecordedExchange {
+  double start;
+  Memory log; // the exchange in file format, appended as it arrives
+
+  curl_write_callback on_body;
+  void *body_data;
+  curl_write_callback on_header;
+  void *header_data;
+} RecordedExchange;
+
+static void log_bytes(RecordedExchange *exchange, char tag, const char *data,
+                      size_t len) {
+  char line[64];
+  int line_len = snprintf(line, sizeof(line), "%c %.3f %zu\n", tag,
+                          get_time_ms() - exchange->start, len);
+
+  memory_append(&exchange->log, line, line_len);
+  memory_append(&exchange->log, data, len);
+  memory_append(&exchange->log, "\n", 1);
+}
+
+static size_t tee_body(char *ptr, size_t size, size_t nmemb, void *userdata) {
+  RecordedExchange *exchange = (RecordedExchange *)userdata;
+  size_t len = size * nmemb;
+
+  size_t taken = exchange->on_body
+                     ? exchange->on_body(ptr, size, nmemb, exchange->body_data)
+                     : len;
+  log_bytes(exchange, 'b', ptr, taken < len ? taken : len);
+
+  return taken;
+}
+
+static size_t tee_header(char *ptr, size_t size, size_t nmemb,
+                         void *userdata) {
+  RecordedExchange *exchange = (RecordedExchange *)userdata;
+  size_t len = size * nmemb;
+
+  log_bytes(exchange, 'h', ptr, len);
+
+  return exchange->on_header ? exchange->on_header(ptr, size, nmemb,
+                                                   exchange->header_data)
+                             : len;
+}
+
+static void restore_callbacks(TransportRequest *req,
+                              RecordedExchange *exchange) {
+  req->on_body = exchange->on_body;
+  req->body_data = exchange->body_data;
+  req->on_header = exchange->on_header;
+  req->header_data = exchange->header_data;
+}
+
+static CURLcode recorder_send(Transport *transport, CURL *curl,
+                              TransportRequest *req) {
+  Recorder *recorder = (Recorder *)transport;
+
+  RecordedExchange *exchange = malloc(sizeof(RecordedExchange));
+  if (!exchange)
+    return CURLE_OUT_OF_MEMORY;
+
+  memory_init(&exchange->log);
+  exchange->on_body = req->on_body;
+  exchange->body_data = req->body_data;
+  exchange->on_header = req->on_header;
+  exchange->header_data = req->header_data;
+
+  char line[64];
+  memory_append(&exchange->log, "> ", 2);
+  memory_append(&exchange->log, transport_method(req),
+                strlen(transport_method(req)));
+  memory_append(&exchange->log, " ", 1);
+  memory_append(&exchange->log, req->url, strlen(req->url));
+  memory_append(&exchange->log, "\n", 1);
+  if (req->body) {
+    int line_len = snprintf(line, sizeof(line), "q %zu\n", req->body_len);
+    memory_append(&exchange->log, line, line_len);
+    memory_append(&exchange->log, req->body, req->body_len);
+    memory_append(&exchange->log, "\n", 1);
+  }
+
+  // a NULL body sink has to stay NULL for curl to keep its default
+  if (req->on_body) {
+    req->on_body = tee_body;
+    req->body_data = exchange;
+  }
+  req->on_header = tee_header;
+  req->header_data = exchange;
+  req->state = exchange;
+
+  exchange->start = get_time_ms();
+  CURLcode result = transport_send(recorder->inner, curl, req);
+  if (result != CURLE_OK) {
+    restore_callbacks(req, exchange);
+    req->state = NULL;
+    memory_release(&exchange->log);
+    free(exchange);
+  }
+
+  return result;
+}
+
+static CURLcode recorder_receive(Transport *transport, CURL *curl,
+                                 TransportRequest *req) {
+  Recorder *recorder = (Recorder *)transport;
+  RecordedExchange *exchange = (RecordedExchange *)req->state;
+
+  CURLcode result = transport_receive(recorder->inner, curl, req);
+  if (!exchange)
+    return result;
+
+  char line[64];
+  int line_len = snprintf(line, sizeof(line), "< %.3f %d %ld\n",
+                          get_time_ms() - exchange->start, (int)result,
+                          req->status);
+  memory_append(&exchange->log, line, line_len);
+
+  pthread_mutex_lock(&recorder->lock);
+  fwrite(exchange->log.response, 1, exchange->log.size, recorder->out);
+  fflush(recorder->out);
+  pthread_mutex_unlock(&recorder->lock);
+
+  restore_callbacks(req, exchange);
+  req->state = NULL;
+  memory_release(&exchange->log);
+  free(exchange);
+
+  return result;
+}
+
+static void recorder_stats(Transport *transport, TransportStats *out) {
+  Recorder *recorder = (Recorder *)transport;
+  TransportStats inner;
+
+  transport_stats(recorder->inner, &inner);
+  out->requests += inner.requests;
+  out->wire_sent += inner.wire_sent;
+  out->wire_received += inner.wire_received;
+  out->body_sent += inner.body_sent;
+  out->body_received += inner.body_received;
+}
+
+static void recorder_destroy(Transport *transport) {
+  Recorder *recorder = (Recorder *)transport;
+
+  transport_destroy(recorder->inner);
+  if (recorder->out)
+    fclose(recorder->out);
+  pthread_mutex_destroy(&recorder->lock);
+  free(recorder);
+}
+
+static const TransportOps recorder_ops = {recorder_send, recorder_receive,
+                                          recorder_stats, recorder_destroy};
+
+Transport *transport_recorder_create(Transport *inner, const char *path) {
+  if (!inner)
+    return NULL;
+
+  Recorder *recorder = calloc(1, sizeof(Recorder));
+  FILE *out = fopen(path, "wb");
+  if (!recorder || !out) {
+    fprintf(stderr, "[ERROR] Could not record to %s\n", path);
+    if (out)
+      fclose(out);
+    free(recorder);
+    return NULL;
+  }
+
+  fputs(TRANSPORT_RECORDING_MAGIC, out);
+
+  recorder->base.ops = &recorder_ops;
+  recorder->base.name = "record";
+  recorder->base.multi = false;
+  recorder->base.network = inner->network;
+  recorder->inner = inner;
+  recorder->out = out;
+  pthread_mutex_init(&recorder->lock, NULL);
+
+  return &recorder->base;
+}
@@ -0,0 +1,31 @@
+#ifndef TRANSPORTRECORD_H
+#define TRANSPORTRECORD_H
+
+#include "../utils/get_time_ms.h"
+#include "../utils/memory_buffer.h"
+#include "transport.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+// a recording is a text file of exchanges, each one
+//
+//   > METHOD URL
+//   q LEN          request body, in-memory bodies only
+//   h MS LEN       one header line as curl delivered it
+//   b MS LEN       one piece of the body as curl delivered it
+//   < MS RESULT STATUS
+//
+// where every q/h/b line is followed by LEN raw bytes and a newline, MS is
+// milliseconds since the request was sent and RESULT the CURLcode. request
+// headers are left out so the api key never ends up on disk
+#define TRANSPORT_RECORDING_MAGIC "# gemini transport recording 1\n"
+
+// passes every exchange on to inner and appends it to path, inner is owned
+// by the recorder from now on (still the caller's when NULL is returned).
+// exchanges are written whole as they finish. a multi handle would skip
+// receive(), so hedges and parallel uploads run one request at a time
+// while recording
+Transport *transport_recorder_create(Transport *inner, const char *path);
+
+#endif
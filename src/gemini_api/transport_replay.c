@@ -0,0 +1,364 @@
+#include "transport_replay.h"
+
+// upload bodies are read and thrown away in pieces this big
+#define REPLAY_READ_SIZE (64 * 1024)
+
+typedef struct ReplayEvent {
+  char kind; // 'h' header line, 'b' piece of the body
+  double at_ms;
+  const char *data;
+  size_t len;
+} ReplayEvent;
+
+typedef struct ReplayExchange {
+  const char *method;
+  const char *url;
+  char body_hash[65]; // sha256 of the request body, "" without one
+
+  ReplayEvent *events;
+  size_t event_count;
+
+  double end_ms;
+  CURLcode result;
+  long status;
+  bool used;
+} ReplayExchange;
+
+typedef struct Replayer {
+  Transport base;
+  double speed;
+
+  char *data; // the whole recording, events point into it
+  size_t size;
+
+  pthread_mutex_t lock; // guards used
+  ReplayExchange *exchanges;
+  size_t count;
+} Replayer;
+
+static char *load_recording(const char *path, size_t *out_size) {
+  FILE *fptr = fopen(path, "rb");
+  if (!fptr)
+    return NULL;
+
+  long long size = file_size(fptr);
+  char *data = size >= 0 ? malloc((size_t)size + 1) : NULL;
+  if (!data || fread(data, 1, (size_t)size, fptr) != (size_t)size) {
+    free(data);
+    fclose(fptr);
+    return NULL;
+  }
+  fclose(fptr);
+
+  data[size] = '\0';
+  *out_size = (size_t)size;
+
+  return data;
+}
+
+// cuts the line at cursor off with a NUL, NULL at the end of the data
+static char *next_line(char *data, size_t size, size_t *cursor) {
+  if (*cursor >= size)
+    return NULL;
+
+  char *line = data + *cursor;
+  char *end = memchr(line, '\n', size - *cursor);
+  if (!end)
+    end = data + size;
+
+  *end = '\0';
+  *cursor = end - data + 1;
+
+  return line;
+}
+
+static ReplayExchange *add_exchange(Replayer *replayer, size_t *capacity) {
+  if (replayer->count == *capacity) {
+    size_t grown = *capacity ? *capacity * 2 : 64;
+    ReplayExchange *exchanges =
+        realloc(replayer->exchanges, grown * sizeof(ReplayExchange));
+    if (!exchanges)
+      return NULL;
+    replayer->exchanges = exchanges;
+    *capacity = grown;
+  }
+
+  ReplayExchange *exchange = &replayer->exchanges[replayer->count++];
+  memset(exchange, 0, sizeof(ReplayExchange));
+
+  return exchange;
+}
+
+static int add_event(ReplayExchange *exchange, size_t *capacity,
+                     ReplayEvent *event) {
+  if (exchange->event_count == *capacity) {
+    size_t grown = *capacity ? *capacity * 2 : 16;
+    ReplayEvent *events =
+        realloc(exchange->events, grown * sizeof(ReplayEvent));
+    if (!events)
+      return -1;
+    exchange->events = events;
+    *capacity = grown;
+  }
+
+  exchange->events[exchange->event_count++] = *event;
+
+  return 0;
+}
+
+static int parse_recording(Replayer *replayer) {
+  size_t cursor = 0;
+  size_t exchange_capacity = 0;
+  size_t event_capacity = 0;
+  ReplayExchange *exchange = NULL;
+  char *line;
+
+  while ((line = next_line(replayer->data, replayer->size, &cursor))) {
+    char *rest = line + 2;
+
+    if (line[0] == '#' || line[0] == '\0')
+      continue;
+    if (line[1] != ' ')
+      return -1;
+
+    if (line[0] == '>') {
+      char *space = strchr(rest, ' ');
+      if (!space)
+        return -1;
+      *space = '\0';
+
+      exchange = add_exchange(replayer, &exchange_capacity);
+      if (!exchange)
+        return -1;
+      exchange->method = rest;
+      exchange->url = space + 1;
+      event_capacity = 0;
+      continue;
+    }
+
+    if (!exchange)
+      return -1;
+
+    if (line[0] == '<') {
+      char *end;
+      exchange->end_ms = strtod(rest, &end);
+      exchange->result = (CURLcode)strtol(end, &end, 10);
+      exchange->status = strtol(end, NULL, 10);
+      continue;
+    }
+
+    if (line[0] != 'q' && line[0] != 'h' && line[0] != 'b')
+      return -1;
+
+    // q has no time, only the length
+    ReplayEvent event = {line[0], 0, NULL, 0};
+    char *end = rest;
+    if (line[0] != 'q')
+      event.at_ms = strtod(rest, &end);
+    event.len = strtoull(end, NULL, 10);
+    event.data = replayer->data + cursor;
+
+    if (event.len > replayer->size - cursor)
+      return -1;
+    cursor += event.len + 1;
+
+    if (line[0] == 'q') {
+      Sha256 sha;
+      sha256_init(&sha);
+      sha256_update(&sha, event.data, event.len);
+      sha256_final_hex(&sha, exchange->body_hash);
+    }
+
+    if (line[0] != 'q' && add_event(exchange, &event_capacity, &event) != 0)
+      return -1;
+  }
+
+  return 0;
+}
+
+// the exchange to serve for method, url and body_hash (NULL: any body).
+// called with the lock held
+static ReplayExchange *find_exchange(Replayer *replayer, const char *method,
+                                     const char *url, const char *body_hash) {
+  ReplayExchange *last_used = NULL;
+
+  for (size_t i = 0; i < replayer->count; i++) {
+    ReplayExchange *exchange = &replayer->exchanges[i];
+    if (strcmp(exchange->method, method) != 0 ||
+        strcmp(exchange->url, url) != 0 ||
+        (body_hash && strcmp(exchange->body_hash, body_hash) != 0))
+      continue;
+
+    if (!exchange->used)
+      return exchange;
+    last_used = exchange;
+  }
+
+  return last_used;
+}
+
+static CURLcode replayer_send(Transport *transport, CURL *curl,
+                              TransportRequest *req) {
+  Replayer *replayer = (Replayer *)transport;
+  const char *method = transport_method(req);
+
+  char body_hash[65] = "";
+  if (req->body) {
+    Sha256 sha;
+    sha256_init(&sha);
+    sha256_update(&sha, req->body, req->body_len);
+    sha256_final_hex(&sha, body_hash);
+  }
+
+  // the body picks the exchange, so threads asking different things get
+  // their own answers whatever order they come in
+  pthread_mutex_lock(&replayer->lock);
+  ReplayExchange *found = find_exchange(replayer, method, req->url, body_hash);
+  if (!found)
+    found = find_exchange(replayer, method, req->url, NULL);
+  if (found)
+    found->used = true;
+  pthread_mutex_unlock(&replayer->lock);
+
+  req->state = found;
+  if (!found) {
+    fprintf(stderr, "[ERROR] Nothing recorded for %s %s\n", method, req->url);
+    return CURLE_REMOTE_FILE_NOT_FOUND;
+  }
+
+  return CURLE_OK;
+}
+
+// sleeps until at_ms after start at the replay's pace, false when
+// cancelled meanwhile
+static bool wait_until(Replayer *replayer, double start, double at_ms,
+                       volatile int *cancel) {
+  if (replayer->speed <= 0)
+    return !(cancel && *cancel);
+
+  double until = start + at_ms / replayer->speed;
+  double now;
+
+  while ((now = get_time_ms()) < until) {
+    if (cancel && *cancel)
+      return false;
+
+    double left = until - now;
+    delay(left < 50 ? (left >= 1 ? (int)left : 1) : 50);
+  }
+
+  return !(cancel && *cancel);
+}
+
+// reads the upload body like curl would, so replays still pay for the disk
+static CURLcode drain_body(TransportRequest *req) {
+  char *buffer = malloc(REPLAY_READ_SIZE);
+  if (!buffer)
+    return CURLE_OUT_OF_MEMORY;
+
+  CURLcode result = CURLE_OK;
+  long long left = req->read_len;
+
+  while (left > 0) {
+    size_t got = req->read(buffer, 1, REPLAY_READ_SIZE, req->read_data);
+    if (got == CURL_READFUNC_ABORT) {
+      result = CURLE_ABORTED_BY_CALLBACK;
+      break;
+    }
+    if (got == 0 || got > REPLAY_READ_SIZE) {
+      result = CURLE_READ_ERROR;
+      break;
+    }
+    left -= (long long)got;
+  }
+
+  free(buffer);
+
+  return result;
+}
+
+static CURLcode replayer_receive(Transport *transport, CURL *curl,
+                                 TransportRequest *req) {
+  Replayer *replayer = (Replayer *)transport;
+  ReplayExchange *exchange = (ReplayExchange *)req->state;
+
+  req->state = NULL;
+  req->status = 0;
+  if (!exchange)
+    return CURLE_REMOTE_FILE_NOT_FOUND;
+
+  double start = get_time_ms();
+
+  if (req->read) {
+    CURLcode result = drain_body(req);
+    if (result != CURLE_OK)
+      return result;
+  }
+
+  for (size_t i = 0; i < exchange->event_count; i++) {
+    ReplayEvent *event = &exchange->events[i];
+
+    if (!wait_until(replayer, start, event->at_ms, req->cancel))
+      return CURLE_ABORTED_BY_CALLBACK;
+
+    curl_write_callback sink = event->kind == 'h' ? req->on_header
+                                                  : req->on_body;
+    void *userdata = event->kind == 'h' ? req->header_data : req->body_data;
+    if (!sink)
+      continue;
+
+    if (sink((char *)event->data, 1, event->len, userdata) != event->len)
+      return CURLE_WRITE_ERROR;
+  }
+
+  if (!wait_until(replayer, start, exchange->end_ms, req->cancel))
+    return CURLE_ABORTED_BY_CALLBACK;
+
+  req->status = exchange->status;
+
+  return exchange->result;
+}
+
+static void replayer_destroy(Transport *transport) {
+  Replayer *replayer = (Replayer *)transport;
+
+  for (size_t i = 0; i < replayer->count; i++) {
+    free(replayer->exchanges[i].events);
+  }
+  free(replayer->exchanges);
+  free(replayer->data);
+  pthread_mutex_destroy(&replayer->lock);
+  free(replayer);
+}
+
+// recordings hold decoded bodies only, there is no wire to count
+static const TransportOps replayer_ops = {replayer_send, replayer_receive,
+                                          NULL, replayer_destroy};
+
+Transport *transport_replayer_create(const char *path, double speed) {
+  Replayer *replayer = calloc(1, sizeof(Replayer));
+  if (!replayer)
+    return NULL;
+
+  replayer->base.ops = &replayer_ops;
+  replayer->base.name = "replay";
+  replayer->base.multi = false;
+  replayer->base.network = false;
+  replayer->speed = speed;
+  pthread_mutex_init(&replayer->lock, NULL);
+
+  replayer->data = load_recording(path, &replayer->size);
+  if (!replayer->data ||
+      strncmp(replayer->data, TRANSPORT_RECORDING_MAGIC,
+              strlen(TRANSPORT_RECORDING_MAGIC)) != 0 ||
+      parse_recording(replayer) != 0) {
+    fprintf(stderr, "[ERROR] %s is not a readable recording.\n", path);
+    replayer_destroy(&replayer->base);
+    return NULL;
+  }
+
+  fprintf(stderr, "[INFO] Replaying %zu exchanges from %s\n", replayer->count,
+          path);
+
+  return &replayer->base;
+}
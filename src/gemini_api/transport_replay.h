@@ -0,0 +1,25 @@
+#ifndef TRANSPORTREPLAY_H
+#define TRANSPORTREPLAY_H
+
+#include "../utils/delay.h"
+#include "../utils/file_offset.h"
+#include "../utils/get_time_ms.h"
+#include "../utils/sha256.h"
+#include "transport.h"
+#include "transport_record.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+// serves the exchanges of a recording (see transport_record.h) without
+// touching the network. a request gets the first unused exchange with the
+// same method, url and request body, or the last one again when it was
+// asked more often than recorded. a body that was never recorded falls
+// back to the method and url alone. headers and body pieces are fed to
+// the callbacks as curl fed them, at their recorded times divided by speed
+// (1 is the original pace, 0 does not wait at all). upload bodies are
+// still read through the request's read callback, so file reading costs
+// what it did
+Transport *transport_replayer_create(const char *path, double speed);
+
+#endif
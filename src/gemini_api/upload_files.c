@@ -0,0 +1,364 @@
+#include "upload_files.h"
+
+typedef enum UploadStage {
+  UPLOAD_PENDING,
+  UPLOAD_START,  // resumable start, waiting for X-Goog-Upload-URL
+  UPLOAD_BYTES,  // one chunk of "upload" or "upload, finalize"
+  UPLOAD_QUERY,  // asking where to resume after a failed chunk
+  UPLOAD_DONE,
+  UPLOAD_FAILED,
+} UploadStage;
+
+typedef struct UploadJob {
+  const char *path;
+  const char *mime;
+  FileUpload upload;
+  char *upload_url;
+  GeminiFile file;
+
+  UploadStage stage;
+  int start_attempts;
+  bool scheduled; // holds a scheduler token for the request in flight
+  // a failed request is sent again as retry_stage once get_time_ms()
+  // passes retry_at, 0 while nothing waits
+  double retry_at;
+  UploadStage retry_stage;
+  CURL *curl;
+  TransportRequest request;
+  struct curl_slist *headers;
+  Memory mem;
+
+  // finished outside the multi handle, see upload_job_submit()
+  bool finished;
+  CURLcode result;
+} UploadJob;
+
+static void upload_job_release(UploadJob *job) {
+  curl_slist_free_all(job->headers);
+  job->headers = NULL;
+
+  if (job->curl)
+    curl_easy_cleanup(job->curl);
+  job->curl = NULL;
+
+  file_upload_close(&job->upload);
+  free(job->upload_url);
+  job->upload_url = NULL;
+  memory_release(&job->mem);
+}
+
+static void upload_job_fail(UploadJob *job, const char *reason) {
+  fprintf(stderr, "[ERROR] Upload of %s failed: %s\n", job->path, reason);
+  job->stage = UPLOAD_FAILED;
+  gemini_file_free(&job->file);
+  upload_job_release(job);
+}
+
+static void upload_job_reset_memory(UploadJob *job) {
+  if (!job->mem.response)
+    memory_init(&job->mem);
+  memory_clear(&job->mem);
+}
+
+// hands the prepared request to the multi handle, or runs it to the end
+// right here when the transport can't be driven by one (recording,
+// replaying), the loop in upload_files() picks it up either way
+static void upload_job_submit(GeminiClient *client, CURLM *multi,
+                              UploadJob *job) {
+  CURLcode result = transport_send(client->transport, job->curl, &job->request);
+
+  if (result == CURLE_OK && client->transport->multi) {
+    curl_easy_setopt(job->curl, CURLOPT_PRIVATE, (void *)job);
+    curl_multi_add_handle(multi, job->curl);
+    return;
+  }
+
+  if (result == CURLE_OK)
+    result = transport_receive(client->transport, job->curl, &job->request);
+
+  job->result = result;
+  job->finished = true;
+}
+
+// prepares and queues the next request of job, the start request, a chunk
+// or a query for where to resume. each one takes a scheduler token with
+// the client's priority first, when none is free it goes out again after
+// UPLOAD_SCHEDULER_RETRY_MS instead of holding up the other transfers
+static void upload_job_send(GeminiClient *client, CURLM *multi,
+                            UploadJob *job, UploadStage stage) {
+  upload_job_reset_memory(job);
+
+  if (stage == UPLOAD_START) {
+    job->headers =
+        get_upload_url_prepare(client, job->curl, job->upload.size,
+                               (char *)job->mime, &job->mem, &job->request);
+  } else if (stage == UPLOAD_BYTES) {
+    job->headers = get_file_uri_prepare(client, job->curl, &job->upload,
+                                        &job->mem, &job->request);
+  } else {
+    job->headers = get_upload_offset_prepare(client, job->curl, &job->upload,
+                                             &job->mem, &job->request);
+  }
+
+  double queued_ms = 0;
+  if (request_scheduler_acquire(
+          client->policy ? client->policy->scheduler : NULL,
+          job->request.endpoint, client->priority, client->cancel,
+          UPLOAD_SCHEDULER_TRY_MS, &queued_ms) != CURLE_OK) {
+    curl_slist_free_all(job->headers);
+    job->headers = NULL;
+    job->retry_stage = stage;
+    job->retry_at = get_time_ms() + UPLOAD_SCHEDULER_RETRY_MS;
+    return;
+  }
+
+  if (stage == UPLOAD_START)
+    job->start_attempts++;
+  job->scheduled = true;
+  job->stage = stage;
+  upload_job_submit(client, multi, job);
+}
+
+// sends stage again after the policy's backoff or the server's
+// Retry-After, without holding up the other uploads meanwhile
+static int upload_job_retry(GeminiClient *client, UploadJob *job,
+                            CURLcode result, UploadStage stage, int attempt,
+                            Memory *headers, Memory *body) {
+  long wait_ms =
+      request_policy_retry_ms(client->policy, attempt, headers, body);
+  if (result == CURLE_OK)
+    fprintf(stderr, "[INFO] Upload of %s got HTTP %ld, retrying in %ld ms\n",
+            job->path, job->request.status, wait_ms);
+  else
+    fprintf(stderr, "[INFO] Upload of %s failed (%s), retrying in %ld ms\n",
+            job->path, curl_easy_strerror(result), wait_ms);
+
+  job->retry_stage = stage;
+  job->retry_at = get_time_ms() + (wait_ms > 0 ? wait_ms : 1);
+
+  return 1;
+}
+
+// opens the file and queues the resumable start request, unless the same
+// content was uploaded before and its uri is still valid
+static int upload_job_start(GeminiClient *client, FileCache *cache,
+                            CURLM *multi, UploadJob *job) {
+  job->mime = get_file_mime_type(job->path);
+  if (!job->mime) {
+    upload_job_fail(job, "unsupported file type");
+    return 0;
+  }
+
+  job->file.mime = job->mime;
+  if (job->file.hash[0] == '\0' &&
+      sha256_file(job->path, job->file.hash) != 0) {
+    upload_job_fail(job, "could not read file");
+    return 0;
+  }
+
+  if (file_cache_lookup(cache, job->file.hash, &job->file)) {
+    job->stage = UPLOAD_DONE;
+    return 0;
+  }
+
+  job->curl = curl_easy_init();
+  if (file_upload_open(&job->upload, job->path) != 0 || !job->curl) {
+    upload_job_fail(job, "could not read file");
+    return 0;
+  }
+
+  upload_job_send(client, multi, job, UPLOAD_START);
+
+  return 1;
+}
+
+// moves a finished transfer to its next stage, returns 1 while the job
+// still has a request in flight
+static int upload_job_advance(GeminiClient *client, FileCache *cache,
+                              CURLM *multi, UploadJob *job, CURLcode result) {
+  if (client->transport->network)
+    net_telemetry_record(client->policy->telemetry, job->request.endpoint,
+                         job->curl, result);
+  if (client->transport->multi)
+    curl_multi_remove_handle(multi, job->curl);
+  curl_slist_free_all(job->headers);
+  job->headers = NULL;
+
+  UploadChunkResult chunk_result = UPLOAD_CHUNK_NEXT;
+  long status = job->request.status;
+
+  // the status feeds the endpoint's rate. time to first byte includes
+  // sending the chunk, so no latency sample
+  if (job->scheduled && client->policy)
+    request_scheduler_release(client->policy->scheduler,
+                              job->request.endpoint, client->priority, status,
+                              -1);
+  job->scheduled = false;
+
+  if (job->stage == UPLOAD_START) {
+    if (result == CURLE_OK && status == 200)
+      job->upload_url = grep_string(job->mem.response);
+
+    // the start request is retried like any other call, chunk failures
+    // are resumed below
+    if (!job->upload_url) {
+      int max_attempts = client->policy ? client->policy->max_attempts : 1;
+      if (request_policy_retryable(result, status) &&
+          job->start_attempts < max_attempts)
+        return upload_job_retry(client, job, result, UPLOAD_START,
+                                job->start_attempts, &job->mem, NULL);
+
+      upload_job_fail(job, result != CURLE_OK ? curl_easy_strerror(result)
+                                              : "no upload url in response");
+      return 0;
+    }
+
+    job->upload.upload_url = job->upload_url;
+    job->upload.mime = (char *)job->mime;
+  } else if (job->stage == UPLOAD_BYTES) {
+    chunk_result = get_file_uri_chunk_result(&job->upload, result,
+                                             job->request.status);
+  } else {
+    chunk_result = get_upload_offset_result(&job->upload, result,
+                                            job->request.status);
+  }
+
+  if (chunk_result == UPLOAD_CHUNK_FAILED) {
+    upload_job_fail(job, "chunk rejected");
+    return 0;
+  }
+
+  // a resume asks where to continue once the server had time to recover
+  if (chunk_result == UPLOAD_CHUNK_RESUME)
+    return upload_job_retry(client, job, result, UPLOAD_QUERY,
+                            job->upload.resumes, &job->upload.headers,
+                            &job->mem);
+
+  if (chunk_result == UPLOAD_CHUNK_NEXT) {
+    upload_job_send(client, multi, job, UPLOAD_BYTES);
+    return 1;
+  }
+
+  if (get_file_uri_parse(&job->mem, &job->file) != 0) {
+    upload_job_fail(job, "no file uri in response");
+    return 0;
+  }
+
+  file_cache_store(cache, &job->file);
+
+  job->stage = UPLOAD_DONE;
+  upload_job_release(job);
+
+  return 0;
+}
+
+int upload_files(GeminiClient *client, FileCache *cache, const char **paths,
+                 size_t count, int max_concurrent, GeminiFile *out_files) {
+  if (count == 0)
+    return 0;
+
+  if (max_concurrent < 1)
+    max_concurrent = UPLOAD_DEFAULT_CONCURRENCY;
+
+  // the client's, its parsed CA store and connections outlive the call
+  UploadJob *jobs = calloc(count, sizeof(UploadJob));
+  CURLM *multi = client->multi;
+  if (!jobs)
+    return 0;
+
+  // both stages talk to the same host, let HTTP/2 carry them on one
+  // connection when the server allows it
+  curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+  curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)max_concurrent);
+
+  size_t next = 0;
+  int active = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    jobs[i].path = paths[i];
+    jobs[i].stage = UPLOAD_PENDING;
+    memcpy(jobs[i].file.hash, out_files[i].hash, sizeof(jobs[i].file.hash));
+  }
+
+  do {
+    // a file only holds memory while it is one of the active uploads
+    // cancelled: let the running transfers abort, start nothing new
+    if (client->cancel && *client->cancel)
+      next = count;
+
+    while (active < max_concurrent && next < count) {
+      active += upload_job_start(client, cache, multi, &jobs[next++]);
+    }
+
+    int running = 0;
+    curl_multi_perform(multi, &running);
+
+    CURLMsg *msg;
+    int msgs_left;
+    while ((msg = curl_multi_info_read(multi, &msgs_left)) != NULL) {
+      if (msg->msg != CURLMSG_DONE)
+        continue;
+
+      UploadJob *job = NULL;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&job);
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE,
+                        &job->request.status);
+      transport_count(client->transport, job->curl, &job->request);
+
+      if (!upload_job_advance(client, cache, multi, job, msg->data.result))
+        active--;
+    }
+
+    for (size_t i = 0; i < next; i++) {
+      if (!jobs[i].finished)
+        continue;
+
+      jobs[i].finished = false;
+      if (!upload_job_advance(client, cache, multi, &jobs[i], jobs[i].result))
+        active--;
+    }
+
+    // retries whose wait is over go out again, the rest bound the poll
+    bool cancelled = client->cancel && *client->cancel;
+    double now = get_time_ms();
+    long wait_ms = 1000;
+    for (size_t i = 0; i < next; i++) {
+      UploadJob *job = &jobs[i];
+      if (job->retry_at == 0)
+        continue;
+
+      if (cancelled) {
+        job->retry_at = 0;
+        upload_job_fail(job, "cancelled");
+        active--;
+      } else if (now >= job->retry_at) {
+        job->retry_at = 0;
+        upload_job_send(client, multi, job, job->retry_stage);
+      } else if (job->retry_at - now < wait_ms) {
+        wait_ms = (long)(job->retry_at - now) + 1;
+      }
+    }
+
+    // without the multi handle everything above ran to the end already,
+    // only retries can still be waiting
+    if (active > 0 && client->transport->multi)
+      curl_multi_poll(multi, NULL, 0, (int)wait_ms, NULL);
+    else if (active > 0)
+      delay(wait_ms < 50 ? wait_ms : 50);
+  } while (active > 0 || next < count);
+
+  int uploaded = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (jobs[i].stage != UPLOAD_DONE)
+      continue;
+
+    out_files[uploaded++] = jobs[i].file;
+  }
+
+  // every handle left the multi handle as its job ended, hedges get it
+  // back without the cap
+  curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, 0L);
+  free(jobs);
+
+  return uploaded;
+}
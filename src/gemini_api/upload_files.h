@@ -0,0 +1,33 @@
+#ifndef UPLOADFILES_H
+#define UPLOADFILES_H
+
+#include "../cache/file_cache.h"
+#include "../callbacks/write_callback.h"
+#include "../types/types.h"
+#include "../utils/get_file_mime_type.h"
+#include "../utils/grep_string.h"
+#include "../utils/sha256.h"
+#include "gemini_client.h"
+#include "get_file_uri.h"
+#include "get_upload_url.h"
+
+#include <curl/curl.h>
+#include <stdlib.h>
+
+#define UPLOAD_DEFAULT_CONCURRENCY 4
+// how long a transfer may wait for a scheduler token in the loop, and how
+// soon it asks again when none came up
+#define UPLOAD_SCHEDULER_TRY_MS 1
+#define UPLOAD_SCHEDULER_RETRY_MS 50
+
+// uploads every path through the File API at once on a curl multi handle,
+// at most max_concurrent files are in flight, each streamed from disk in
+// UPLOAD_CHUNK_SIZE pieces. files whose sha256 is in cache (may be NULL)
+// skip the network entirely, a hash already set in out_files[i] is reused.
+// out_files (count slots) gets the successful uploads in selection order,
+// failed files are skipped. returns how many there are, release each with
+// gemini_file_free()
+int upload_files(GeminiClient *client, FileCache *cache, const char **paths,
+                 size_t count, int max_concurrent, GeminiFile *out_files);
+
+#endif
@@ -14,20 +14,39 @@
 #include <string.h>
 #include <time.h>
 
+#include <conio.h>
 #include <windows.h>
 #undef MOUSE_MOVED // remove redefinition errors from wincon.h macro
 #include <curses.h>
 
 #include "pages/introduction.h"
-
+#include "pages/network_stats.h"
+#include "pages/token_report.h"
+
+#include "cache/cache_db.h"
+#include "cache/file_cache.h"
+#include "cache/response_cache.h"
+
+#include "gemini_api/connection_warmup.h"
+#include "gemini_api/context_cache.h"
+#include "gemini_api/conversation.h"
+#include "gemini_api/gemini_batch.h"
+#include "gemini_api/gemini_client.h"
+#include "gemini_api/gemini_engine.h"
 #include "gemini_api/gemini_request.h"
+#include "gemini_api/gemini_request_stream.h"
 #include "gemini_api/get_file_uri.h"
 #include "gemini_api/get_upload_url.h"
+#include "gemini_api/model_router.h"
+#include "gemini_api/transport_record.h"
+#include "gemini_api/transport_replay.h"
+#include "gemini_api/upload_files.h"
 
+#include "utils/delay.h"
 #include "utils/gemini_loading.h"
 #include "utils/get_file_mime_type.h"
+#include "utils/memory_buffer.h"
 #include "utils/read_file.h"
-#include "utils/read_file_b64.h"
 
 #define QUOTE(...) #__VA_ARGS__ // pre-processor to turn content into string
 
@@ -50,6 +69,215 @@ void enableVirtualTerminal() {
 #endif
 }
 
+// joins the dots thread, false when it was already stopped
+bool stop_dots(pthread_t *loading_thread) {
+  if (!is_generating)
+    return false;
+
+  is_generating = false;
+  pthread_join(*loading_thread, NULL);
+
+  return true;
+}
+
+// runs right before the first streamed text is printed
+void stop_loading(void *arg) {
+  if (stop_dots((pthread_t *)arg))
+    printf("✓\n\033[97mGemini response:\n");
+}
+
+// non-blocking, drains pending keys and reports whether Esc was one
+bool escape_pressed(void) {
+#ifdef _WIN32
+  while (_kbhit()) {
+    if (_getch() == 27)
+      return true;
+  }
+#endif
+  return false;
+}
+
+bool escape_stop(void *arg) { return escape_pressed(); }
+
+// the next prompt, typed while an answer is still on its way
+typedef struct TypeAhead {
+  char text[512];
+  size_t len;
+  bool ready; // Enter was pressed, it runs once the answer is done
+} TypeAhead;
+
+// non-blocking, drains pending keys into ahead without echoing them over
+// the answer. reports whether Esc was one of them
+bool read_keys(TypeAhead *ahead) {
+  bool escape = false;
+#ifdef _WIN32
+  while (_kbhit()) {
+    int key = _getch();
+    if (key == 0 || key == 224) {
+      _getch(); // arrows and function keys come as two codes
+    } else if (key == 27) {
+      escape = true;
+    } else if (ahead->ready) {
+      // one prompt ahead is enough
+    } else if (key == '\r') {
+      ahead->ready = ahead->len > 0;
+    } else if (key == '\b') {
+      if (ahead->len > 0)
+        ahead->len--;
+    } else if (key >= 32 && ahead->len + 1 < sizeof(ahead->text)) {
+      ahead->text[ahead->len++] = (char)key;
+    }
+    ahead->text[ahead->len] = '\0';
+  }
+#endif
+  return escape;
+}
+
+// body bytes on the wire next to what they decode to, what compression saved
+void print_wire_stats(Transport *transport) {
+  TransportStats stats;
+  transport_stats(transport, &stats);
+  if (stats.requests == 0)
+    return;
+
+  printf("[INFO] %llu request(s): sent %.1f KiB (%.1f KiB before gzip), "
+         "received %.1f KiB (%.1f KiB decoded)\n",
+         stats.requests, stats.wire_sent / 1024.0, stats.body_sent / 1024.0,
+         stats.wire_received / 1024.0, stats.body_received / 1024.0);
+}
+
+// one prompt over every selected file as a single batch job, answers are
+// matched back to their files and cached like interactive ones
+void run_batch(GeminiClient *client, FileCache *file_cache,
+               ResponseCache *response_cache, int upload_concurrency) {
+  char batchPrompt[512];
+
+  printf("\033[97mBatch prompt, asked once per file: \033[0m");
+  if (fgets(batchPrompt, sizeof(batchPrompt), stdin) == NULL)
+    return;
+  batchPrompt[strcspn(batchPrompt, "\n")] = '\0';
+
+  nfdpathset_t pathSet = {0};
+  if (NFD_OpenDialogMultiple("png,jpeg,jpg,pdf", NULL, &pathSet) !=
+      NFD_OKAY)
+    return;
+
+  size_t count = NFD_PathSet_GetCount(&pathSet);
+  GeminiFile *hashed = calloc(count + 1, sizeof(GeminiFile));
+  GeminiFile *files = calloc(count + 1, sizeof(GeminiFile));
+  const char **todo_paths = malloc((count + 1) * sizeof(char *));
+  size_t *todo_index = malloc((count + 1) * sizeof(size_t));
+  GeminiBatchItem *items = calloc(count + 1, sizeof(GeminiBatchItem));
+  size_t *item_index = malloc((count + 1) * sizeof(size_t));
+  char(*keys)[65] = calloc(count + 1, sizeof(*keys));
+
+  if (!hashed || !files || !todo_paths || !todo_index || !items ||
+      !item_index || !keys) {
+    fprintf(stderr, "[ERROR] Out of memory for a batch of %zu files.\n",
+            count);
+    count = 0;
+  }
+
+  // files already answered for this prompt skip the batch entirely
+  size_t pending = 0;
+  for (size_t i = 0; i < count; i++) {
+    const char *path = NFD_PathSet_GetPath(&pathSet, i);
+    sha256_file(path, hashed[i].hash);
+    response_cache_key(batchPrompt, &hashed[i], 1, client->api_url, keys[i]);
+
+    char *cached = response_cache_get(response_cache, keys[i], false);
+    if (cached) {
+      printf("\033[96m== %s ==\033[0m\n%s\n", path, cached);
+      free(cached);
+      continue;
+    }
+
+    todo_paths[pending] = path;
+    todo_index[pending] = i;
+    memcpy(files[pending].hash, hashed[i].hash, sizeof(files[i].hash));
+    pending++;
+  }
+
+  if (pending > 0) {
+    pthread_t generate_thread = {0};
+    is_generating = true;
+    pthread_create(&generate_thread, NULL, gemini_loading, NULL);
+
+    int uploaded = upload_files(client, file_cache, todo_paths, pending,
+                                upload_concurrency, files);
+
+    // upload_files keeps only successes, find each one's path by hash
+    size_t item_count = 0;
+    for (int j = 0; j < uploaded; j++) {
+      for (size_t k = 0; k < pending; k++) {
+        size_t i = todo_index[k];
+        if (strcmp(files[j].hash, hashed[i].hash) != 0)
+          continue;
+
+        GeminiBatchItem *item = &items[item_count];
+        item->key = keys[i];
+        item->prompt = batchPrompt;
+        item->file_uris = &files[j].uri;
+        item->file_mime_types = (char **)&files[j].mime;
+        item->file_count = 1;
+        item_index[item_count++] = i;
+        break;
+      }
+    }
+
+    GeminiBatch batch = {0};
+    batch.items = items;
+    batch.count = item_count;
+
+    // Esc stops waiting and cancels the job on the server too
+    bool cancelled = false;
+    if (item_count > 0 &&
+        gemini_batch_submit(client, &batch, "success batch") == 0) {
+      GeminiBatchState state =
+          gemini_batch_wait(client, &batch, escape_stop, NULL);
+      cancelled = !gemini_batch_is_final(state);
+      if (cancelled)
+        gemini_batch_cancel(client, &batch);
+    }
+
+    stop_dots(&generate_thread);
+    printf("\033[0m\n");
+
+    if (cancelled) {
+      printf("[INFO] Cancelled batch %s\n", batch.name);
+    } else if (batch.name) {
+      printf("[INFO] Batch %s %s after %d poll(s)\n", batch.name,
+             gemini_batch_state_name(batch.state), batch.polls);
+    }
+
+    for (size_t n = 0; n < item_count; n++) {
+      const char *path = NFD_PathSet_GetPath(&pathSet, item_index[n]);
+
+      if (items[n].response) {
+        printf("\033[96m== %s ==\033[0m\n%s\n", path, items[n].response);
+        response_cache_put(response_cache, items[n].key, items[n].response);
+      } else if (items[n].error) {
+        printf("\033[91m== %s ==\033[0m\n[ERROR] %s\n", path,
+               items[n].error);
+      }
+    }
+
+    gemini_batch_free(&batch);
+    for (int j = 0; j < uploaded; j++) {
+      gemini_file_free(&files[j]);
+    }
+  }
+
+  free(hashed);
+  free(files);
+  free(todo_paths);
+  free(todo_index);
+  free(items);
+  free(item_index);
+  free(keys);
+  NFD_PathSet_Free(&pathSet);
+}
+
 int main(void) {
   // Set locale BEFORE calling any curses functions
   setlocale(LC_ALL, "en_US.UTF-8");
@@ -63,8 +291,6 @@ int main(void) {
 
   enableVirtualTerminal();
 
-  introduction_page();
-
   // setvbuf(stdout, NULL, _IONBF, 0);
 
   char *env_json = read_file("../env.json");
@@ -99,6 +325,302 @@ int main(void) {
     fprintf(stderr, "GEMINI_FILE_URL environment variable not set.\n");
   }
 
+  // print answers while they are generated instead of after
+  bool stream_response =
+      cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(env, "GEMINI_STREAM"));
+
+  // how many attachments upload at the same time
+  int upload_concurrency = UPLOAD_DEFAULT_CONCURRENCY;
+  cJSON *gemini_upload_concurrency =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_UPLOAD_CONCURRENCY");
+  if (cJSON_IsNumber(gemini_upload_concurrency) &&
+      gemini_upload_concurrency->valueint > 0) {
+    upload_concurrency = gemini_upload_concurrency->valueint;
+  }
+
+  // non-streamed answers bigger than this go to a temp file while they
+  // arrive instead of the heap, 0 keeps them in memory
+  cJSON *gemini_response_spill_bytes =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_RESPONSE_SPILL_BYTES");
+  if (cJSON_IsNumber(gemini_response_spill_bytes) &&
+      gemini_response_spill_bytes->valuedouble >= 0) {
+    memory_set_spill_at((size_t)gemini_response_spill_bytes->valuedouble);
+  }
+
+  // and bigger than this are cut off and reported, 0 for no limit
+  cJSON *gemini_response_max_bytes =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_RESPONSE_MAX_BYTES");
+  if (cJSON_IsNumber(gemini_response_max_bytes) &&
+      gemini_response_max_bytes->valuedouble >= 0) {
+    memory_set_limit((size_t)gemini_response_max_bytes->valuedouble);
+  }
+
+  // initialized once so every prompt reuses the same connections and TLS
+  // sessions instead of paying a full handshake per call
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  GeminiClient *client =
+      gemini_client_create(gemini_api_url->valuestring,
+                           gemini_file_url->valuestring,
+                           gemini_api_key->valuestring);
+  if (!client) {
+    curl_global_cleanup();
+    free(env_json);
+    cJSON_Delete(env);
+    return EXIT_FAILURE;
+  }
+
+  // root certificates for every handshake. GEMINI_CA_BUNDLE points
+  // elsewhere, relative paths start from the executable's directory
+  cJSON *gemini_ca_bundle =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_CA_BUNDLE");
+  const char *ca_bundle_path =
+      cJSON_IsString(gemini_ca_bundle) && gemini_ca_bundle->valuestring[0]
+          ? gemini_ca_bundle->valuestring
+          : GEMINI_CLIENT_DEFAULT_CA_BUNDLE;
+
+  if (gemini_client_set_ca_bundle(client, ca_bundle_path) == 0)
+    printf("[INFO] Using CA bundle %s\n", client->ca_bundle);
+  else
+    fprintf(stderr,
+            "[ERROR] Failed to open CA bundle %s, using libcurl's default\n",
+            ca_bundle_path);
+
+  // every exchange with the API written to a file, or served back from one
+  // at its recorded pace (GEMINI_REPLAY_SPEED, 0 for no waits) with no
+  // network at all, to profile parsing and rendering on real traffic
+  cJSON *gemini_record =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_RECORD");
+  cJSON *gemini_replay =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_REPLAY");
+  cJSON *gemini_replay_speed =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_REPLAY_SPEED");
+  const char *record_path =
+      cJSON_IsString(gemini_record) && gemini_record->valuestring[0]
+          ? gemini_record->valuestring
+          : NULL;
+  const char *replay_path =
+      cJSON_IsString(gemini_replay) && gemini_replay->valuestring[0]
+          ? gemini_replay->valuestring
+          : NULL;
+
+  if (replay_path || record_path) {
+    double replay_speed = cJSON_IsNumber(gemini_replay_speed)
+                              ? gemini_replay_speed->valuedouble
+                              : 1.0;
+    Transport *transport =
+        replay_path ? transport_replayer_create(replay_path, replay_speed)
+                    : transport_recorder_create(client->transport, record_path);
+    if (!transport) {
+      gemini_client_destroy(client);
+      curl_global_cleanup();
+      free(env_json);
+      cJSON_Delete(env);
+      return EXIT_FAILURE;
+    }
+
+    // the recorder owns the curl transport now, the replayer needs none
+    if (replay_path)
+      transport_destroy(client->transport);
+    client->transport = transport;
+  }
+
+  // resolved addresses stay pinned this long (-1 for ever) and are looked
+  // up again in the background before they expire. GEMINI_RESOLVE pins
+  // "host:port:address" entries outright, like curl's --resolve
+  cJSON *gemini_dns_pin_s =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_DNS_PIN_S");
+  if (cJSON_IsNumber(gemini_dns_pin_s) && gemini_dns_pin_s->valuedouble >= -1)
+    client->dns_pin_s = (long)gemini_dns_pin_s->valuedouble;
+
+  cJSON *gemini_resolve =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_RESOLVE");
+  cJSON *pin;
+  cJSON_ArrayForEach(pin, gemini_resolve) {
+    if (cJSON_IsString(pin))
+      client->resolve = curl_slist_append(client->resolve, pin->valuestring);
+  }
+
+  // request bodies from this size on are sent gzipped, 0 (the default)
+  // never. answers come compressed whatever this says
+  cJSON *gemini_gzip_request_bytes =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_GZIP_REQUEST_BYTES");
+  if (cJSON_IsNumber(gemini_gzip_request_bytes) &&
+      gemini_gzip_request_bytes->valuedouble >= 0)
+    client->gzip_request_bytes = (size_t)gemini_gzip_request_bytes->valuedouble;
+
+  // attachments up to this size go base64 in the generate body, one round
+  // trip instead of three, 0 uploads everything. GEMINI_REQUEST_LIMIT caps
+  // the body they go in
+  cJSON *gemini_inline_attachment_bytes =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_INLINE_ATTACHMENT_BYTES");
+  if (cJSON_IsNumber(gemini_inline_attachment_bytes) &&
+      gemini_inline_attachment_bytes->valuedouble >= 0)
+    client->inline_attachment_bytes =
+        (size_t)gemini_inline_attachment_bytes->valuedouble;
+
+  cJSON *gemini_request_limit =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_REQUEST_LIMIT");
+  if (cJSON_IsNumber(gemini_request_limit) &&
+      gemini_request_limit->valuedouble > 0)
+    client->request_limit = (size_t)gemini_request_limit->valuedouble;
+
+  // caches and network telemetry, opened before the warmup so its first
+  // handshakes are measured too. telemetry and the response cache write in
+  // transactions and get connections of their own
+  sqlite3 *cache_db = cache_db_open();
+  sqlite3 *telemetry_db = cache_db_open();
+  NetTelemetry *telemetry = net_telemetry_open(telemetry_db);
+  client->policy->telemetry = telemetry;
+
+  // tokens of every answer per day, user and feature. a request that would
+  // go past GEMINI_DAILY_TOKEN_BUDGET (0 for none) is not sent, users in
+  // GEMINI_USER_TOKEN_BUDGETS get their own limit
+  TokenLedger *token_ledger = token_ledger_open(cache_db);
+  client->usage = token_ledger;
+
+  cJSON *gemini_daily_token_budget =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_DAILY_TOKEN_BUDGET");
+  if (cJSON_IsNumber(gemini_daily_token_budget))
+    token_ledger_set_budget(token_ledger, NULL,
+                            (long long)gemini_daily_token_budget->valuedouble);
+
+  cJSON *gemini_user_token_budgets =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_USER_TOKEN_BUDGETS");
+  cJSON *user_budget;
+  cJSON_ArrayForEach(user_budget, gemini_user_token_budgets) {
+    if (cJSON_IsNumber(user_budget) && user_budget->string)
+      token_ledger_set_budget(token_ledger, user_budget->string,
+                              (long long)user_budget->valuedouble);
+  }
+
+  // DNS, TCP and TLS to both hosts happen on the client's handles while
+  // the introduction is on screen, the first prompt then reuses them
+  ConnectionWarmup warmup = {0};
+  connection_warmup_start(&warmup, client);
+
+  introduction_page();
+
+  // whoever logged in on the introduction pages spends the tokens
+  client->user = logged_in_user[0] ? logged_in_user : "guest";
+
+  connection_warmup_wait(&warmup);
+  if (warmup.warmed)
+    printf("[INFO] Connections warmed up in %.0f ms\n", warmup.first_round_ms);
+
+  // deadline of a whole call including retries, attempts before giving up
+  // and whether slow answers may be raced by a duplicate request
+  cJSON *gemini_deadline_ms =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_DEADLINE_MS");
+  cJSON *gemini_max_attempts =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_MAX_ATTEMPTS");
+  if (cJSON_IsNumber(gemini_deadline_ms) &&
+      gemini_deadline_ms->valuedouble >= 0)
+    client->policy->deadline_ms = (long)gemini_deadline_ms->valuedouble;
+  if (cJSON_IsNumber(gemini_max_attempts) && gemini_max_attempts->valueint > 0)
+    client->policy->max_attempts = gemini_max_attempts->valueint;
+  client->policy->hedge =
+      cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(env, "GEMINI_HEDGE"));
+
+  // requests per second per endpoint (GEMINI_RATE_LIMITS overrides single
+  // ones), halved on every 429 and won back on success. background work
+  // like batches and file refreshes waits while prompts are slower than
+  // GEMINI_INTERACTIVE_P95_MS to their first byte, 0 never holds it back
+  RequestScheduler *scheduler = request_scheduler_create();
+  client->policy->scheduler = scheduler;
+
+  cJSON *gemini_rate_limit =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_RATE_LIMIT");
+  if (cJSON_IsNumber(gemini_rate_limit))
+    request_scheduler_set_rate(scheduler, NULL, gemini_rate_limit->valuedouble);
+
+  cJSON *gemini_rate_limits =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_RATE_LIMITS");
+  cJSON *rate_limit;
+  cJSON_ArrayForEach(rate_limit, gemini_rate_limits) {
+    if (cJSON_IsNumber(rate_limit))
+      request_scheduler_set_rate(scheduler, rate_limit->string,
+                                 rate_limit->valuedouble);
+  }
+
+  cJSON *gemini_interactive_p95_ms =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_INTERACTIVE_P95_MS");
+  if (scheduler && cJSON_IsNumber(gemini_interactive_p95_ms) &&
+      gemini_interactive_p95_ms->valuedouble >= 0)
+    scheduler->target_ms = (long)gemini_interactive_p95_ms->valuedouble;
+
+  cJSON *gemini_background_requests =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_BACKGROUND_REQUESTS");
+  if (scheduler && cJSON_IsNumber(gemini_background_requests) &&
+      gemini_background_requests->valueint > 0) {
+    scheduler->background_max = gemini_background_requests->valueint;
+    scheduler->background_limit = scheduler->background_max;
+  }
+
+  // GEMINI_MODELS lists more generateContent urls with cost and latency
+  // hints. each prompt goes to the model expected to answer first for its
+  // size, attachments and cost, measured latencies replace the hints, and
+  // the next model takes over when one fails. GEMINI_API_URL is always one
+  // of them, the only one that keeps a context cache
+  ModelRouter *router = NULL;
+  cJSON *gemini_models =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_MODELS");
+  if (cJSON_GetArraySize(gemini_models) > 0 &&
+      (router = model_router_create())) {
+    model_router_add(router, "default", client->api_url, 1.0, 0, 0, true);
+
+    cJSON *model;
+    cJSON_ArrayForEach(model, gemini_models) {
+      cJSON *url = cJSON_GetObjectItemCaseSensitive(model, "url");
+      cJSON *name = cJSON_GetObjectItemCaseSensitive(model, "name");
+      cJSON *cost = cJSON_GetObjectItemCaseSensitive(model, "cost");
+      cJSON *latency_ms = cJSON_GetObjectItemCaseSensitive(model, "latency_ms");
+      cJSON *max_prompt_bytes =
+          cJSON_GetObjectItemCaseSensitive(model, "max_prompt_bytes");
+      cJSON *attachments =
+          cJSON_GetObjectItemCaseSensitive(model, "attachments");
+      if (!cJSON_IsString(url))
+        continue;
+
+      const char *label =
+          cJSON_IsString(name) ? name->valuestring : url->valuestring;
+      if (model_router_add(
+              router, label, url->valuestring,
+              cJSON_IsNumber(cost) ? cost->valuedouble : 1.0,
+              cJSON_IsNumber(latency_ms) ? (long)latency_ms->valuedouble : 0,
+              cJSON_IsNumber(max_prompt_bytes)
+                  ? (size_t)max_prompt_bytes->valuedouble
+                  : 0,
+              !cJSON_IsFalse(attachments)) != 0)
+        fprintf(stderr, "[ERROR] No room for model %s\n", url->valuestring);
+    }
+
+    client->router = router;
+  }
+
+  // how long the system prompt and attachments stay cached server side
+  // between follow-up questions, 0 sends them with every request
+  cJSON *gemini_context_cache_ttl =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_CONTEXT_CACHE_TTL");
+  if (cJSON_IsNumber(gemini_context_cache_ttl) &&
+      gemini_context_cache_ttl->valuedouble >= 0)
+    client->context_cache->ttl_s = (long)gemini_context_cache_ttl->valuedouble;
+
+  // earlier turns are sent with every prompt, trimmed to about this many
+  // tokens so long sessions don't grow requests without bound
+  size_t history_tokens = CONVERSATION_DEFAULT_TOKEN_BUDGET;
+  cJSON *gemini_history_tokens =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_HISTORY_TOKENS");
+  if (cJSON_IsNumber(gemini_history_tokens) &&
+      gemini_history_tokens->valuedouble > 0)
+    history_tokens = (size_t)gemini_history_tokens->valuedouble;
+
+  // a failure from here on skips the prompt loop, not the cleanup after
+  // it
+  Conversation *conversation = conversation_create(history_tokens);
+  if (!conversation)
+    fprintf(stderr, "[ERROR] Failed to start a conversation.\n");
+
   char *systemPrompt =
       // "CRITICAL RESPONSE RULES: "
       // "- Answer ONLY what is asked - nothing more, nothing less "
@@ -148,28 +670,82 @@ int main(void) {
       "- Don't use line seperators"
       "syntax.";
 
+  // uploaded file uris by content hash, kept fresh in the background. not
+  // while recording or replaying, its timed calls would land between the
+  // prompts' exchanges differently on every run
+  FileCache *file_cache = file_cache_open(cache_db);
+  FileCacheRefresher file_cache_refresher = {0};
+  if (!record_path && !replay_path)
+    file_cache_refresh_start(&file_cache_refresher, file_cache, client);
+
+  // answers to repeated prompts, also served when the network is down
+  long long response_cache_ttl = RESPONSE_CACHE_DEFAULT_TTL;
+  long long response_cache_max_bytes = RESPONSE_CACHE_DEFAULT_MAX_BYTES;
+  cJSON *gemini_response_cache_ttl =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_RESPONSE_CACHE_TTL");
+  cJSON *gemini_response_cache_max_bytes =
+      cJSON_GetObjectItemCaseSensitive(env, "GEMINI_RESPONSE_CACHE_MAX_BYTES");
+  if (cJSON_IsNumber(gemini_response_cache_ttl))
+    response_cache_ttl = (long long)gemini_response_cache_ttl->valuedouble;
+  if (cJSON_IsNumber(gemini_response_cache_max_bytes))
+    response_cache_max_bytes =
+        (long long)gemini_response_cache_max_bytes->valuedouble;
+
+  sqlite3 *response_cache_db = cache_db_open();
+  ResponseCache *response_cache = response_cache_open(
+      response_cache_db, response_cache_ttl, response_cache_max_bytes);
+
+  // escaped once here, every request copies the escaped bytes as is
+  gemini_client_set_system_prompt(client, systemPrompt);
+
+  // prompts run on background workers so the UI can poll and cancel
+  GeminiEngine *engine =
+      conversation ? gemini_engine_create(client, file_cache,
+                                          GEMINI_ENGINE_DEFAULT_WORKERS,
+                                          upload_concurrency)
+                   : NULL;
+  if (conversation && !engine)
+    fprintf(stderr, "[ERROR] Failed to start the request engine.\n");
+  int exit_code = engine ? EXIT_SUCCESS : EXIT_FAILURE;
+
   char userPrompt[512];
-  char fullPrompt[4000];
+  TypeAhead type_ahead = {0};
 
   nfdresult_t nfd_res = NFD_CANCEL;
   nfdpathset_t pathSet = {0};
 
-  while (1) {
-    int total_file_num = 0;
-    char **exts = NULL;
-    char **file_uris = NULL;
+  while (engine) {
+    GeminiFile *files = NULL;
     char *res_gemini_req = NULL;
 
     printf("\033[97mEnter your prompt \033[34m[1 to "
-           "attach files, enter 0 to "
-           "exit]: "
+           "attach files, 2 to batch one prompt over many files, 3 to start "
+           "a new conversation, 4 for network stats, 5 for token usage, "
+           "enter 0 to exit]: "
            "\033[0m");
 
-    if (fgets(userPrompt, sizeof(userPrompt), stdin) != NULL) {
+    // what was typed during the last answer comes first. a finished line
+    // runs as is, an unfinished one is shown and typed on
+    bool prompted = false;
+    if (type_ahead.ready) {
+      memcpy(userPrompt, type_ahead.text, type_ahead.len + 1);
+      printf("%s\n", userPrompt);
+      prompted = true;
+    } else {
+      memcpy(userPrompt, type_ahead.text, type_ahead.len + 1);
+      printf("%s", userPrompt);
+      fflush(stdout);
+      prompted = fgets(userPrompt + type_ahead.len,
+                       sizeof(userPrompt) - type_ahead.len, stdin) != NULL;
+    }
+    type_ahead = (TypeAhead){0};
+
+    if (prompted) {
       userPrompt[strcspn(userPrompt, "\n")] = '\0';
 
       if (strcmp(userPrompt, "0") == 0) {
         printf("[INFO] Exited\n");
+        print_wire_stats(client->transport);
         break;
       } else if (strcmp(userPrompt, "1") == 0) {
         nfd_res = NFD_OpenDialogMultiple("png,jpeg,jpg,pdf", NULL, &pathSet);
@@ -179,107 +755,161 @@ int main(void) {
           printf("Path %i: %s\n", (int)i, path);
         }
 
+        continue;
+      } else if (strcmp(userPrompt, "2") == 0) {
+        run_batch(client, file_cache, response_cache, upload_concurrency);
+        continue;
+      } else if (strcmp(userPrompt, "3") == 0) {
+        conversation_clear(conversation);
+        printf("[INFO] Started a new conversation\n");
+        continue;
+      } else if (strcmp(userPrompt, "4") == 0) {
+        network_stats_page(telemetry, scheduler, router);
+        continue;
+      } else if (strcmp(userPrompt, "5") == 0) {
+        token_report_page(token_ledger, client->user);
         continue;
       }
     }
-    snprintf(fullPrompt, sizeof(fullPrompt),
-             "System Prompt: %s\nUser Prompt: %s", systemPrompt, userPrompt);
-
-    // printf("Full prompt:%s\n", fullPrompt);
-
-    pthread_t generate_thread = {0};
-
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-
-    is_generating = true;
-    pthread_create(&generate_thread, NULL, gemini_loading, NULL);
-
-    if (nfd_res == NFD_OKAY) {
-      total_file_num = NFD_PathSet_GetCount(&pathSet);
-
-      int capacity = 0;
-
-      // printf("im here loop\n");
-
-      for (size_t i = 0; i < total_file_num; ++i) {
-        nfdchar_t *path = NFD_PathSet_GetPath(&pathSet, i);
-
-        size_t encoded_len;
-        unsigned char *file_data = read_file_b64(path, &encoded_len);
-        const char *ext = get_file_mime_type(path);
-
-        // printf("im here loop 2\n");
-
-        char *res_upload_url =
-            get_upload_url(encoded_len, gemini_file_url->valuestring,
-                           gemini_api_key->valuestring, (char *)ext);
-
-        // printf("im here loop 3\n");
-
-        char *res_file_uri =
-            get_file_uri(file_data, encoded_len, path, res_upload_url,
-                         gemini_api_key->valuestring, (char *)ext);
-
-        // printf("im here loop 4\n");
-
-        capacity = (capacity == 0) ? 1 : (capacity + 1);
-        char **new_ext = realloc(exts, (capacity) * sizeof(char *));
-        char **new_file_uris = realloc(file_uris, (capacity) * sizeof(char *));
-        exts = new_ext;
-        file_uris = new_file_uris;
-
-        exts[i] = (char *)ext;
-        file_uris[i] = res_file_uri;
-
-        free(file_data);
-        free(res_upload_url);
-      }
-
-      // for (size_t j = 0; j < total_file_num; j++) {
-      //   printf("ext %zu: %s\n", j + 1, exts[j]);
-      //   printf("file_uri %zu: %s\n", j + 1, file_uris[j]);
-      // }
-    } else if (nfd_res == NFD_CANCEL) {
-      puts("User pressed cancel.");
-    } else {
-      printf("Error: %s\n", NFD_GetError());
+    size_t path_count =
+        nfd_res == NFD_OKAY ? NFD_PathSet_GetCount(&pathSet) : 0;
+    const char **paths = malloc(path_count * sizeof(char *) + 1);
+    files = calloc(path_count + 1, sizeof(GeminiFile));
+
+    for (size_t i = 0; i < path_count; ++i) {
+      paths[i] = NFD_PathSet_GetPath(&pathSet, i);
+      sha256_file(paths[i], files[i].hash);
     }
 
-    bool query_with_file = total_file_num > 0;
-
-    res_gemini_req = gemini_request(
-        gemini_api_url->valuestring, query_with_file ? file_uris : NULL,
-        gemini_api_key->valuestring, fullPrompt, query_with_file ? exts : NULL,
-        total_file_num);
+    // same question about the same files, answer without the network. only
+    // at the start of a conversation, later answers depend on the history
+    bool fresh_conversation = conversation_turns(conversation) == 0;
+    char cache_key[65];
+    response_cache_key(userPrompt, files, path_count, client->api_url,
+                       cache_key);
+    char answer_key[65];
+    memcpy(answer_key, cache_key, sizeof(answer_key));
+    if (fresh_conversation)
+      res_gemini_req = response_cache_get(response_cache, cache_key, false);
+    // only whole answers are cached and become history, not a stream cut
+    // off by an error or a cancel
+    bool complete = res_gemini_req != NULL;
+    if (res_gemini_req) {
+      printf("✓\n\033[97mGemini response:\n%s\n", res_gemini_req);
+    } else {
+      if (nfd_res == NFD_ERROR)
+        printf("Error: %s\n", NFD_GetError());
+
+      pthread_t generate_thread = {0};
+
+      is_generating = true;
+      pthread_create(&generate_thread, NULL, gemini_loading, NULL);
+
+      // uploads and the request run on a worker, this thread only polls
+      GeminiJob *job = gemini_job_create(userPrompt, paths, files, path_count);
+      GeminiJobStatus status = GEMINI_JOB_FAILED;
+
+      if (job) {
+        job->stream = stream_response;
+        job->on_first_chunk = stop_loading;
+        job->on_first_chunk_arg = &generate_thread;
+        job->conversation = conversation;
+        // tokens are booked per feature, to find the one with big prompts
+        if (path_count > 0)
+          job->feature = "attachments";
+        else if (!fresh_conversation)
+          job->feature = "followup";
+        gemini_engine_submit(engine, job);
+
+        // Esc cancels, anything else is the next prompt being typed
+        while ((status = gemini_job_poll(job)) == GEMINI_JOB_QUEUED ||
+               status == GEMINI_JOB_RUNNING) {
+          if (read_keys(&type_ahead))
+            gemini_job_cancel(job);
+          delay(50);
+        }
 
-    is_generating = false;
-    pthread_cancel(generate_thread);
-    pthread_join(generate_thread, NULL);
+        res_gemini_req = gemini_job_take_response(job);
+        complete = res_gemini_req && job->complete;
+        // a fallback model's answer is kept under that model, the next
+        // lookup for the primary doesn't get it
+        if (complete && job->model_url &&
+            strcmp(job->model_url, client->api_url) != 0)
+          response_cache_key(userPrompt, files, path_count, job->model_url,
+                             answer_key);
+        gemini_job_free(job);
+      }
 
-    printf("✓\n\033[97mGemini response:\n%s\n", res_gemini_req);
+      if (status == GEMINI_JOB_CANCELLED) {
+        stop_dots(&generate_thread);
+        printf("\033[0m\n[INFO] Cancelled\n");
+      } else if (stream_response) {
+        // the header came with the first chunk. when none arrived only the
+        // dots stop, a failure doesn't look like an empty answer
+        stop_dots(&generate_thread);
+        printf("\033[0m\n");
+      } else {
+        stop_dots(&generate_thread);
+
+        if (res_gemini_req)
+          printf("✓\n\033[97mGemini response:\n%s\n", res_gemini_req);
+      }
 
-    if (query_with_file) {
-      for (size_t i = 0; i < total_file_num; i++) {
-        free(file_uris[i]);
+      if (complete) {
+        if (fresh_conversation)
+          response_cache_put(response_cache, answer_key, res_gemini_req);
+      } else if (res_gemini_req) {
+        printf("[INFO] The answer was cut off, it is not kept\n");
+      } else if (status != GEMINI_JOB_CANCELLED && fresh_conversation) {
+        // offline-first: an expired answer beats none when the network is
+        // down
+        res_gemini_req = response_cache_get(response_cache, cache_key, true);
+        complete = res_gemini_req != NULL;
+        if (res_gemini_req)
+          printf("\033[93m[OFFLINE] Serving a saved answer:\033[0m\n%s\n",
+                 res_gemini_req);
       }
-      free(file_uris);
-      free(exts);
     }
 
-    if (res_gemini_req) {
-      free(res_gemini_req);
-    }
+    free(files);
+    free(paths);
 
-    curl_global_cleanup();
+    // the next prompt is asked as a follow-up to this exchange
+    if (complete)
+      conversation_add_exchange(conversation, userPrompt, res_gemini_req);
+    free(res_gemini_req);
 
     nfd_res = NFD_CANCEL;
     NFD_PathSet_Free(&pathSet);
     memset(&pathSet, 0, sizeof(pathSet));
+
+    // a crash later on loses at most the next prompt's timings
+    net_telemetry_save(telemetry);
   }
 
   NFD_PathSet_Free(&pathSet);
+  gemini_engine_destroy(engine);
+  context_cache_clear(client);
+  file_cache_refresh_stop(&file_cache_refresher);
+  connection_warmup_stop(&warmup);
+  file_cache_close(file_cache);
+  response_cache_close(response_cache);
+  sqlite3_close(response_cache_db);
+  client->policy->telemetry = NULL;
+  net_telemetry_close(telemetry);
+  sqlite3_close(telemetry_db);
+  client->policy->scheduler = NULL;
+  request_scheduler_destroy(scheduler);
+  client->router = NULL;
+  model_router_destroy(router);
+  client->usage = NULL;
+  token_ledger_close(token_ledger);
+  sqlite3_close(cache_db);
+  conversation_destroy(conversation);
+  gemini_client_destroy(client);
+  curl_global_cleanup();
   free(env_json);
   cJSON_Delete(env);
 
-  return EXIT_SUCCESS;
+  return exit_code;
 }
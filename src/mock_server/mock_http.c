@@ -0,0 +1,283 @@
+#include "mock_http.h"
+
+#ifdef MSG_NOSIGNAL
+#define MOCK_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define MOCK_SEND_FLAGS 0
+#endif
+
+// request line plus headers, anything longer is not a client of ours
+#define MOCK_MAX_HEADER_BYTES (64 * 1024)
+#define MOCK_RECV_SIZE (64 * 1024)
+
+int mock_socket_init(void) {
+#ifdef _WIN32
+  WSADATA wsa;
+  return WSAStartup(MAKEWORD(2, 2), &wsa) == 0 ? 0 : -1;
+#else
+  return 0;
+#endif
+}
+
+void mock_close_socket(MockSocket fd) {
+#ifdef _WIN32
+  closesocket(fd);
+#else
+  close(fd);
+#endif
+}
+
+MockSocket mock_listen(int port) {
+  MockSocket fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd == MOCK_INVALID_SOCKET)
+    return MOCK_INVALID_SOCKET;
+
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char *)&on, sizeof(on));
+
+  // loopback only, this is a benchmark target and nothing else
+  struct sockaddr_in addr = {0};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((unsigned short)port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, 64) != 0) {
+    mock_close_socket(fd);
+    return MOCK_INVALID_SOCKET;
+  }
+
+  return fd;
+}
+
+void mock_connection_init(MockConnection *conn, MockSocket fd) {
+  conn->fd = fd;
+  conn->consumed = 0;
+  conn->keep_alive = true;
+  conn->head = false;
+  conn->gzip = false;
+  conn->inflated = NULL;
+  memory_init(&conn->in);
+
+  // SSE chunks must leave as soon as they are written
+  int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof(on));
+}
+
+void mock_connection_close(MockConnection *conn) {
+  mock_close_socket(conn->fd);
+  memory_release(&conn->in);
+  free(conn->inflated);
+}
+
+static int send_all(MockConnection *conn, const char *data, size_t len) {
+  while (len > 0) {
+    int sent = send(conn->fd, data, (int)(len > 1 << 30 ? 1 << 30 : len),
+                    MOCK_SEND_FLAGS);
+    if (sent <= 0)
+      return -1;
+
+    data += sent;
+    len -= sent;
+  }
+
+  return 0;
+}
+
+static int recv_more(MockConnection *conn) {
+  Memory *in = &conn->in;
+  if (memory_reserve(in, MOCK_RECV_SIZE) != 0)
+    return -1;
+
+  int received = recv(conn->fd, in->response + in->size, MOCK_RECV_SIZE, 0);
+  if (received <= 0)
+    return -1;
+
+  in->size += received;
+  in->response[in->size] = '\0';
+
+  return received;
+}
+
+static const char *find_header_end(const char *data, size_t len) {
+  for (size_t i = 0; i + 3 < len; i++) {
+    if (data[i] == '\r' && memcmp(data + i, "\r\n\r\n", 4) == 0)
+      return data + i;
+  }
+
+  return NULL;
+}
+
+int mock_read_request(MockConnection *conn, MockRequest *req) {
+  Memory *in = &conn->in;
+
+  // drop the previous request, keep anything pipelined after it
+  if (conn->consumed > 0) {
+    memmove(in->response, in->response + conn->consumed,
+            in->size - conn->consumed);
+    in->size -= conn->consumed;
+    in->response[in->size] = '\0';
+    conn->consumed = 0;
+  }
+  free(conn->inflated);
+  conn->inflated = NULL;
+
+  const char *end;
+  while (!in->response ||
+         !(end = find_header_end(in->response, in->size))) {
+    if (in->size > MOCK_MAX_HEADER_BYTES || recv_more(conn) < 0)
+      return -1;
+  }
+
+  size_t header_len = end - in->response + 4;
+  // headers end with their last "\r\n", grep_header stops at the NUL
+  in->response[header_len - 2] = '\0';
+
+  char version[16] = {0};
+  if (sscanf(in->response, "%15s %2047s %15s", req->method, req->path,
+             version) != 3)
+    return -1;
+
+  conn->head = strcmp(req->method, "HEAD") == 0;
+
+  const char *first_line_end = strchr(in->response, '\n');
+  if (!first_line_end)
+    return -1;
+
+  size_t body_len = 0;
+  char *content_length = grep_header(first_line_end + 1, "Content-Length");
+  if (content_length) {
+    body_len = strtoull(content_length, NULL, 10);
+    free(content_length);
+  }
+  if (body_len > MOCK_MAX_REQUEST_BYTES)
+    return -1;
+
+  char *connection = grep_header(first_line_end + 1, "Connection");
+  conn->keep_alive = strcmp(version, "HTTP/1.1") == 0 &&
+                     !(connection && strcmp(connection, "close") == 0);
+  free(connection);
+
+  char *accept_encoding = grep_header(first_line_end + 1, "Accept-Encoding");
+  conn->gzip = accept_encoding && strstr(accept_encoding, "gzip");
+  free(accept_encoding);
+
+  char *expect = grep_header(first_line_end + 1, "Expect");
+  if (expect && in->size < header_len + body_len)
+    send_all(conn, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+  free(expect);
+
+  while (in->size < header_len + body_len) {
+    if (recv_more(conn) < 0)
+      return -1;
+  }
+
+  // in may have moved while the body arrived
+  req->headers = strchr(in->response, '\n') + 1;
+  req->body = in->response + header_len;
+  req->body_len = body_len;
+  conn->consumed = header_len + body_len;
+
+  char *content_encoding = grep_header(req->headers, "Content-Encoding");
+  bool gzipped = content_encoding && strcmp(content_encoding, "gzip") == 0;
+  free(content_encoding);
+  if (gzipped) {
+    conn->inflated = gzip_decompress(req->body, req->body_len, &body_len);
+    if (!conn->inflated)
+      return -1;
+    req->body = conn->inflated;
+    req->body_len = body_len;
+  }
+
+  return 0;
+}
+
+static const char *status_text(int status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 400:
+    return "Bad Request";
+  case 403:
+    return "Forbidden";
+  case 404:
+    return "Not Found";
+  case 408:
+    return "Request Timeout";
+  case 429:
+    return "Too Many Requests";
+  case 500:
+    return "Internal Server Error";
+  case 503:
+    return "Service Unavailable";
+  default:
+    return "Status";
+  }
+}
+
+int mock_send_response(MockConnection *conn, int status,
+                       const char *content_type, const char *extra_headers,
+                       const char *body, size_t body_len) {
+  char *gzip = NULL;
+  size_t gzip_len = 0;
+  if (conn->gzip && body_len >= MOCK_GZIP_MIN_BYTES)
+    gzip = gzip_compress(body, body_len, GZIP_DEFAULT_LEVEL, &gzip_len);
+  if (gzip) {
+    body = gzip;
+    body_len = gzip_len;
+  }
+
+  char head[1024];
+  int head_len = snprintf(head, sizeof(head),
+                          "HTTP/1.1 %d %s\r\n"
+                          "Content-Type: %s\r\n"
+                          "Content-Length: %zu\r\n"
+                          "%s%s%s"
+                          "\r\n",
+                          status, status_text(status), content_type, body_len,
+                          gzip ? "Content-Encoding: gzip\r\n" : "",
+                          extra_headers ? extra_headers : "",
+                          conn->keep_alive ? "" : "Connection: close\r\n");
+
+  int sent = -1;
+  if (head_len > 0 && head_len < (int)sizeof(head) &&
+      send_all(conn, head, head_len) == 0)
+    sent = body_len > 0 && !conn->head ? send_all(conn, body, body_len) : 0;
+
+  free(gzip);
+
+  return sent;
+}
+
+int mock_send_chunked_begin(MockConnection *conn, int status,
+                            const char *content_type) {
+  char head[512];
+  int head_len = snprintf(head, sizeof(head),
+                          "HTTP/1.1 %d %s\r\n"
+                          "Content-Type: %s\r\n"
+                          "Transfer-Encoding: chunked\r\n"
+                          "%s"
+                          "\r\n",
+                          status, status_text(status), content_type,
+                          conn->keep_alive ? "" : "Connection: close\r\n");
+
+  return send_all(conn, head, head_len);
+}
+
+int mock_send_chunk(MockConnection *conn, const char *data, size_t len) {
+  if (len == 0)
+    return 0;
+
+  char size_line[32];
+  int size_len = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+
+  if (send_all(conn, size_line, size_len) != 0 ||
+      send_all(conn, data, len) != 0)
+    return -1;
+
+  return send_all(conn, "\r\n", 2);
+}
+
+int mock_send_chunked_end(MockConnection *conn) {
+  return send_all(conn, "0\r\n\r\n", 5);
+}
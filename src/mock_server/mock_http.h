@@ -0,0 +1,77 @@
+#ifndef MOCKHTTP_H
+#define MOCKHTTP_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET MockSocket;
+#define MOCK_INVALID_SOCKET INVALID_SOCKET
+#else
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int MockSocket;
+#define MOCK_INVALID_SOCKET (-1)
+#endif
+
+#include "../types/types.h"
+#include "../utils/grep_string.h"
+#include "../utils/gzip.h"
+#include "../utils/memory_buffer.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// requests bigger than this are refused, an upload chunk is 8 MiB
+#define MOCK_MAX_REQUEST_BYTES (64 * 1024 * 1024)
+// whole responses from this size on are gzipped for clients that accept it
+#define MOCK_GZIP_MIN_BYTES 256
+
+// one parsed HTTP/1.1 request, valid until the next mock_read_request()
+typedef struct MockRequest {
+  char method[16];
+  char path[2048]; // including the query
+  char *headers;   // raw header lines, for grep_header()
+  char *body;      // not NUL terminated, already gunzipped
+  size_t body_len;
+} MockRequest;
+
+// one client connection, requests are answered in order over keep-alive
+typedef struct MockConnection {
+  MockSocket fd;
+  Memory in;      // bytes received and not consumed yet
+  size_t consumed; // bytes of in belonging to the last request
+  bool keep_alive;
+  bool head; // the last request was a HEAD, answers carry no body
+  bool gzip; // the last request took Accept-Encoding: gzip
+  char *inflated; // the last request's body when it came gzipped
+} MockConnection;
+
+int mock_socket_init(void);
+MockSocket mock_listen(int port);
+void mock_close_socket(MockSocket fd);
+
+void mock_connection_init(MockConnection *conn, MockSocket fd);
+void mock_connection_close(MockConnection *conn);
+
+// blocks for the next complete request, -1 once the peer is gone or sent
+// something unparsable
+int mock_read_request(MockConnection *conn, MockRequest *req);
+
+// a whole response with Content-Length, gzipped when the client asked for
+// it. extra_headers are complete "Name: value\r\n" lines or NULL
+int mock_send_response(MockConnection *conn, int status,
+                       const char *content_type, const char *extra_headers,
+                       const char *body, size_t body_len);
+
+// a response sent piece by piece with chunked transfer encoding, never
+// compressed so every event leaves the moment it is written
+int mock_send_chunked_begin(MockConnection *conn, int status,
+                            const char *content_type);
+int mock_send_chunk(MockConnection *conn, const char *data, size_t len);
+int mock_send_chunked_end(MockConnection *conn);
+
+#endif
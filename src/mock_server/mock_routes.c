@@ -0,0 +1,652 @@
+#include "mock_routes.h"
+
+#define MOCK_FILE_TTL_S (48 * 3600)
+
+typedef struct MockUpload {
+  long long size; // announced by the start request
+  long long received;
+  char mime[128];
+  int file_id; // once finalized
+} MockUpload;
+
+typedef struct MockFile {
+  char mime[128];
+  long long size;
+  long long expires_at;
+  bool deleted;
+} MockFile;
+
+typedef struct MockCache {
+  long long prompt_tokens; // estimated tokens it holds
+  bool deleted;
+} MockCache;
+
+// everything the server remembers, ids are indexes + 1
+static struct {
+  pthread_mutex_t lock;
+  const MockConfig *config;
+  unsigned long long requests;
+
+  MockUpload *uploads;
+  int upload_count;
+  MockFile *files;
+  int file_count;
+  MockCache *caches;
+  int cache_count;
+  char **batches; // finished batch resources as JSON
+  int batch_count;
+} mock = {PTHREAD_MUTEX_INITIALIZER};
+
+void mock_routes_init(const MockConfig *config) { mock.config = config; }
+
+// grows one of the state arrays by a zeroed element, lock held
+static void *push(void *array, int *count, size_t element_size) {
+  char *grown = realloc(array, (*count + 1) * element_size);
+  if (!grown)
+    return NULL;
+
+  memset(grown + *count * element_size, 0, element_size);
+  (*count)++;
+
+  return grown;
+}
+
+static void format_rfc3339(long long unix_s, char out[32]) {
+  time_t t = (time_t)unix_s;
+  struct tm *utc = gmtime(&t);
+  if (!utc || strftime(out, 32, "%Y-%m-%dT%H:%M:%SZ", utc) == 0)
+    strcpy(out, "1970-01-01T00:00:00Z");
+}
+
+static long estimate_tokens(size_t bytes) { return (long)(bytes + 3) / 4; }
+
+static int send_json(MockConnection *conn, int status, JsonWriter *w,
+                     const char *extra_headers) {
+  if (w->failed)
+    return mock_send_response(conn, 500, "application/json", NULL, "{}", 2);
+
+  return mock_send_response(conn, status, "application/json", extra_headers,
+                            w->data, w->len);
+}
+
+static int send_error(MockConnection *conn, int status, const char *message,
+                      const char *extra_headers) {
+  JsonWriter w = {0};
+  json_begin_object(&w);
+  json_key(&w, "error");
+  json_begin_object(&w);
+  json_key(&w, "code");
+  json_int(&w, status);
+  json_key(&w, "message");
+  json_string(&w, message);
+  json_end_object(&w);
+  json_end_object(&w);
+
+  int rc = send_json(conn, status, &w, extra_headers);
+  json_writer_free(&w);
+
+  return rc;
+}
+
+static void sleep_ms(long ms) {
+  if (ms > 0)
+    delay((int)ms);
+}
+
+static long generate_latency(void) {
+  const MockConfig *config = mock.config;
+  long jitter = config->jitter_ms > 0 ? rand() % (config->jitter_ms + 1) : 0;
+
+  return config->latency_ms + jitter;
+}
+
+// the number after the last '/' of a path or resource name, any query
+// string ignored. 0 if there is none
+static int path_id(const char *what) {
+  size_t len = strcspn(what, "?");
+  const char *slash = NULL;
+  for (size_t i = 0; i < len; i++) {
+    if (what[i] == '/')
+      slash = what + i;
+  }
+
+  return slash ? atoi(slash + 1) : 0;
+}
+
+// the session of an ".../files?upload_id=<n>" upload url, 0 without one
+static int upload_session_id(const char *path) {
+  const char *id = strstr(path, "upload_id=");
+
+  return id ? atoi(id + strlen("upload_id=")) : 0;
+}
+
+// "http://<Host>", for urls handed back to the client
+static void base_url(MockRequest *req, char out[256]) {
+  char *host = grep_header(req->headers, "Host");
+  snprintf(out, 256, "http://%s", host ? host : "127.0.0.1");
+  free(host);
+}
+
+static void write_file(JsonWriter *w, MockRequest *req, int id,
+                       const MockFile *file) {
+  char base[256], name[64], uri[384], size[32], expires[32];
+  base_url(req, base);
+  snprintf(name, sizeof(name), "files/%d", id);
+  snprintf(uri, sizeof(uri), "%s/v1beta/%s", base, name);
+  snprintf(size, sizeof(size), "%lld", file->size);
+  format_rfc3339(file->expires_at, expires);
+
+  json_begin_object(w);
+  json_key(w, "name");
+  json_string(w, name);
+  json_key(w, "mimeType");
+  json_string(w, file->mime);
+  json_key(w, "sizeBytes");
+  json_string(w, size);
+  json_key(w, "expirationTime");
+  json_string(w, expires);
+  json_key(w, "uri");
+  json_string(w, uri);
+  json_key(w, "state");
+  json_string(w, "ACTIVE");
+  json_end_object(w);
+}
+
+static int upload_start(MockConnection *conn, MockRequest *req) {
+  char *length =
+      grep_header(req->headers, "X-Goog-Upload-Header-Content-Length");
+  char *type = grep_header(req->headers, "X-Goog-Upload-Header-Content-Type");
+
+  pthread_mutex_lock(&mock.lock);
+  MockUpload *uploads =
+      push(mock.uploads, &mock.upload_count, sizeof(MockUpload));
+  int id = 0;
+  if (uploads) {
+    mock.uploads = uploads;
+    id = mock.upload_count;
+    MockUpload *upload = &uploads[id - 1];
+    upload->size = length ? strtoll(length, NULL, 10) : -1;
+    snprintf(upload->mime, sizeof(upload->mime), "%s",
+             type ? type : "application/octet-stream");
+  }
+  pthread_mutex_unlock(&mock.lock);
+
+  free(length);
+  free(type);
+
+  if (!id)
+    return send_error(conn, 500, "out of memory", NULL);
+
+  char base[256], headers[512];
+  base_url(req, base);
+  snprintf(headers, sizeof(headers),
+           "X-Goog-Upload-URL: %s/upload/v1beta/files?upload_id=%d\r\n"
+           "X-Goog-Upload-Status: active\r\n",
+           base, id);
+
+  return mock_send_response(conn, 200, "application/json", headers, "", 0);
+}
+
+// upload, "upload, finalize" and query commands of one session
+static int upload_command(MockConnection *conn, MockRequest *req,
+                          const char *command) {
+  int id = upload_session_id(req->path);
+  char *offset_header = grep_header(req->headers, "X-Goog-Upload-Offset");
+  long long offset = offset_header ? strtoll(offset_header, NULL, 10) : -1;
+  free(offset_header);
+
+  bool query = strcmp(command, "query") == 0;
+  bool finalize = strstr(command, "finalize") != NULL;
+  if (!query)
+    sleep_ms(mock.config->upload_latency_ms);
+
+  pthread_mutex_lock(&mock.lock);
+
+  if (id < 1 || id > mock.upload_count) {
+    pthread_mutex_unlock(&mock.lock);
+    return send_error(conn, 404, "no such upload session", NULL);
+  }
+
+  MockUpload *upload = &mock.uploads[id - 1];
+  char headers[256];
+
+  if (query) {
+    snprintf(headers, sizeof(headers),
+             "X-Goog-Upload-Status: %s\r\n"
+             "X-Goog-Upload-Size-Received: %lld\r\n",
+             upload->file_id ? "final" : "active", upload->received);
+    pthread_mutex_unlock(&mock.lock);
+    return mock_send_response(conn, 200, "application/json", headers, "", 0);
+  }
+
+  if (upload->file_id || offset != upload->received) {
+    pthread_mutex_unlock(&mock.lock);
+    return send_error(conn, 400, "upload offset does not match", NULL);
+  }
+
+  upload->received += req->body_len;
+
+  if (!finalize) {
+    pthread_mutex_unlock(&mock.lock);
+    return mock_send_response(conn, 200, "application/json",
+                              "X-Goog-Upload-Status: active\r\n", "", 0);
+  }
+
+  MockFile *files = push(mock.files, &mock.file_count, sizeof(MockFile));
+  if (!files) {
+    pthread_mutex_unlock(&mock.lock);
+    return send_error(conn, 500, "out of memory", NULL);
+  }
+  mock.files = files;
+  upload->file_id = mock.file_count;
+
+  MockFile *file = &files[upload->file_id - 1];
+  memcpy(file->mime, upload->mime, sizeof(file->mime));
+  file->size = upload->received;
+  file->expires_at = (long long)time(NULL) + MOCK_FILE_TTL_S;
+
+  JsonWriter w = {0};
+  json_begin_object(&w);
+  json_key(&w, "file");
+  write_file(&w, req, upload->file_id, file);
+  json_end_object(&w);
+  pthread_mutex_unlock(&mock.lock);
+
+  int rc = send_json(conn, 200, &w, "X-Goog-Upload-Status: final\r\n");
+  json_writer_free(&w);
+
+  return rc;
+}
+
+static int file_resource(MockConnection *conn, MockRequest *req) {
+  int id = path_id(req->path);
+  bool remove = strcmp(req->method, "DELETE") == 0;
+
+  pthread_mutex_lock(&mock.lock);
+  MockFile *file =
+      id >= 1 && id <= mock.file_count ? &mock.files[id - 1] : NULL;
+  if (!file || file->deleted) {
+    pthread_mutex_unlock(&mock.lock);
+    return send_error(conn, 404, "file not found", NULL);
+  }
+
+  JsonWriter w = {0};
+  if (remove) {
+    file->deleted = true;
+    json_begin_object(&w);
+    json_end_object(&w);
+  } else {
+    write_file(&w, req, id, file);
+  }
+  pthread_mutex_unlock(&mock.lock);
+
+  int rc = send_json(conn, 200, &w, NULL);
+  json_writer_free(&w);
+
+  return rc;
+}
+
+// tokens the named cache holds, -1 when the request names a missing one
+static long long cached_tokens(const char *body, size_t body_len) {
+  JsonSlice cached;
+  if (json_find(body, body_len, "cachedContent", &cached) != 0)
+    return 0;
+
+  char *name = json_slice_string(&cached);
+  int id = name ? path_id(name) : 0;
+  free(name);
+
+  long long tokens = -1;
+  pthread_mutex_lock(&mock.lock);
+  if (id >= 1 && id <= mock.cache_count && !mock.caches[id - 1].deleted)
+    tokens = mock.caches[id - 1].prompt_tokens;
+  pthread_mutex_unlock(&mock.lock);
+
+  return tokens;
+}
+
+static void write_usage(JsonWriter *w, long prompt_tokens, long long cached,
+                        long answer_tokens) {
+  json_key(w, "usageMetadata");
+  json_begin_object(w);
+  json_key(w, "promptTokenCount");
+  json_int(w, prompt_tokens + cached);
+  if (cached > 0) {
+    json_key(w, "cachedContentTokenCount");
+    json_int(w, cached);
+  }
+  json_key(w, "candidatesTokenCount");
+  json_int(w, answer_tokens);
+  json_key(w, "totalTokenCount");
+  json_int(w, prompt_tokens + cached + answer_tokens);
+  json_end_object(w);
+}
+
+// {"candidates": [...]} around len bytes of text, usage on the last piece
+static void write_candidates(JsonWriter *w, const char *text, size_t len,
+                             bool last, long prompt_tokens,
+                             long long cached) {
+  json_begin_object(w);
+  json_key(w, "candidates");
+  json_begin_array(w);
+  json_begin_object(w);
+  json_key(w, "content");
+  json_begin_object(w);
+  json_key(w, "parts");
+  json_begin_array(w);
+  json_begin_object(w);
+  json_key(w, "text");
+  json_string_begin(w);
+  json_string_append(w, text, len);
+  json_string_end(w);
+  json_end_object(w);
+  json_end_array(w);
+  json_key(w, "role");
+  json_string(w, "model");
+  json_end_object(w);
+  if (last) {
+    json_key(w, "finishReason");
+    json_string(w, "STOP");
+  }
+  json_end_object(w);
+  json_end_array(w);
+  if (last)
+    write_usage(w, prompt_tokens, cached,
+                estimate_tokens(mock.config->answer_len));
+  json_end_object(w);
+}
+
+static int generate(MockConnection *conn, MockRequest *req) {
+  long long cached = cached_tokens(req->body, req->body_len);
+  if (cached < 0)
+    return send_error(conn, 403, "CachedContent not found", NULL);
+
+  sleep_ms(generate_latency());
+
+  JsonWriter w = {0};
+  write_candidates(&w, mock.config->answer, mock.config->answer_len, true,
+                   estimate_tokens(req->body_len), cached);
+
+  int rc = send_json(conn, 200, &w, NULL);
+  json_writer_free(&w);
+
+  return rc;
+}
+
+static int stream_generate(MockConnection *conn, MockRequest *req) {
+  long long cached = cached_tokens(req->body, req->body_len);
+  if (cached < 0)
+    return send_error(conn, 403, "CachedContent not found", NULL);
+
+  sleep_ms(generate_latency());
+
+  if (mock_send_chunked_begin(conn, 200, "text/event-stream") != 0)
+    return -1;
+
+  const char *answer = mock.config->answer;
+  size_t len = mock.config->answer_len;
+  int chunks = mock.config->stream_chunks > 0 ? mock.config->stream_chunks : 1;
+  size_t start = 0;
+  JsonWriter w = {0};
+  int rc = 0;
+
+  for (int i = 0; i < chunks && rc == 0; i++) {
+    size_t end = i == chunks - 1 ? len : len * (i + 1) / chunks;
+    // never split a UTF-8 sequence between two events
+    while (end < len && ((unsigned char)answer[end] & 0xC0) == 0x80)
+      end++;
+    if (end < start)
+      end = start;
+
+    if (i > 0)
+      sleep_ms(mock.config->chunk_delay_ms);
+
+    json_writer_reset(&w);
+    write_candidates(&w, answer + start, end - start, i == chunks - 1,
+                     estimate_tokens(req->body_len), cached);
+
+    rc = w.failed || mock_send_chunk(conn, "data: ", 6) != 0 ||
+                 mock_send_chunk(conn, w.data, w.len) != 0 ||
+                 mock_send_chunk(conn, "\r\n\r\n", 4) != 0
+             ? -1
+             : 0;
+    start = end;
+  }
+
+  json_writer_free(&w);
+
+  if (rc != 0)
+    return -1;
+
+  return mock_send_chunked_end(conn);
+}
+
+static int cache_create(MockConnection *conn, MockRequest *req) {
+  pthread_mutex_lock(&mock.lock);
+  MockCache *caches = push(mock.caches, &mock.cache_count, sizeof(MockCache));
+  int id = 0;
+  if (caches) {
+    mock.caches = caches;
+    id = mock.cache_count;
+    caches[id - 1].prompt_tokens = estimate_tokens(req->body_len);
+  }
+  pthread_mutex_unlock(&mock.lock);
+
+  if (!id)
+    return send_error(conn, 500, "out of memory", NULL);
+
+  char name[64];
+  snprintf(name, sizeof(name), "cachedContents/%d", id);
+
+  JsonWriter w = {0};
+  json_begin_object(&w);
+  json_key(&w, "name");
+  json_string(&w, name);
+  json_end_object(&w);
+
+  int rc = send_json(conn, 200, &w, NULL);
+  json_writer_free(&w);
+
+  return rc;
+}
+
+// GET, PATCH (ttl) and DELETE of one cache
+static int cache_resource(MockConnection *conn, MockRequest *req) {
+  int id = path_id(req->path);
+
+  pthread_mutex_lock(&mock.lock);
+  MockCache *cache =
+      id >= 1 && id <= mock.cache_count ? &mock.caches[id - 1] : NULL;
+  bool found = cache && !cache->deleted;
+  if (found && strcmp(req->method, "DELETE") == 0)
+    cache->deleted = true;
+  pthread_mutex_unlock(&mock.lock);
+
+  if (!found)
+    return send_error(conn, 404, "CachedContent not found", NULL);
+
+  return mock_send_response(conn, 200, "application/json", NULL, "{}", 2);
+}
+
+// every inlined request is answered right away, the first poll sees the
+// batch finished with one response per request, keys echoed back
+static int batch_create(MockConnection *conn, MockRequest *req) {
+  JsonSlice requests, element, key;
+  const char *path = "batch.input_config.requests.requests";
+  if (json_find(req->body, req->body_len, path, &requests) != 0)
+    return send_error(conn, 400, "batch has no inlined requests", NULL);
+
+  pthread_mutex_lock(&mock.lock);
+  char **batches = push(mock.batches, &mock.batch_count, sizeof(char *));
+  int id = 0;
+  if (batches) {
+    mock.batches = batches;
+    id = mock.batch_count;
+  }
+  pthread_mutex_unlock(&mock.lock);
+
+  if (!id)
+    return send_error(conn, 500, "out of memory", NULL);
+
+  char name[64];
+  snprintf(name, sizeof(name), "batches/%d", id);
+
+  JsonWriter w = {0};
+  json_begin_object(&w);
+  json_key(&w, "name");
+  json_string(&w, name);
+  json_key(&w, "metadata");
+  json_begin_object(&w);
+  json_key(&w, "state");
+  json_string(&w, "BATCH_STATE_SUCCEEDED");
+  json_end_object(&w);
+  json_key(&w, "done");
+  json_bool(&w, true);
+  json_key(&w, "response");
+  json_begin_object(&w);
+  json_key(&w, "inlinedResponses");
+  json_begin_object(&w);
+  json_key(&w, "inlinedResponses");
+  json_begin_array(&w);
+
+  const char *cursor = NULL;
+  while (json_array_next(&requests, &cursor, &element) == 0) {
+    json_begin_object(&w);
+    json_key(&w, "response");
+    write_candidates(&w, mock.config->answer, mock.config->answer_len, true,
+                     estimate_tokens(element.len), 0);
+    if (json_slice_find(&element, "metadata.key", &key) == 0) {
+      json_key(&w, "metadata");
+      json_begin_object(&w);
+      json_key(&w, "key");
+      json_raw_value(&w, key.start, key.len);
+      json_end_object(&w);
+    }
+    json_end_object(&w);
+  }
+
+  json_end_array(&w);
+  json_end_object(&w);
+  json_end_object(&w);
+  json_end_object(&w);
+
+  char *done = w.failed ? NULL : strdup(w.data);
+  json_writer_free(&w);
+
+  pthread_mutex_lock(&mock.lock);
+  mock.batches[id - 1] = done;
+  pthread_mutex_unlock(&mock.lock);
+
+  json_begin_object(&w);
+  json_key(&w, "name");
+  json_string(&w, name);
+  json_key(&w, "metadata");
+  json_begin_object(&w);
+  json_key(&w, "state");
+  json_string(&w, "BATCH_STATE_PENDING");
+  json_end_object(&w);
+  json_end_object(&w);
+
+  int rc = send_json(conn, 200, &w, NULL);
+  json_writer_free(&w);
+
+  return rc;
+}
+
+static int batch_resource(MockConnection *conn, MockRequest *req) {
+  if (strstr(req->path, ":cancel"))
+    return mock_send_response(conn, 200, "application/json", NULL, "{}", 2);
+
+  int id = path_id(req->path);
+
+  // finished batches are never freed, the string outlives the lock
+  pthread_mutex_lock(&mock.lock);
+  char *done = id >= 1 && id <= mock.batch_count ? mock.batches[id - 1] : NULL;
+  pthread_mutex_unlock(&mock.lock);
+
+  if (!done)
+    return send_error(conn, 404, "batch not found", NULL);
+
+  return mock_send_response(conn, 200, "application/json", NULL, done,
+                            strlen(done));
+}
+
+// counts the request and decides whether it gets the injected failure
+static bool should_fail(void) {
+  const MockConfig *config = mock.config;
+
+  pthread_mutex_lock(&mock.lock);
+  unsigned long long n = ++mock.requests;
+  bool fail = (config->fail_every > 0 && n % config->fail_every == 0) ||
+              (config->fail_rate > 0 && rand() < config->fail_rate * RAND_MAX);
+  pthread_mutex_unlock(&mock.lock);
+
+  return fail;
+}
+
+static int inject_failure(MockConnection *conn) {
+  const MockConfig *config = mock.config;
+  if (config->fail_status == 0)
+    return -1;
+
+  char headers[64] = "";
+  if (config->retry_after_s > 0)
+    snprintf(headers, sizeof(headers), "Retry-After: %ld\r\n",
+             config->retry_after_s);
+
+  return send_error(conn, config->fail_status, "injected failure", headers);
+}
+
+static int route(MockConnection *conn, MockRequest *req) {
+  const char *path = req->path;
+  bool post = strcmp(req->method, "POST") == 0;
+
+  if (should_fail())
+    return inject_failure(conn);
+
+  if (post && strncmp(path, "/upload/", 8) == 0) {
+    char *command = grep_header(req->headers, "X-Goog-Upload-Command");
+    int rc;
+    if (!command)
+      rc = send_error(conn, 400, "missing X-Goog-Upload-Command", NULL);
+    else if (strstr(path, "upload_id="))
+      rc = upload_command(conn, req, command);
+    else if (strcmp(command, "start") == 0)
+      rc = upload_start(conn, req);
+    else
+      rc = send_error(conn, 400, "unknown upload command", NULL);
+    free(command);
+    return rc;
+  }
+
+  if (post && strstr(path, ":streamGenerateContent"))
+    return stream_generate(conn, req);
+  if (post && strstr(path, ":batchGenerateContent"))
+    return batch_create(conn, req);
+  if (post && strstr(path, ":generateContent"))
+    return generate(conn, req);
+
+  if (strstr(path, "/files/"))
+    return file_resource(conn, req);
+  if (strstr(path, "/batches/"))
+    return batch_resource(conn, req);
+  if (strstr(path, "/cachedContents/"))
+    return cache_resource(conn, req);
+  if (post && strstr(path, "/cachedContents"))
+    return cache_create(conn, req);
+
+  return send_error(conn, 404, "no such route in the mock", NULL);
+}
+
+int mock_handle(MockConnection *conn, MockRequest *req) {
+  double start = get_time_ms();
+  int rc = route(conn, req);
+
+  if (!mock.config->quiet) {
+    printf("[mock] %s %s%s %.1f ms\n", req->method, req->path,
+           rc != 0 ? " (dropped)" : "", get_time_ms() - start);
+    fflush(stdout);
+  }
+
+  return rc;
+}
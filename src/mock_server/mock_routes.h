@@ -0,0 +1,45 @@
+#ifndef MOCKROUTES_H
+#define MOCKROUTES_H
+
+#include "../utils/delay.h"
+#include "../utils/get_time_ms.h"
+#include "../utils/grep_string.h"
+#include "../utils/json_extract.h"
+#include "../utils/json_writer.h"
+#include "mock_http.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// how the mock behaves, filled from the command line by mock_server.c
+typedef struct MockConfig {
+  int port;
+
+  long latency_ms;        // before a generate answer or the first SSE event
+  long jitter_ms;         // random extra latency, 0 to latency + jitter
+  long upload_latency_ms; // before each upload chunk is acknowledged
+  int stream_chunks;      // SSE events an answer is split into
+  long chunk_delay_ms;    // between two SSE events
+
+  // error injection, applied before routing
+  int fail_every;   // every n-th request fails, 0 never
+  double fail_rate; // or this fraction of them at random
+  int fail_status;  // 0 drops the connection without an answer
+  long retry_after_s; // sent with injected failures when > 0
+
+  const char *answer; // canned answer text
+  size_t answer_len;
+
+  bool quiet; // no line per request
+} MockConfig;
+
+void mock_routes_init(const MockConfig *config);
+
+// answers one request, -1 when the connection has to be dropped
+int mock_handle(MockConnection *conn, MockRequest *req);
+
+#endif
@@ -0,0 +1,193 @@
+// local stand-in for the parts of the Gemini API this client uses, so
+// gemini_api/ can be benchmarked offline with deterministic latency:
+// resumable uploads, file metadata, generateContent, the SSE stream,
+// cachedContents and inlined batches
+//
+// build: make mock
+// run:   ./mock_gemini --latency 300 --chunks 8 --chunk-delay 40
+// then point env.json at it:
+//   GEMINI_API_URL  http://127.0.0.1:8765/v1beta/models/mock:generateContent
+//   GEMINI_FILE_URL http://127.0.0.1:8765/upload/v1beta/files
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../utils/read_file.h"
+#include "mock_http.h"
+#include "mock_routes.h"
+
+#define MOCK_DEFAULT_PORT 8765
+#define MOCK_DEFAULT_ANSWER_BYTES 400
+
+static const char *filler =
+    "This is the local mock server answering instead of Gemini. ";
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --port N            listen on 127.0.0.1:N (%d)\n"
+          "  --latency MS        before an answer or its first event (0)\n"
+          "  --jitter MS         random extra latency up to MS (0)\n"
+          "  --upload-latency MS before each upload chunk is acknowledged\n"
+          "  --chunks N          SSE events per streamed answer (4)\n"
+          "  --chunk-delay MS    between two SSE events (0)\n"
+          "  --fail-every N      every n-th request fails (0, never)\n"
+          "  --fail-rate P       or a random fraction P of them (0)\n"
+          "  --fail-status S     status of failures, 0 drops the "
+          "connection (503)\n"
+          "  --retry-after S     Retry-After sent with failures\n"
+          "  --answer-file PATH  canned answer text\n"
+          "  --answer-bytes N    size of the generated answer (%d)\n"
+          "  --seed N            seed for jitter and --fail-rate\n"
+          "  --quiet             no line per request\n",
+          program, MOCK_DEFAULT_PORT, MOCK_DEFAULT_ANSWER_BYTES);
+}
+
+static char *filler_answer(size_t len) {
+  char *answer = malloc(len + 1);
+  if (!answer)
+    return NULL;
+
+  size_t filler_len = strlen(filler);
+  for (size_t i = 0; i < len; i++) {
+    answer[i] = filler[i % filler_len];
+  }
+  answer[len] = '\0';
+
+  return answer;
+}
+
+static void *connection_main(void *arg) {
+  MockConnection *conn = (MockConnection *)arg;
+  MockRequest req;
+
+  while (mock_read_request(conn, &req) == 0) {
+    if (mock_handle(conn, &req) != 0 || !conn->keep_alive)
+      break;
+  }
+
+  mock_connection_close(conn);
+  free(conn);
+
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  MockConfig config = {0};
+  config.port = MOCK_DEFAULT_PORT;
+  config.stream_chunks = 4;
+  config.fail_status = 503;
+
+  const char *answer_file = NULL;
+  long answer_bytes = MOCK_DEFAULT_ANSWER_BYTES;
+  unsigned seed = (unsigned)time(NULL);
+
+  for (int i = 1; i < argc; i++) {
+    const char *option = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+    if (strcmp(option, "--quiet") == 0) {
+      config.quiet = true;
+      continue;
+    }
+    if (!value || strncmp(option, "--", 2) != 0) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    i++;
+
+    if (strcmp(option, "--port") == 0)
+      config.port = atoi(value);
+    else if (strcmp(option, "--latency") == 0)
+      config.latency_ms = atol(value);
+    else if (strcmp(option, "--jitter") == 0)
+      config.jitter_ms = atol(value);
+    else if (strcmp(option, "--upload-latency") == 0)
+      config.upload_latency_ms = atol(value);
+    else if (strcmp(option, "--chunks") == 0)
+      config.stream_chunks = atoi(value);
+    else if (strcmp(option, "--chunk-delay") == 0)
+      config.chunk_delay_ms = atol(value);
+    else if (strcmp(option, "--fail-every") == 0)
+      config.fail_every = atoi(value);
+    else if (strcmp(option, "--fail-rate") == 0)
+      config.fail_rate = atof(value);
+    else if (strcmp(option, "--fail-status") == 0)
+      config.fail_status = atoi(value);
+    else if (strcmp(option, "--retry-after") == 0)
+      config.retry_after_s = atol(value);
+    else if (strcmp(option, "--answer-file") == 0)
+      answer_file = value;
+    else if (strcmp(option, "--answer-bytes") == 0)
+      answer_bytes = atol(value);
+    else if (strcmp(option, "--seed") == 0)
+      seed = (unsigned)strtoul(value, NULL, 10);
+    else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  char *answer = answer_file ? read_file(answer_file)
+                             : filler_answer(answer_bytes > 0 ? answer_bytes
+                                                              : 0);
+  if (!answer) {
+    fprintf(stderr, "[ERROR] Could not load the answer%s%s\n",
+            answer_file ? " from " : "", answer_file ? answer_file : "");
+    return EXIT_FAILURE;
+  }
+  config.answer = answer;
+  config.answer_len = strlen(answer);
+
+  srand(seed);
+  mock_routes_init(&config);
+
+#ifndef _WIN32
+  // a client hanging up mid-stream must not kill the server
+  signal(SIGPIPE, SIG_IGN);
+#endif
+
+  if (mock_socket_init() != 0) {
+    fprintf(stderr, "[ERROR] Could not start sockets.\n");
+    return EXIT_FAILURE;
+  }
+
+  MockSocket listener = mock_listen(config.port);
+  if (listener == MOCK_INVALID_SOCKET) {
+    fprintf(stderr, "[ERROR] Could not listen on 127.0.0.1:%d\n",
+            config.port);
+    return EXIT_FAILURE;
+  }
+
+  printf("[INFO] Mock Gemini API on http://127.0.0.1:%d/v1beta/\n",
+         config.port);
+  fflush(stdout);
+
+  // a thread per connection, the client keeps only a handful open
+  while (1) {
+    MockSocket fd = accept(listener, NULL, NULL);
+    if (fd == MOCK_INVALID_SOCKET)
+      continue;
+
+    MockConnection *conn = malloc(sizeof(MockConnection));
+    if (!conn) {
+      mock_close_socket(fd);
+      continue;
+    }
+    mock_connection_init(conn, fd);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, connection_main, conn) != 0) {
+      mock_connection_close(conn);
+      free(conn);
+      continue;
+    }
+    pthread_detach(thread);
+  }
+
+  return EXIT_SUCCESS;
+}
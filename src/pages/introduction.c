@@ -16,6 +16,8 @@
 #include <sys/stat.h>
 #endif
 
+char logged_in_user[256] = {0};
+
 #define RGB_TO_NCURSES(r, g, b)                                                \
   ((r) * 1000 / 255), ((g) * 1000 / 255), ((b) * 1000 / 255)
 
@@ -1592,6 +1594,8 @@ void login_page(void) {
           break;
         } else {
           // User found - navigate to appropriate page
+          snprintf(logged_in_user, sizeof(logged_in_user), "%s",
+                   username_buf);
           clear();
           refresh();
           endwin();
@@ -14,6 +14,9 @@
 
 #include "../utils/delay.h"
 
+// username of the last successful login, empty while nobody logged in
+extern char logged_in_user[256];
+
 void introduction_page(void);
 void signup_page(void);
 void login_page(void);
@@ -0,0 +1,138 @@
+#include "network_stats.h"
+
+// header, phases and a blank line per endpoint, then the rate limits and
+// the models
+#define NETWORK_STATS_MAX_LINES                                                \
+  (NET_TELEMETRY_MAX_ENDPOINTS * 8 + 2 + REQUEST_SCHEDULER_MAX_ENDPOINTS + 4 + \
+   MODEL_ROUTER_MAX_MODELS + 4)
+
+static int build_lines(NetTelemetry *telemetry, ReportLine *lines) {
+  NetEndpoint *endpoints =
+      malloc(NET_TELEMETRY_MAX_ENDPOINTS * sizeof(NetEndpoint));
+  if (!endpoints)
+    return 0;
+
+  int count =
+      net_telemetry_snapshot(telemetry, endpoints, NET_TELEMETRY_MAX_ENDPOINTS);
+  int n = 0;
+
+  snprintf(lines[n].text, sizeof(lines[n].text), "  %-14s %10s %10s %10s",
+           "phase (ms)", "p50", "p95", "p99");
+  lines[n++].heading = true;
+
+  if (count == 0) {
+    snprintf(lines[n].text, sizeof(lines[n].text),
+             "  No requests measured yet.");
+    n++;
+  }
+
+  for (int i = 0; i < count; i++) {
+    NetEndpoint *endpoint = &endpoints[i];
+
+    lines[n].text[0] = '\0';
+    lines[n++].heading = false;
+
+    snprintf(lines[n].text, sizeof(lines[n].text),
+             "  %s: %llu request(s), %llu failed, %.1f KiB up, %.1f KiB down",
+             endpoint->name, endpoint->requests, endpoint->failures,
+             endpoint->bytes_up / 1024.0, endpoint->bytes_down / 1024.0);
+    lines[n++].heading = true;
+
+    for (int phase = 0; phase < NET_PHASE_COUNT; phase++) {
+      Histogram *h = &endpoint->phases[phase];
+      if (h->total == 0)
+        continue;
+
+      snprintf(lines[n].text, sizeof(lines[n].text),
+               "    %-12s %10.1f %10.1f %10.1f", net_phase_name(phase),
+               histogram_percentile(h, 0.50) / 1000.0,
+               histogram_percentile(h, 0.95) / 1000.0,
+               histogram_percentile(h, 0.99) / 1000.0);
+      lines[n++].heading = false;
+    }
+  }
+
+  free(endpoints);
+
+  return n;
+}
+
+static int build_rate_lines(RequestScheduler *scheduler, ReportLine *lines) {
+  RateBucket buckets[REQUEST_SCHEDULER_MAX_ENDPOINTS];
+  int count = request_scheduler_snapshot(scheduler, buckets,
+                                         REQUEST_SCHEDULER_MAX_ENDPOINTS);
+  int n = 0;
+
+  lines[n].text[0] = '\0';
+  lines[n++].heading = false;
+
+  pthread_mutex_lock(&scheduler->lock);
+  snprintf(lines[n].text, sizeof(lines[n].text),
+           "  rate limits: background %d/%d at once, deferred %llu time(s)%s",
+           scheduler->background_limit, scheduler->background_max,
+           scheduler->background_deferred,
+           scheduler->over_target ? ", prompts over target" : "");
+  pthread_mutex_unlock(&scheduler->lock);
+  lines[n++].heading = true;
+
+  snprintf(lines[n].text, sizeof(lines[n].text), "    %-12s %10s %10s %10s",
+           "endpoint", "req/s", "429s", "granted");
+  lines[n++].heading = false;
+
+  for (int i = 0; i < count; i++) {
+    snprintf(lines[n].text, sizeof(lines[n].text),
+             "    %-12s %4.2f/%-5.2f %10llu %10llu", buckets[i].endpoint,
+             buckets[i].rate, buckets[i].max_rate, buckets[i].throttled,
+             buckets[i].granted);
+    lines[n++].heading = false;
+  }
+
+  return n;
+}
+
+static int build_model_lines(ModelRouter *router, ReportLine *lines) {
+  ModelRoute routes[MODEL_ROUTER_MAX_MODELS];
+  int count = model_router_snapshot(router, routes, MODEL_ROUTER_MAX_MODELS);
+  int n = 0;
+  double now = get_time_ms();
+
+  lines[n].text[0] = '\0';
+  lines[n++].heading = false;
+
+  snprintf(lines[n].text, sizeof(lines[n].text), "  models");
+  lines[n++].heading = true;
+
+  snprintf(lines[n].text, sizeof(lines[n].text),
+           "    %-16s %10s %8s %10s %8s", "model", "first byte", "cost",
+           "requests", "failed");
+  lines[n++].heading = false;
+
+  for (int i = 0; i < count; i++) {
+    ModelRoute *route = &routes[i];
+    double latency = route->ewma_ms > 0 ? route->ewma_ms : route->latency_ms;
+
+    snprintf(lines[n].text, sizeof(lines[n].text),
+             "    %-16.16s %8.0f%s %8.2f %10llu %8llu%s", route->name, latency,
+             route->ewma_ms > 0 ? "ms" : " ?", route->cost, route->requests,
+             route->failures, route->down_until > now ? "  down" : "");
+    lines[n++].heading = false;
+  }
+
+  return n;
+}
+
+void network_stats_page(NetTelemetry *telemetry, RequestScheduler *scheduler,
+                        ModelRouter *router) {
+  ReportLine *lines = calloc(NETWORK_STATS_MAX_LINES, sizeof(ReportLine));
+  if (!lines)
+    return;
+
+  int line_count = build_lines(telemetry, lines);
+  if (scheduler)
+    line_count += build_rate_lines(scheduler, lines + line_count);
+  if (router)
+    line_count += build_model_lines(router, lines + line_count);
+  report_page(" Network Stats ", lines, line_count);
+
+  free(lines);
+}
@@ -0,0 +1,15 @@
+#ifndef NETWORKSTATS_H
+#define NETWORKSTATS_H
+
+#include "../gemini_api/model_router.h"
+#include "../gemini_api/request_scheduler.h"
+#include "../stats/net_telemetry.h"
+#include "report_page.h"
+
+// p50/p95/p99 of every request phase per endpoint, across runs, then this
+// run's rate limits and models (scheduler and router may be NULL). arrows
+// scroll, ESC goes back to the prompt
+void network_stats_page(NetTelemetry *telemetry, RequestScheduler *scheduler,
+                        ModelRouter *router);
+
+#endif
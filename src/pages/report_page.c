@@ -0,0 +1,96 @@
+#include "report_page.h"
+
+#define RGB_TO_NCURSES(r, g, b)                                                \
+  ((r) * 1000 / 255), ((g) * 1000 / 255), ((b) * 1000 / 255)
+
+static void draw(const char *title, const ReportLine *lines, int line_count,
+                 int offset) {
+  int h = getmaxy(stdscr);
+  int w = getmaxx(stdscr);
+
+  clear();
+
+  // the last row is the status bar
+  for (int row = 0; row < h - 1 && offset + row < line_count; row++) {
+    const ReportLine *line = &lines[offset + row];
+    if (line->heading)
+      wattron(stdscr, COLOR_PAIR(4) | A_BOLD);
+    mvaddnstr(row, 0, line->text, w);
+    if (line->heading)
+      wattroff(stdscr, COLOR_PAIR(4) | A_BOLD);
+  }
+
+  wattron(stdscr, COLOR_PAIR(9));
+  mvhline(h - 1, 0, ' ', w);
+  wattroff(stdscr, COLOR_PAIR(9));
+
+  wattron(stdscr, COLOR_PAIR(8));
+  mvaddnstr(h - 1, 0, title, w - 2);
+  wattroff(stdscr, COLOR_PAIR(8));
+
+  const char *right = " [UP/DOWN] Scroll  [ESC] Back ";
+  wattron(stdscr, COLOR_PAIR(7));
+  mvaddstr(h - 1, w - (int)strlen(right), right);
+  wattroff(stdscr, COLOR_PAIR(7));
+
+  refresh();
+}
+
+void report_page(const char *title, const ReportLine *lines, int line_count) {
+  initscr();
+  cbreak();
+  noecho();
+  keypad(stdscr, TRUE);
+  curs_set(0);
+
+  start_color();
+  // Use same color scheme as introduction page
+  if (can_change_color() && COLORS > 16) {
+    short DARK_GRAY = 16;
+    short ORANGE = 19;
+    short BLACK = 20;
+    short BLUE = 21;
+    short GRAY_3 = 22;
+    short GRAY_4 = 23;
+
+    init_color(DARK_GRAY, RGB_TO_NCURSES(30, 30, 30));
+    init_color(ORANGE, RGB_TO_NCURSES(243, 173, 128));
+    init_color(BLACK, RGB_TO_NCURSES(10, 10, 10));
+    init_color(BLUE, RGB_TO_NCURSES(92, 156, 245));
+    init_color(GRAY_3, RGB_TO_NCURSES(53, 53, 53));
+    init_color(GRAY_4, RGB_TO_NCURSES(16, 16, 16));
+
+    init_pair(4, ORANGE, BLACK);
+    init_pair(5, COLOR_WHITE, BLACK);
+    init_pair(7, BLACK, BLUE);
+    init_pair(8, COLOR_WHITE, GRAY_3);
+    init_pair(9, COLOR_WHITE, GRAY_4);
+  }
+
+  wbkgd(stdscr, COLOR_PAIR(5));
+  leaveok(stdscr, TRUE);
+
+  int offset = 0;
+  draw(title, lines, line_count, offset);
+
+  int ch;
+  while ((ch = getch()) != 27) {
+    int page = getmaxy(stdscr) - 1;
+    int last = line_count > page ? line_count - page : 0;
+
+    if (ch == KEY_UP && offset > 0)
+      offset--;
+    else if (ch == KEY_DOWN && offset < last)
+      offset++;
+    else if (ch == KEY_RESIZE)
+      resize_term(0, 0);
+
+    if (offset > last)
+      offset = last;
+    draw(title, lines, line_count, offset);
+  }
+
+  clear();
+  refresh();
+  endwin();
+}
@@ -0,0 +1,27 @@
+#ifndef REPORTPAGE_H
+#define REPORTPAGE_H
+
+#include <windows.h>
+
+// remove redefinition errors from wincon.h macro
+#undef MOUSE_MOVED
+
+#define _XOPEN_SOURCE_EXTENDED 1
+#define PDC_WIDE 1
+
+#include <curses.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ReportLine {
+  char text[128];
+  bool heading; // drawn bold in the accent color
+} ReportLine;
+
+// lines above a status bar titled title, arrows scroll and ESC goes back
+// to the prompt
+void report_page(const char *title, const ReportLine *lines, int line_count);
+
+#endif
@@ -0,0 +1,67 @@
+#include "token_report.h"
+
+// today, a blank line, the table header and its rows
+#define TOKEN_REPORT_MAX_LINES (TOKEN_REPORT_MAX_ROWS + 4)
+
+static int build_lines(TokenLedger *ledger, const char *user,
+                       ReportLine *lines) {
+  TokenUsageRow *rows = malloc(TOKEN_REPORT_MAX_ROWS * sizeof(TokenUsageRow));
+  if (!rows)
+    return 0;
+
+  int count = token_ledger_report(ledger, TOKEN_REPORT_DAYS, rows,
+                                  TOKEN_REPORT_MAX_ROWS);
+  int n = 0;
+
+  long long used = token_ledger_used_today(ledger, user);
+  long long budget = token_ledger_budget(ledger, user);
+  if (budget > 0)
+    snprintf(lines[n].text, sizeof(lines[n].text),
+             "  Today: %lld of %lld tokens used by %s", used, budget, user);
+  else
+    snprintf(lines[n].text, sizeof(lines[n].text),
+             "  Today: %lld tokens used by %s, no daily budget", used, user);
+  lines[n++].heading = true;
+  n++;
+
+  char period[32];
+  snprintf(period, sizeof(period), "last %d days", TOKEN_REPORT_DAYS);
+  snprintf(lines[n].text, sizeof(lines[n].text),
+           "  %-28s %8s %10s %10s %10s %10s %10s", period, "requests",
+           "prompt", "output", "cached", "avg prompt", "max prompt");
+  lines[n++].heading = true;
+
+  if (count == 0) {
+    snprintf(lines[n].text, sizeof(lines[n].text),
+             "  No answers accounted yet.");
+    n++;
+  }
+
+  for (int i = 0; i < count; i++) {
+    TokenUsageRow *row = &rows[i];
+    char who[64];
+    snprintf(who, sizeof(who), "%s / %s", row->user, row->feature);
+
+    snprintf(lines[n].text, sizeof(lines[n].text),
+             "  %-28.28s %8lld %10lld %10lld %10lld %10lld %10lld", who,
+             row->requests, row->prompt, row->candidates, row->cached,
+             row->requests > 0 ? row->prompt / row->requests : 0,
+             row->max_prompt);
+    n++;
+  }
+
+  free(rows);
+
+  return n;
+}
+
+void token_report_page(TokenLedger *ledger, const char *user) {
+  ReportLine *lines = calloc(TOKEN_REPORT_MAX_LINES, sizeof(ReportLine));
+  if (!lines)
+    return;
+
+  int line_count = build_lines(ledger, user, lines);
+  report_page(" Token Usage ", lines, line_count);
+
+  free(lines);
+}
@@ -0,0 +1,15 @@
+#ifndef TOKENREPORT_H
+#define TOKENREPORT_H
+
+#include "../stats/token_usage.h"
+#include "report_page.h"
+
+// days the report sums over, today included
+#define TOKEN_REPORT_DAYS 7
+#define TOKEN_REPORT_MAX_ROWS 64
+
+// user's budget for today, then tokens per user and feature over the last
+// TOKEN_REPORT_DAYS days, biggest prompts first
+void token_report_page(TokenLedger *ledger, const char *user);
+
+#endif
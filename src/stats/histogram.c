@@ -0,0 +1,76 @@
+#include "histogram.h"
+
+int histogram_bucket(uint64_t value) {
+  if (value < HISTOGRAM_SUB_BUCKETS)
+    return (int)value;
+
+  // position of the highest set bit, at least 4 here
+  int msb = 0;
+  for (uint64_t v = value; v > 1; v >>= 1) {
+    msb++;
+  }
+
+  // the top 5 bits pick the bucket: the leading 1 the power of two, the
+  // next 4 the sub-bucket within it
+  int shift = msb - 4;
+  int bucket = (shift + 1) * HISTOGRAM_SUB_BUCKETS +
+               (int)(value >> shift) - HISTOGRAM_SUB_BUCKETS;
+
+  return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+uint64_t histogram_bucket_floor(int bucket) {
+  if (bucket < HISTOGRAM_SUB_BUCKETS)
+    return (uint64_t)bucket;
+
+  int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+  uint64_t top =
+      HISTOGRAM_SUB_BUCKETS + (uint64_t)(bucket % HISTOGRAM_SUB_BUCKETS);
+
+  return top << shift;
+}
+
+void histogram_add(Histogram *h, uint64_t value) {
+  h->counts[histogram_bucket(value)]++;
+  h->total++;
+  if (value > h->max)
+    h->max = value;
+}
+
+void histogram_add_bucket(Histogram *h, int bucket, uint64_t count) {
+  if (bucket < 0 || bucket >= HISTOGRAM_BUCKETS || count == 0)
+    return;
+
+  h->counts[bucket] += (uint32_t)count;
+  h->total += count;
+
+  // the bucket's floor is the best guess left of a saved maximum
+  uint64_t floor = histogram_bucket_floor(bucket);
+  if (floor > h->max)
+    h->max = floor;
+}
+
+uint64_t histogram_percentile(const Histogram *h, double p) {
+  if (h->total == 0)
+    return 0;
+
+  uint64_t rank = (uint64_t)(p * (double)h->total);
+  if (rank >= h->total)
+    rank = h->total - 1;
+
+  uint64_t seen = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    seen += h->counts[i];
+    if (seen > rank) {
+      uint64_t floor = histogram_bucket_floor(i);
+      uint64_t next = i + 1 < HISTOGRAM_BUCKETS ? histogram_bucket_floor(i + 1)
+                                                : floor + 1;
+      uint64_t middle = floor + (next - floor) / 2;
+
+      // nothing was bigger than the largest sample
+      return middle < h->max ? middle : h->max;
+    }
+  }
+
+  return h->max;
+}
@@ -0,0 +1,32 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+// log-linear buckets: values below 16 get one bucket each, above that
+// every power of two is cut into 16 equal buckets, so any value is off by
+// at most 1/16 (6%) whatever its magnitude
+#define HISTOGRAM_SUB_BUCKETS 16
+// 32 powers of two, in microseconds that reaches past 9 hours
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS * 32)
+
+typedef struct Histogram {
+  uint32_t counts[HISTOGRAM_BUCKETS];
+  uint64_t total;
+  uint64_t max;
+} Histogram;
+
+// bucket of value, the last one for anything past the range
+int histogram_bucket(uint64_t value);
+// smallest value that falls into bucket
+uint64_t histogram_bucket_floor(int bucket);
+
+void histogram_add(Histogram *h, uint64_t value);
+// adds count samples to one bucket, for loading saved histograms
+void histogram_add_bucket(Histogram *h, int bucket, uint64_t count);
+
+// the value below which a fraction p (0-1) of the samples fall, taken as
+// the middle of its bucket. 0 for an empty histogram
+uint64_t histogram_percentile(const Histogram *h, double p);
+
+#endif
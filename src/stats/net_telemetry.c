@@ -0,0 +1,278 @@
+#include "net_telemetry.h"
+
+static const char *phase_names[NET_PHASE_COUNT] = {
+    "dns", "connect", "tls", "pretransfer", "first_byte", "total"};
+
+static const CURLINFO phase_infos[NET_PHASE_COUNT] = {
+    CURLINFO_NAMELOOKUP_TIME_T,    CURLINFO_CONNECT_TIME_T,
+    CURLINFO_APPCONNECT_TIME_T,    CURLINFO_PRETRANSFER_TIME_T,
+    CURLINFO_STARTTRANSFER_TIME_T, CURLINFO_TOTAL_TIME_T};
+
+const char *net_phase_name(NetPhase phase) {
+  return phase >= 0 && phase < NET_PHASE_COUNT ? phase_names[phase] : "?";
+}
+
+static int phase_from_name(const char *name) {
+  for (int i = 0; i < NET_PHASE_COUNT; i++) {
+    if (strcmp(phase_names[i], name) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
+// the endpoint's slot, a new one while there is room. called locked
+static NetEndpoint *find_endpoint(NetTelemetry *telemetry, const char *name) {
+  for (int i = 0; i < telemetry->endpoint_count; i++) {
+    if (strcmp(telemetry->endpoints[i].name, name) == 0)
+      return &telemetry->endpoints[i];
+  }
+
+  if (telemetry->endpoint_count == NET_TELEMETRY_MAX_ENDPOINTS)
+    return NULL;
+
+  NetEndpoint *endpoint = &telemetry->endpoints[telemetry->endpoint_count++];
+  snprintf(endpoint->name, sizeof(endpoint->name), "%s", name);
+
+  return endpoint;
+}
+
+static void load(NetTelemetry *telemetry) {
+  sqlite3_stmt *stmt = NULL;
+
+  if (sqlite3_prepare_v2(telemetry->db,
+                         "SELECT endpoint, requests, failures, bytes_up, "
+                         "bytes_down FROM net_endpoint;",
+                         -1, &stmt, NULL) == SQLITE_OK) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      NetEndpoint *endpoint = find_endpoint(
+          telemetry, (const char *)sqlite3_column_text(stmt, 0));
+      if (!endpoint)
+        continue;
+
+      endpoint->requests = sqlite3_column_int64(stmt, 1);
+      endpoint->failures = sqlite3_column_int64(stmt, 2);
+      endpoint->bytes_up = sqlite3_column_int64(stmt, 3);
+      endpoint->bytes_down = sqlite3_column_int64(stmt, 4);
+    }
+  }
+  sqlite3_finalize(stmt);
+  stmt = NULL;
+
+  if (sqlite3_prepare_v2(telemetry->db,
+                         "SELECT endpoint, phase, bucket, count "
+                         "FROM net_histogram;",
+                         -1, &stmt, NULL) == SQLITE_OK) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      NetEndpoint *endpoint = find_endpoint(
+          telemetry, (const char *)sqlite3_column_text(stmt, 0));
+      int phase = phase_from_name((const char *)sqlite3_column_text(stmt, 1));
+      if (!endpoint || phase < 0)
+        continue;
+
+      histogram_add_bucket(&endpoint->phases[phase],
+                           sqlite3_column_int(stmt, 2),
+                           (uint64_t)sqlite3_column_int64(stmt, 3));
+    }
+  }
+  sqlite3_finalize(stmt);
+}
+
+NetTelemetry *net_telemetry_open(sqlite3 *db) {
+  NetTelemetry *telemetry = calloc(1, sizeof(NetTelemetry));
+  if (!telemetry)
+    return NULL;
+
+  pthread_mutex_init(&telemetry->lock, NULL);
+  if (!db)
+    return telemetry;
+
+  // buckets are numbered as in histogram.h, a new layout needs new tables
+  const char *create_tables_sql =
+      "CREATE TABLE IF NOT EXISTS net_endpoint ("
+      "endpoint TEXT PRIMARY KEY,"
+      "requests INTEGER NOT NULL,"
+      "failures INTEGER NOT NULL,"
+      "bytes_up INTEGER NOT NULL,"
+      "bytes_down INTEGER NOT NULL"
+      ");"
+      "CREATE TABLE IF NOT EXISTS net_histogram ("
+      "endpoint TEXT NOT NULL,"
+      "phase TEXT NOT NULL,"
+      "bucket INTEGER NOT NULL,"
+      "count INTEGER NOT NULL,"
+      "PRIMARY KEY (endpoint, phase, bucket)"
+      ");";
+
+  if (sqlite3_exec(db, create_tables_sql, 0, 0, NULL) != SQLITE_OK) {
+    fprintf(stderr, "[ERROR] Could not create telemetry tables: %s\n",
+            sqlite3_errmsg(db));
+    return telemetry;
+  }
+
+  sqlite3_prepare_v2(db,
+                     "INSERT OR REPLACE INTO net_endpoint "
+                     "(endpoint, requests, failures, bytes_up, bytes_down) "
+                     "VALUES (?, ?, ?, ?, ?);",
+                     -1, &telemetry->save_endpoint_stmt, NULL);
+  sqlite3_prepare_v2(db,
+                     "INSERT OR REPLACE INTO net_histogram "
+                     "(endpoint, phase, bucket, count) VALUES (?, ?, ?, ?);",
+                     -1, &telemetry->save_bucket_stmt, NULL);
+
+  if (!telemetry->save_endpoint_stmt || !telemetry->save_bucket_stmt) {
+    fprintf(stderr, "[ERROR] Could not prepare telemetry: %s\n",
+            sqlite3_errmsg(db));
+    sqlite3_finalize(telemetry->save_endpoint_stmt);
+    sqlite3_finalize(telemetry->save_bucket_stmt);
+    telemetry->save_endpoint_stmt = NULL;
+    telemetry->save_bucket_stmt = NULL;
+    return telemetry;
+  }
+
+  telemetry->db = db;
+  load(telemetry);
+
+  return telemetry;
+}
+
+void net_telemetry_close(NetTelemetry *telemetry) {
+  if (!telemetry)
+    return;
+
+  net_telemetry_save(telemetry);
+
+  sqlite3_finalize(telemetry->save_endpoint_stmt);
+  sqlite3_finalize(telemetry->save_bucket_stmt);
+  pthread_mutex_destroy(&telemetry->lock);
+  free(telemetry);
+}
+
+void net_telemetry_record(NetTelemetry *telemetry, const char *endpoint,
+                          CURL *curl, CURLcode result) {
+  if (!telemetry)
+    return;
+
+  curl_off_t times[NET_PHASE_COUNT] = {0};
+  for (int i = 0; i < NET_PHASE_COUNT; i++) {
+    curl_easy_getinfo(curl, phase_infos[i], &times[i]);
+  }
+
+  curl_off_t uploaded = 0;
+  curl_off_t downloaded = 0;
+  curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &uploaded);
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+
+  pthread_mutex_lock(&telemetry->lock);
+
+  NetEndpoint *slot = find_endpoint(telemetry, endpoint ? endpoint : "other");
+  if (slot) {
+    // a phase the transfer never reached reads 0, e.g. TLS over plain
+    // http or anything after a failed connect
+    for (int i = 0; i < NET_PHASE_COUNT; i++) {
+      if (times[i] > 0 || i == NET_PHASE_TOTAL)
+        histogram_add(&slot->phases[i], (uint64_t)times[i]);
+    }
+
+    slot->requests++;
+    if (result != CURLE_OK)
+      slot->failures++;
+    slot->bytes_up += uploaded;
+    slot->bytes_down += downloaded;
+    telemetry->dirty = true;
+  }
+
+  pthread_mutex_unlock(&telemetry->lock);
+}
+
+int net_telemetry_save(NetTelemetry *telemetry) {
+  if (!telemetry || !telemetry->db)
+    return -1;
+
+  // copied out so recording threads don't wait on the disk
+  NetEndpoint *endpoints = malloc(sizeof(telemetry->endpoints));
+  if (!endpoints)
+    return -1;
+
+  pthread_mutex_lock(&telemetry->lock);
+  bool dirty = telemetry->dirty;
+  int count = telemetry->endpoint_count;
+  memcpy(endpoints, telemetry->endpoints, count * sizeof(NetEndpoint));
+  telemetry->dirty = false;
+  pthread_mutex_unlock(&telemetry->lock);
+
+  if (!dirty) {
+    free(endpoints);
+    return 0;
+  }
+
+  int failed = 0;
+  sqlite3_stmt *stmt;
+
+  // the write lock up front, so a busy database is waited out by the busy
+  // timeout instead of failing halfway through
+  sqlite3_exec(telemetry->db, "BEGIN IMMEDIATE;", 0, 0, NULL);
+
+  for (int i = 0; i < count && !failed; i++) {
+    NetEndpoint *endpoint = &endpoints[i];
+
+    stmt = telemetry->save_endpoint_stmt;
+    sqlite3_bind_text(stmt, 1, endpoint->name, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)endpoint->requests);
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)endpoint->failures);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)endpoint->bytes_up);
+    sqlite3_bind_int64(stmt, 5, (sqlite3_int64)endpoint->bytes_down);
+    failed = sqlite3_step(stmt) != SQLITE_DONE;
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    // buckets only ever grow, so the non-empty ones are all there is to
+    // write
+    stmt = telemetry->save_bucket_stmt;
+    for (int phase = 0; phase < NET_PHASE_COUNT && !failed; phase++) {
+      Histogram *h = &endpoint->phases[phase];
+
+      for (int bucket = 0; bucket < HISTOGRAM_BUCKETS && !failed; bucket++) {
+        if (h->counts[bucket] == 0)
+          continue;
+
+        sqlite3_bind_text(stmt, 1, endpoint->name, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, phase_names[phase], -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 3, bucket);
+        sqlite3_bind_int64(stmt, 4, (sqlite3_int64)h->counts[bucket]);
+        failed = sqlite3_step(stmt) != SQLITE_DONE;
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+      }
+    }
+  }
+
+  if (failed) {
+    fprintf(stderr, "[ERROR] Could not save telemetry: %s\n",
+            sqlite3_errmsg(telemetry->db));
+    sqlite3_exec(telemetry->db, "ROLLBACK;", 0, 0, NULL);
+
+    pthread_mutex_lock(&telemetry->lock);
+    telemetry->dirty = true;
+    pthread_mutex_unlock(&telemetry->lock);
+  } else {
+    sqlite3_exec(telemetry->db, "COMMIT;", 0, 0, NULL);
+  }
+
+  free(endpoints);
+
+  return failed ? -1 : 0;
+}
+
+int net_telemetry_snapshot(NetTelemetry *telemetry, NetEndpoint *out,
+                           int max) {
+  if (!telemetry)
+    return 0;
+
+  pthread_mutex_lock(&telemetry->lock);
+  int count = telemetry->endpoint_count < max ? telemetry->endpoint_count : max;
+  memcpy(out, telemetry->endpoints, count * sizeof(NetEndpoint));
+  pthread_mutex_unlock(&telemetry->lock);
+
+  return count;
+}
@@ -0,0 +1,76 @@
+#ifndef NETTELEMETRY_H
+#define NETTELEMETRY_H
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "histogram.h"
+
+// generate, stream, batch, cache, files, three upload steps, warmup and
+// whatever comes next
+#define NET_TELEMETRY_MAX_ENDPOINTS 16
+#define NET_TELEMETRY_NAME_SIZE 32
+
+// curl's timings, each measured from the start of the transfer like
+// curl -w reports them
+typedef enum NetPhase {
+  NET_PHASE_DNS,         // namelookup
+  NET_PHASE_CONNECT,     // TCP connected
+  NET_PHASE_TLS,         // appconnect, handshake done
+  NET_PHASE_PRETRANSFER, // request about to go out
+  NET_PHASE_FIRST_BYTE,  // starttransfer
+  NET_PHASE_TOTAL,
+  NET_PHASE_COUNT
+} NetPhase;
+
+typedef struct NetEndpoint {
+  char name[NET_TELEMETRY_NAME_SIZE];
+  Histogram phases[NET_PHASE_COUNT]; // microseconds
+
+  unsigned long long requests; // every transfer, retries and hedges too
+  unsigned long long failures; // transport errors, HTTP errors count as ok
+  unsigned long long bytes_up; // bodies as they crossed the wire
+  unsigned long long bytes_down;
+} NetEndpoint;
+
+// timings of every transfer, per endpoint, kept across runs in the cache
+// database. safe to record into from any thread
+typedef struct NetTelemetry {
+  pthread_mutex_t lock;
+  sqlite3 *db;
+  sqlite3_stmt *save_bucket_stmt;
+  sqlite3_stmt *save_endpoint_stmt;
+
+  NetEndpoint endpoints[NET_TELEMETRY_MAX_ENDPOINTS];
+  int endpoint_count;
+  bool dirty; // recorded into since the last save
+} NetTelemetry;
+
+// loads what earlier runs saved, db may be NULL to keep it in memory only.
+// saves run in a transaction, so db is a connection of its own (see
+// cache_db_open()), the caller closes it after net_telemetry_close()
+NetTelemetry *net_telemetry_open(sqlite3 *db);
+// saves and frees
+void net_telemetry_close(NetTelemetry *telemetry);
+
+// adds the finished transfer on curl under endpoint (NULL: "other"). does
+// nothing without telemetry
+void net_telemetry_record(NetTelemetry *telemetry, const char *endpoint,
+                          CURL *curl, CURLcode result);
+
+// writes the histograms back in one transaction when something changed,
+// returns 0 on success
+int net_telemetry_save(NetTelemetry *telemetry);
+
+// copies up to max endpoints into out for display, returns how many
+int net_telemetry_snapshot(NetTelemetry *telemetry, NetEndpoint *out,
+                           int max);
+
+const char *net_phase_name(NetPhase phase);
+
+#endif
@@ -0,0 +1,257 @@
+#include "token_usage.h"
+
+// "YYYY-MM-DD" in local time, days_ago before today
+static void local_day(int days_ago, char out[11]) {
+  time_t when = time(NULL) - (time_t)days_ago * 24 * 60 * 60;
+  struct tm *local = localtime(&when);
+
+  if (!local || strftime(out, 11, "%Y-%m-%d", local) == 0)
+    snprintf(out, 11, "0000-00-00");
+}
+
+static long long usage_field(const JsonSlice *usage, const char *name) {
+  JsonSlice value;
+  if (json_slice_find(usage, name, &value) != 0)
+    return 0;
+
+  return json_slice_int(&value, 0);
+}
+
+int token_usage_parse(const char *json, size_t len, const char *path,
+                      TokenUsage *out) {
+  memset(out, 0, sizeof(*out));
+  if (!json)
+    return -1;
+
+  JsonSlice usage;
+  if (json_find(json, len, path, &usage) != 0)
+    return -1;
+
+  out->prompt = usage_field(&usage, "promptTokenCount");
+  out->candidates = usage_field(&usage, "candidatesTokenCount");
+  out->cached = usage_field(&usage, "cachedContentTokenCount");
+  out->thoughts = usage_field(&usage, "thoughtsTokenCount");
+  out->total = usage_field(&usage, "totalTokenCount");
+  if (out->total == 0)
+    out->total = out->prompt + out->candidates + out->thoughts;
+
+  return 0;
+}
+
+TokenLedger *token_ledger_open(sqlite3 *db) {
+  if (!db)
+    return NULL;
+
+  const char *create_table_sql =
+      "CREATE TABLE IF NOT EXISTS token_usage ("
+      "day TEXT NOT NULL,"
+      "user TEXT NOT NULL,"
+      "feature TEXT NOT NULL,"
+      "requests INTEGER NOT NULL,"
+      "prompt_tokens INTEGER NOT NULL,"
+      "candidate_tokens INTEGER NOT NULL,"
+      "cached_tokens INTEGER NOT NULL,"
+      "total_tokens INTEGER NOT NULL,"
+      "max_prompt_tokens INTEGER NOT NULL,"
+      "PRIMARY KEY (day, user, feature)"
+      ");";
+
+  if (sqlite3_exec(db, create_table_sql, 0, 0, NULL) != SQLITE_OK)
+    return NULL;
+
+  TokenLedger *ledger = calloc(1, sizeof(TokenLedger));
+  if (!ledger)
+    return NULL;
+
+  ledger->db = db;
+  pthread_mutex_init(&ledger->lock, NULL);
+
+  // one row per day, user and feature, every answer adds to it
+  sqlite3_prepare_v2(
+      db,
+      "INSERT INTO token_usage (day, user, feature, requests, prompt_tokens, "
+      "candidate_tokens, cached_tokens, total_tokens, max_prompt_tokens) "
+      "VALUES (?, ?, ?, 1, ?, ?, ?, ?, ?) "
+      "ON CONFLICT (day, user, feature) DO UPDATE SET "
+      "requests = requests + 1,"
+      "prompt_tokens = prompt_tokens + excluded.prompt_tokens,"
+      "candidate_tokens = candidate_tokens + excluded.candidate_tokens,"
+      "cached_tokens = cached_tokens + excluded.cached_tokens,"
+      "total_tokens = total_tokens + excluded.total_tokens,"
+      "max_prompt_tokens = MAX(max_prompt_tokens, "
+      "excluded.max_prompt_tokens);",
+      -1, &ledger->add_stmt, NULL);
+  sqlite3_prepare_v2(db,
+                     "SELECT COALESCE(SUM(total_tokens), 0) FROM token_usage "
+                     "WHERE day = ? AND user = ?;",
+                     -1, &ledger->used_stmt, NULL);
+
+  if (!ledger->add_stmt || !ledger->used_stmt) {
+    fprintf(stderr, "[ERROR] Could not prepare token ledger: %s\n",
+            sqlite3_errmsg(db));
+    token_ledger_close(ledger);
+    return NULL;
+  }
+
+  return ledger;
+}
+
+void token_ledger_close(TokenLedger *ledger) {
+  if (!ledger)
+    return;
+
+  sqlite3_finalize(ledger->add_stmt);
+  sqlite3_finalize(ledger->used_stmt);
+  pthread_mutex_destroy(&ledger->lock);
+  free(ledger);
+}
+
+void token_ledger_set_budget(TokenLedger *ledger, const char *user,
+                             long long daily_tokens) {
+  if (!ledger)
+    return;
+
+  pthread_mutex_lock(&ledger->lock);
+
+  if (!user) {
+    ledger->daily_budget = daily_tokens;
+    pthread_mutex_unlock(&ledger->lock);
+    return;
+  }
+
+  TokenBudget *budget = NULL;
+  for (int i = 0; i < ledger->budget_count && !budget; i++) {
+    if (strcmp(ledger->budgets[i].user, user) == 0)
+      budget = &ledger->budgets[i];
+  }
+  if (!budget && ledger->budget_count < TOKEN_LEDGER_MAX_BUDGETS) {
+    budget = &ledger->budgets[ledger->budget_count++];
+    snprintf(budget->user, sizeof(budget->user), "%s", user);
+  }
+  if (budget)
+    budget->daily_tokens = daily_tokens;
+
+  pthread_mutex_unlock(&ledger->lock);
+}
+
+long long token_ledger_budget(TokenLedger *ledger, const char *user) {
+  if (!ledger)
+    return 0;
+
+  pthread_mutex_lock(&ledger->lock);
+
+  long long daily_tokens = ledger->daily_budget;
+  for (int i = 0; i < ledger->budget_count; i++) {
+    if (user && strcmp(ledger->budgets[i].user, user) == 0)
+      daily_tokens = ledger->budgets[i].daily_tokens;
+  }
+
+  pthread_mutex_unlock(&ledger->lock);
+
+  return daily_tokens;
+}
+
+long long token_ledger_used_today(TokenLedger *ledger, const char *user) {
+  if (!ledger || !user)
+    return 0;
+
+  pthread_mutex_lock(&ledger->lock);
+
+  char day[11];
+  local_day(0, day);
+
+  sqlite3_stmt *stmt = ledger->used_stmt;
+  sqlite3_bind_text(stmt, 1, day, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 2, user, -1, SQLITE_STATIC);
+
+  long long used = 0;
+  if (sqlite3_step(stmt) == SQLITE_ROW)
+    used = sqlite3_column_int64(stmt, 0);
+
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  pthread_mutex_unlock(&ledger->lock);
+
+  return used;
+}
+
+bool token_ledger_allow(TokenLedger *ledger, const char *user,
+                        long long estimate) {
+  long long budget = token_ledger_budget(ledger, user);
+  if (budget <= 0)
+    return true;
+
+  return token_ledger_used_today(ledger, user) + estimate <= budget;
+}
+
+void token_ledger_add(TokenLedger *ledger, const char *user,
+                      const char *feature, const TokenUsage *usage) {
+  if (!ledger || !user || !feature)
+    return;
+
+  pthread_mutex_lock(&ledger->lock);
+
+  char day[11];
+  local_day(0, day);
+
+  sqlite3_stmt *stmt = ledger->add_stmt;
+  sqlite3_bind_text(stmt, 1, day, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 2, user, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 3, feature, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 4, usage->prompt);
+  sqlite3_bind_int64(stmt, 5, usage->candidates);
+  sqlite3_bind_int64(stmt, 6, usage->cached);
+  sqlite3_bind_int64(stmt, 7, usage->total);
+  sqlite3_bind_int64(stmt, 8, usage->prompt);
+
+  if (sqlite3_step(stmt) != SQLITE_DONE) {
+    fprintf(stderr, "[ERROR] Could not record token usage: %s\n",
+            sqlite3_errmsg(ledger->db));
+  }
+
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  pthread_mutex_unlock(&ledger->lock);
+}
+
+int token_ledger_report(TokenLedger *ledger, int days, TokenUsageRow *out,
+                        int max) {
+  if (!ledger || days < 1)
+    return 0;
+
+  char since[11];
+  local_day(days - 1, since);
+
+  sqlite3_stmt *stmt = NULL;
+  if (sqlite3_prepare_v2(
+          ledger->db,
+          "SELECT user, feature, SUM(requests), SUM(prompt_tokens), "
+          "SUM(candidate_tokens), SUM(cached_tokens), SUM(total_tokens), "
+          "MAX(max_prompt_tokens) FROM token_usage WHERE day >= ? "
+          "GROUP BY user, feature ORDER BY SUM(prompt_tokens) DESC;",
+          -1, &stmt, NULL) != SQLITE_OK)
+    return 0;
+
+  sqlite3_bind_text(stmt, 1, since, -1, SQLITE_STATIC);
+
+  int count = 0;
+  while (count < max && sqlite3_step(stmt) == SQLITE_ROW) {
+    TokenUsageRow *row = &out[count++];
+    snprintf(row->user, sizeof(row->user), "%s",
+             (const char *)sqlite3_column_text(stmt, 0));
+    snprintf(row->feature, sizeof(row->feature), "%s",
+             (const char *)sqlite3_column_text(stmt, 1));
+    row->requests = sqlite3_column_int64(stmt, 2);
+    row->prompt = sqlite3_column_int64(stmt, 3);
+    row->candidates = sqlite3_column_int64(stmt, 4);
+    row->cached = sqlite3_column_int64(stmt, 5);
+    row->total = sqlite3_column_int64(stmt, 6);
+    row->max_prompt = sqlite3_column_int64(stmt, 7);
+  }
+
+  sqlite3_finalize(stmt);
+
+  return count;
+}
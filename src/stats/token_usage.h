@@ -0,0 +1,86 @@
+#ifndef TOKENUSAGE_H
+#define TOKENUSAGE_H
+
+#include <pthread.h>
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../utils/json_extract.h"
+
+#define TOKEN_LEDGER_MAX_BUDGETS 32
+#define TOKEN_LEDGER_NAME_SIZE 64
+
+// usageMetadata of one generateContent answer
+typedef struct TokenUsage {
+  long long prompt;     // promptTokenCount, cached tokens included
+  long long candidates; // candidatesTokenCount
+  long long cached;     // cachedContentTokenCount
+  long long thoughts;   // thoughtsTokenCount
+  long long total;      // totalTokenCount, what the budget counts
+} TokenUsage;
+
+// a user's own daily limit, overriding the ledger's default
+typedef struct TokenBudget {
+  char user[TOKEN_LEDGER_NAME_SIZE];
+  long long daily_tokens;
+} TokenBudget;
+
+// tokens per day, user and feature in the cache database, plus the daily
+// budgets they are checked against. safe to use from any thread
+typedef struct TokenLedger {
+  pthread_mutex_t lock;
+  sqlite3 *db;
+  sqlite3_stmt *add_stmt;
+  sqlite3_stmt *used_stmt;
+
+  long long daily_budget; // every user's, 0 for none
+  TokenBudget budgets[TOKEN_LEDGER_MAX_BUDGETS];
+  int budget_count;
+} TokenLedger;
+
+// one user and feature summed over a report's days
+typedef struct TokenUsageRow {
+  char user[TOKEN_LEDGER_NAME_SIZE];
+  char feature[TOKEN_LEDGER_NAME_SIZE];
+  long long requests;
+  long long prompt;
+  long long candidates;
+  long long cached;
+  long long total;
+  long long max_prompt; // largest single prompt
+} TokenUsageRow;
+
+// finds the usageMetadata object at path ("usageMetadata" in an answer,
+// "response.usageMetadata" in a batch item), returns 0 when there is one
+int token_usage_parse(const char *json, size_t len, const char *path,
+                      TokenUsage *out);
+
+// NULL when there is no database to keep the counts in
+TokenLedger *token_ledger_open(sqlite3 *db);
+void token_ledger_close(TokenLedger *ledger);
+
+// user NULL sets the default for everyone, 0 tokens means no limit
+void token_ledger_set_budget(TokenLedger *ledger, const char *user,
+                             long long daily_tokens);
+long long token_ledger_budget(TokenLedger *ledger, const char *user);
+
+// total tokens user spent since local midnight
+long long token_ledger_used_today(TokenLedger *ledger, const char *user);
+
+// whether about estimate more tokens still fit in user's budget today
+bool token_ledger_allow(TokenLedger *ledger, const char *user,
+                        long long estimate);
+
+void token_ledger_add(TokenLedger *ledger, const char *user,
+                      const char *feature, const TokenUsage *usage);
+
+// usage of the last days (1 is today only) per user and feature, biggest
+// prompt spenders first. returns how many rows went into out
+int token_ledger_report(TokenLedger *ledger, int days, TokenUsageRow *out,
+                        int max);
+
+#endif
@@ -0,0 +1,236 @@
+#include "structured_output.h"
+
+static const char *schema_type(StructuredKind kind) {
+  switch (kind) {
+  case STRUCTURED_STRING:
+    return "STRING";
+  case STRUCTURED_INT:
+    return "INTEGER";
+  case STRUCTURED_NUMBER:
+    return "NUMBER";
+  case STRUCTURED_BOOL:
+    return "BOOLEAN";
+  case STRUCTURED_STRINGS:
+    return "ARRAY";
+  }
+  return "STRING";
+}
+
+void structured_write_config(JsonWriter *w, const StructuredType *type) {
+  json_key(w, "generationConfig");
+  json_begin_object(w);
+  json_key(w, "responseMimeType");
+  json_string(w, "application/json");
+
+  json_key(w, "responseSchema");
+  json_begin_object(w);
+  json_key(w, "type");
+  json_string(w, "ARRAY");
+  json_key(w, "items");
+  json_begin_object(w);
+  json_key(w, "type");
+  json_string(w, "OBJECT");
+  if (type->description) {
+    json_key(w, "description");
+    json_string(w, type->description);
+  }
+
+  json_key(w, "properties");
+  json_begin_object(w);
+  for (size_t i = 0; i < type->field_count; i++) {
+    const StructuredField *field = &type->fields[i];
+    json_key(w, field->name);
+    json_begin_object(w);
+    json_key(w, "type");
+    json_string(w, schema_type(field->kind));
+    if (field->kind == STRUCTURED_STRINGS) {
+      json_key(w, "items");
+      json_begin_object(w);
+      json_key(w, "type");
+      json_string(w, "STRING");
+      json_end_object(w);
+    }
+    if (field->description) {
+      json_key(w, "description");
+      json_string(w, field->description);
+    }
+    json_end_object(w);
+  }
+  json_end_object(w);
+
+  // every field is required and comes in declaration order, so the model
+  // can't leave the decoder a gap
+  json_key(w, "required");
+  json_begin_array(w);
+  for (size_t i = 0; i < type->field_count; i++) {
+    json_string(w, type->fields[i].name);
+  }
+  json_end_array(w);
+
+  json_key(w, "propertyOrdering");
+  json_begin_array(w);
+  for (size_t i = 0; i < type->field_count; i++) {
+    json_string(w, type->fields[i].name);
+  }
+  json_end_array(w);
+
+  json_end_object(w); // items
+  json_end_object(w); // responseSchema
+  json_end_object(w); // generationConfig
+}
+
+static bool is_number(const JsonSlice *slice) {
+  char c = slice->len > 0 ? slice->start[0] : '\0';
+  return c == '-' || (c >= '0' && c <= '9');
+}
+
+static void free_strings(StructuredStrings *strings) {
+  for (size_t i = 0; i < strings->count; i++) {
+    free(strings->items[i]);
+  }
+  free(strings->items);
+  strings->items = NULL;
+  strings->count = 0;
+}
+
+static int decode_strings(const JsonSlice *array, StructuredStrings *out) {
+  if (array->len == 0 || array->start[0] != '[')
+    return -1;
+
+  size_t cap = 0;
+  const char *cursor = NULL;
+  JsonSlice element;
+  while (json_array_next(array, &cursor, &element) == 0) {
+    char *value = json_slice_string(&element);
+    if (!value)
+      return -1;
+
+    if (out->count == cap) {
+      cap = cap ? cap * 2 : 4;
+      char **grown = realloc(out->items, cap * sizeof(char *));
+      if (!grown) {
+        free(value);
+        return -1;
+      }
+      out->items = grown;
+    }
+    out->items[out->count++] = value;
+  }
+
+  return 0;
+}
+
+static int decode_field(const JsonSlice *object, const StructuredField *field,
+                        char *item) {
+  JsonSlice value;
+  if (json_slice_find(object, field->name, &value) != 0)
+    return -1;
+
+  void *at = item + field->offset;
+  switch (field->kind) {
+  case STRUCTURED_STRING:
+    *(char **)at = json_slice_string(&value);
+    return *(char **)at ? 0 : -1;
+  case STRUCTURED_INT:
+    if (!is_number(&value))
+      return -1;
+    *(long long *)at = json_slice_int(&value, 0);
+    return 0;
+  case STRUCTURED_NUMBER:
+    if (!is_number(&value))
+      return -1;
+    *(double *)at = json_slice_double(&value, 0);
+    return 0;
+  case STRUCTURED_BOOL:
+    if (value.len == 4 && memcmp(value.start, "true", 4) == 0)
+      *(bool *)at = true;
+    else if (value.len == 5 && memcmp(value.start, "false", 5) == 0)
+      *(bool *)at = false;
+    else
+      return -1;
+    return 0;
+  case STRUCTURED_STRINGS:
+    return decode_strings(&value, (StructuredStrings *)at);
+  }
+
+  return -1;
+}
+
+static void free_item(const StructuredType *type, char *item) {
+  for (size_t i = 0; i < type->field_count; i++) {
+    const StructuredField *field = &type->fields[i];
+    void *at = item + field->offset;
+    if (field->kind == STRUCTURED_STRING) {
+      free(*(char **)at);
+      *(char **)at = NULL;
+    } else if (field->kind == STRUCTURED_STRINGS) {
+      free_strings((StructuredStrings *)at);
+    }
+  }
+}
+
+void *structured_decode(const StructuredType *type, const char *json,
+                        size_t len, size_t *out_count) {
+  *out_count = 0;
+  if (!json)
+    return NULL;
+
+  // the array itself, whatever whitespace the model put around it
+  JsonSlice array = {json, len};
+  while (array.len > 0 && array.start[0] != '[') {
+    array.start++;
+    array.len--;
+  }
+  if (array.len == 0)
+    return NULL;
+
+  size_t cap = 0;
+  size_t count = 0;
+  char *items = NULL;
+  const char *cursor = NULL;
+  JsonSlice element;
+  while (json_array_next(&array, &cursor, &element) == 0) {
+    if (element.len == 0 || element.start[0] != '{')
+      continue;
+
+    if (count == cap) {
+      size_t grown_cap = cap ? cap * 2 : 8;
+      char *grown = realloc(items, grown_cap * type->size);
+      if (!grown)
+        break;
+      items = grown;
+      cap = grown_cap;
+    }
+
+    char *item = items + count * type->size;
+    memset(item, 0, type->size);
+
+    bool ok = true;
+    for (size_t i = 0; i < type->field_count && ok; i++) {
+      ok = decode_field(&element, &type->fields[i], item) == 0;
+    }
+
+    if (ok)
+      count++;
+    else
+      free_item(type, item);
+  }
+
+  if (count == 0) {
+    free(items);
+    return NULL;
+  }
+
+  *out_count = count;
+  return items;
+}
+
+void structured_free(const StructuredType *type, void *items, size_t count) {
+  if (!items)
+    return;
+
+  for (size_t i = 0; i < count; i++) {
+    free_item(type, (char *)items + i * type->size);
+  }
+  free(items);
+}
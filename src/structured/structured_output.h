@@ -0,0 +1,83 @@
+#ifndef STRUCTUREDOUTPUT_H
+#define STRUCTUREDOUTPUT_H
+
+#include "../utils/json_extract.h"
+#include "../utils/json_writer.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a list of strings inside a decoded item, e.g. a quiz question's choices
+typedef struct StructuredStrings {
+  char **items;
+  size_t count;
+} StructuredStrings;
+
+typedef enum StructuredKind {
+  STRUCTURED_STRING,  // char *
+  STRUCTURED_INT,     // long long
+  STRUCTURED_NUMBER,  // double
+  STRUCTURED_BOOL,    // bool
+  STRUCTURED_STRINGS, // StructuredStrings
+} StructuredKind;
+
+typedef struct StructuredField {
+  const char *name;
+  StructuredKind kind;
+  size_t offset;
+  const char *description; // tells the model what goes in it
+} StructuredField;
+
+// one item type, the answer is an array of them
+typedef struct StructuredType {
+  const char *name;
+  const char *description;
+  const StructuredField *fields;
+  size_t field_count;
+  size_t size;
+} StructuredType;
+
+// an item type is declared once as an X-macro list of
+// X(type, field, KIND, "description") entries. STRUCTURED_DECLARE(type,
+// LIST) in a header gives the plain C struct and type##_schema, and
+// STRUCTURED_DEFINE(type, LIST, "description") in one .c file builds the
+// field table the schema writer and the decoder share. see study_types.h
+#define STRUCTURED_C_STRING char *
+#define STRUCTURED_C_INT long long
+#define STRUCTURED_C_NUMBER double
+#define STRUCTURED_C_BOOL bool
+#define STRUCTURED_C_STRINGS StructuredStrings
+
+#define STRUCTURED_MEMBER(type, field, kind, description)                     \
+  STRUCTURED_C_##kind field;
+#define STRUCTURED_FIELD(type, field, kind, description)                      \
+  {#field, STRUCTURED_##kind, offsetof(type, field), description},
+
+#define STRUCTURED_DECLARE(type, FIELDS)                                      \
+  typedef struct type {                                                       \
+    FIELDS(STRUCTURED_MEMBER)                                                 \
+  } type;                                                                     \
+  extern const StructuredType type##_schema;
+
+#define STRUCTURED_DEFINE(type, FIELDS, description)                          \
+  static const StructuredField type##_fields[] = {FIELDS(STRUCTURED_FIELD)};  \
+  const StructuredType type##_schema = {                                      \
+      #type, description, type##_fields,                                      \
+      sizeof(type##_fields) / sizeof(type##_fields[0]), sizeof(type)};
+
+// "generationConfig": {"responseMimeType": "application/json",
+// "responseSchema": <array of type>} into an open object
+void structured_write_config(JsonWriter *w, const StructuredType *type);
+
+// the answer text (a JSON array of type objects) as a malloc'd array of
+// type structs, scanned in place without building a tree. items missing a
+// field or holding the wrong kind are skipped. NULL with *out_count 0 when
+// nothing usable came back, free it with structured_free()
+void *structured_decode(const StructuredType *type, const char *json,
+                        size_t len, size_t *out_count);
+
+void structured_free(const StructuredType *type, void *items, size_t count);
+
+#endif
@@ -0,0 +1,6 @@
+#include "study_types.h"
+
+STRUCTURED_DEFINE(Flashcard, FLASHCARD_FIELDS,
+                  "one flashcard from the given material")
+STRUCTURED_DEFINE(QuizQuestion, QUIZ_QUESTION_FIELDS,
+                  "one multiple choice question about the given material")
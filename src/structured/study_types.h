@@ -0,0 +1,22 @@
+#ifndef STUDYTYPES_H
+#define STUDYTYPES_H
+
+#include "structured_output.h"
+
+// X(type, field, KIND, "description"), KIND being STRING, INT, NUMBER, BOOL
+// or STRINGS. adding a field here adds it to the struct, the schema and the
+// decoder at once
+#define FLASHCARD_FIELDS(X)                                                   \
+  X(Flashcard, front, STRING, "the term or question")                         \
+  X(Flashcard, back, STRING, "the definition or answer")
+
+#define QUIZ_QUESTION_FIELDS(X)                                               \
+  X(QuizQuestion, question, STRING, "the question")                           \
+  X(QuizQuestion, choices, STRINGS, "the possible answers")                   \
+  X(QuizQuestion, answer, INT, "zero based index of the right choice")        \
+  X(QuizQuestion, explanation, STRING, "why that choice is right")
+
+STRUCTURED_DECLARE(Flashcard, FLASHCARD_FIELDS)
+STRUCTURED_DECLARE(QuizQuestion, QUIZ_QUESTION_FIELDS)
+
+#endif
@@ -1,11 +1,78 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <stddef.h>
+#include <stdio.h>
+
+// growable byte buffer, see utils/memory_buffer.h. {malloc(1), 0} still
+// works as an empty buffer, capacity 0 just means "unknown"
 typedef struct Memory {
   char *response;
   size_t size;
+  size_t capacity;
+
+  size_t spill_at; // 0 never spills, else bodies past this go to spill
+  FILE *spill;     // temp file holding the whole body once spilled
+  size_t spilled;  // bytes of the body in spill
+  void *view;      // spill mapped by memory_body(), NULL until then
+
+  size_t limit;   // 0 for none, else appends past it fail
+  int over_limit; // an append failed on limit, the transfer was aborted
+
+  size_t written; // bytes appended since init, spilled ones included
+  size_t peak;    // largest size held in memory
+  unsigned reallocs;
 } Memory;
 
+// state of one streamGenerateContent?alt=sse response, see sse_callback()
+typedef struct SseStream {
+  Memory line;  // bytes after the last complete line
+  Memory event; // data: payload of the event being assembled
+  Memory text;  // cleaned answer printed so far
+  Memory usage; // last event that had usageMetadata
+
+  // tail of the last chunk that may be the start of a split "\033"
+  char pending[4];
+  size_t pending_len;
+
+  int chunks;
+  void (*on_first_chunk)(void *arg);
+  void *on_first_chunk_arg;
+} SseStream;
+
+// a resumable File API upload read straight from disk one chunk at a time,
+// see get_file_uri_prepare() and read_callback()
+typedef struct FileUpload {
+  FILE *fptr;
+  long long size;
+  long long offset;    // bytes the server has acknowledged
+  long long chunk_len; // size of the chunk in flight
+  long long remaining; // bytes of that chunk read_callback still has to send
+  int finalize;        // chunk in flight is the last one
+  int resumes;
+
+  char *upload_url;
+  char *mime;
+  Memory headers; // response headers of the last request
+} FileUpload;
+
+// an uploaded File API file, filled from the "file" object of a response
+typedef struct GeminiFile {
+  char *uri;  // what generateContent references
+  char *name; // "files/<id>", for metadata and delete calls
+  const char *mime;
+  long long expires_at; // unix seconds
+  char hash[65];        // sha256 of the local file, content cache key
+} GeminiFile;
+
+// an attachment sent base64 in the request body instead of uploaded, see
+// gemini_api/attachment_plan.h
+typedef struct InlinePart {
+  const char *mime;
+  char *data; // base64, NUL terminated
+  size_t data_len;
+} InlinePart;
+
 typedef struct CallType {
   char *call_type;
 } CallType;
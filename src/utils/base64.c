@@ -0,0 +1,40 @@
+#include "base64.h"
+
+static const char alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+char *base64_encode(const unsigned char *data, size_t len, size_t *out_len) {
+  size_t encoded_len = BASE64_ENCODED_LEN(len);
+  char *out = malloc(encoded_len + 1);
+  if (!out)
+    return NULL;
+
+  char *p = out;
+  size_t i = 0;
+  for (; i + 2 < len; i += 3) {
+    unsigned long n = (unsigned long)data[i] << 16 |
+                      (unsigned long)data[i + 1] << 8 | data[i + 2];
+    *p++ = alphabet[n >> 18 & 63];
+    *p++ = alphabet[n >> 12 & 63];
+    *p++ = alphabet[n >> 6 & 63];
+    *p++ = alphabet[n & 63];
+  }
+
+  // one or two bytes left over
+  if (i < len) {
+    unsigned long n = (unsigned long)data[i] << 16;
+    if (i + 1 < len)
+      n |= (unsigned long)data[i + 1] << 8;
+
+    *p++ = alphabet[n >> 18 & 63];
+    *p++ = alphabet[n >> 12 & 63];
+    *p++ = i + 1 < len ? alphabet[n >> 6 & 63] : '=';
+    *p++ = '=';
+  }
+
+  *p = '\0';
+  if (out_len)
+    *out_len = encoded_len;
+
+  return out;
+}
@@ -0,0 +1,14 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+// encoded size of len bytes, padding included, without the NUL
+#define BASE64_ENCODED_LEN(len) (((len) + 2) / 3 * 4)
+
+// standard alphabet with "=" padding, what inline_data expects. returns a
+// malloc'd NUL terminated string, its length in out_len (may be NULL)
+char *base64_encode(const unsigned char *data, size_t len, size_t *out_len);
+
+#endif
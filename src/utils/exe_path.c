@@ -0,0 +1,51 @@
+#include "exe_path.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static int is_absolute(const char *path) {
+#ifdef _WIN32
+  // "C:\..." or "\\server\..." or "\..."
+  return (path[0] && path[1] == ':') || path[0] == '\\' || path[0] == '/';
+#else
+  return path[0] == '/';
+#endif
+}
+
+char *exe_relative_path(const char *path) {
+  if (is_absolute(path))
+    return strdup(path);
+
+  char exe[4096];
+#ifdef _WIN32
+  DWORD len = GetModuleFileNameA(NULL, exe, sizeof(exe));
+  if (len == 0 || len >= sizeof(exe))
+    return NULL;
+  char *dir_end = strrchr(exe, '\\');
+  char *slash = strrchr(exe, '/');
+  if (slash > dir_end)
+    dir_end = slash;
+#else
+  ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+  if (len <= 0)
+    return NULL;
+  exe[len] = '\0';
+  char *dir_end = strrchr(exe, '/');
+#endif
+  if (!dir_end)
+    return NULL;
+
+  size_t dir_len = dir_end - exe + 1; // keeps the separator
+  size_t path_len = strlen(path);
+  char *resolved = malloc(dir_len + path_len + 1);
+  if (!resolved)
+    return NULL;
+
+  memcpy(resolved, exe, dir_len);
+  memcpy(resolved + dir_len, path, path_len + 1);
+
+  return resolved;
+}
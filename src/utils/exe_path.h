@@ -0,0 +1,13 @@
+#ifndef EXEPATH_H
+#define EXEPATH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// path resolved against the directory of the running executable instead of
+// the working directory, absolute paths come back as they are. malloc'd,
+// NULL when the executable can't be located
+char *exe_relative_path(const char *path);
+
+#endif
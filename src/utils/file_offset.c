@@ -0,0 +1,24 @@
+#include "file_offset.h"
+
+int file_seek(FILE *fptr, long long offset) {
+#ifdef _WIN32
+  return _fseeki64(fptr, offset, SEEK_SET);
+#else
+  return fseeko(fptr, (off_t)offset, SEEK_SET);
+#endif
+}
+
+long long file_size(FILE *fptr) {
+#ifdef _WIN32
+  if (_fseeki64(fptr, 0, SEEK_END) != 0)
+    return -1;
+  long long length = _ftelli64(fptr);
+#else
+  if (fseeko(fptr, 0, SEEK_END) != 0)
+    return -1;
+  long long length = (long long)ftello(fptr);
+#endif
+  rewind(fptr);
+
+  return length;
+}
@@ -0,0 +1,10 @@
+#ifndef FILEOFFSET_H
+#define FILEOFFSET_H
+
+#include <stdio.h>
+
+// 64-bit seek/size so uploads past 2 GB work on windows (long is 32-bit)
+int file_seek(FILE *fptr, long long offset);
+long long file_size(FILE *fptr);
+
+#endif
@@ -1,13 +1,18 @@
 #include "gemini_loading.h"
 
-bool is_generating = false;
+volatile bool is_generating = false;
 
 void *gemini_loading(void *arg) {
-  printf("\033[92mThinking");
+  printf("\033[92mThinking \033[90m(Esc to cancel)\033[92m");
 
   while (is_generating) {
     printf(".");
-    delay(500);
+    fflush(stdout);
+
+    // sleep in short slices so stopping the dots never delays the answer
+    for (int i = 0; i < 10 && is_generating; i++) {
+      delay(50);
+    }
   }
   printf("\033[0m");
 
@@ -6,7 +6,7 @@
 
 #include "delay.h"
 
-extern bool is_generating;
+extern volatile bool is_generating;
 
 void *gemini_loading(void *arg);
 
@@ -0,0 +1,13 @@
+#ifndef GETTIMEMS_H
+#define GETTIMEMS_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// monotonic clock in milliseconds, only useful for measuring durations
+double get_time_ms(void);
+
+#endif
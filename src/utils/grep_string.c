@@ -1,41 +1,47 @@
 #include "grep_string.h"
 
-char *grep_string(const char *data) {
-  if (*data == '\0')
+// case-insensitive "Name:" match at the start of a header line
+static int header_name_matches(const char *line, size_t line_len,
+                               const char *name) {
+  size_t name_len = strlen(name);
+  if (line_len <= name_len || line[name_len] != ':')
+    return 0;
+
+  for (size_t i = 0; i < name_len; i++) {
+    if (tolower((unsigned char)line[i]) != tolower((unsigned char)name[i]))
+      return 0;
+  }
+
+  return 1;
+}
+
+char *grep_header(const char *data, const char *name) {
+  if (!data || *data == '\0')
     return NULL;
 
   const char *line_start = data;
   const char *new_line;
-  char line[1024];
 
   while ((new_line = strchr(line_start, '\n')) != NULL) {
     size_t line_len = new_line - line_start;
 
-    if (line_len >= sizeof(line)) {
-      line_len = sizeof(line) - 1;
-    }
-
-    memcpy(line, line_start, line_len);
-    line[line_len] = '\0';
-
-    const char *fo = strstr(line, "X-Goog-Upload-URL:");
-    if (fo != NULL) {
-      const char *url_start = strstr(fo, "https://");
-      if (url_start) {
-        const char *url_end = url_start;
-        while (*url_end != '\r') {
-          url_end++;
-        }
-
-        size_t url_len = url_end - url_start;
-        char *url = malloc(url_len + 1);
-        if (url) {
-          memcpy(url, url_start, url_len);
-          url[url_len] = '\0';
-        }
-        return url;
+    if (header_name_matches(line_start, line_len, name)) {
+      const char *value = line_start + strlen(name) + 1;
+      const char *value_end = new_line;
+
+      while (value < value_end && (*value == ' ' || *value == '\t'))
+        value++;
+      while (value_end > value &&
+             (value_end[-1] == '\r' || value_end[-1] == ' '))
+        value_end--;
+
+      size_t value_len = value_end - value;
+      char *result = malloc(value_len + 1);
+      if (result) {
+        memcpy(result, value, value_len);
+        result[value_len] = '\0';
       }
-      return NULL;
+      return result;
     }
 
     line_start = new_line + 1;
@@ -43,3 +49,7 @@ char *grep_string(const char *data) {
 
   return NULL;
 }
+
+char *grep_string(const char *data) {
+  return grep_header(data, "X-Goog-Upload-URL");
+}
@@ -1,9 +1,14 @@
 #ifndef GREPSTRING_H
 #define GREPSTRING_H
 
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 
+// value of the first "name:" line in raw response headers, NULL if absent
+char *grep_header(const char *data, const char *name);
+
+// X-Goog-Upload-URL from the resumable upload start response
 char *grep_string(const char *data);
 
 #endif
@@ -0,0 +1,81 @@
+#include "gzip.h"
+
+char *gzip_compress(const char *data, size_t len, int level, size_t *out_len) {
+  z_stream stream = {0};
+  // 15 window bits plus 16 asks for the gzip wrapper instead of zlib's
+  if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return NULL;
+
+  uLong bound = deflateBound(&stream, (uLong)len);
+  char *out = malloc(bound);
+  if (!out) {
+    deflateEnd(&stream);
+    return NULL;
+  }
+
+  stream.next_in = (Bytef *)data;
+  stream.avail_in = (uInt)len;
+  stream.next_out = (Bytef *)out;
+  stream.avail_out = (uInt)bound;
+
+  // the bound fits the whole member, one call finishes it
+  if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+    deflateEnd(&stream);
+    free(out);
+    return NULL;
+  }
+
+  *out_len = stream.total_out;
+  deflateEnd(&stream);
+
+  return out;
+}
+
+char *gzip_decompress(const char *data, size_t len, size_t *out_len) {
+  z_stream stream = {0};
+  // 32 detects gzip or zlib from the header
+  if (inflateInit2(&stream, 15 + 32) != Z_OK)
+    return NULL;
+
+  size_t capacity = len * 4 + 64;
+  char *out = malloc(capacity);
+  if (!out) {
+    inflateEnd(&stream);
+    return NULL;
+  }
+
+  stream.next_in = (Bytef *)data;
+  stream.avail_in = (uInt)len;
+
+  int status = Z_OK;
+  while (status != Z_STREAM_END) {
+    if (stream.total_out + 1 >= capacity) {
+      char *grown = realloc(out, capacity * 2);
+      if (!grown)
+        break;
+      out = grown;
+      capacity *= 2;
+    }
+
+    // one byte stays free for the terminator
+    stream.next_out = (Bytef *)out + stream.total_out;
+    stream.avail_out = (uInt)(capacity - stream.total_out - 1);
+
+    status = inflate(&stream, Z_NO_FLUSH);
+    if (status != Z_OK && status != Z_STREAM_END)
+      break;
+  }
+
+  if (status != Z_STREAM_END) {
+    inflateEnd(&stream);
+    free(out);
+    return NULL;
+  }
+
+  out[stream.total_out] = '\0';
+  *out_len = stream.total_out;
+  inflateEnd(&stream);
+
+  return out;
+}
@@ -0,0 +1,20 @@
+#ifndef GZIP_H
+#define GZIP_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+// level 1: JSON still shrinks 5-10x and a 100 KiB body takes well under a
+// millisecond, higher levels buy a few percent for several times the CPU
+#define GZIP_DEFAULT_LEVEL 1
+
+// data as a gzip member (RFC 1952, what Content-Encoding: gzip means).
+// returns a malloc'd buffer and its length in out_len, NULL on failure
+char *gzip_compress(const char *data, size_t len, int level, size_t *out_len);
+
+// the other way around, for gzip or zlib input. the result is NUL
+// terminated on top of out_len bytes, NULL when data is not valid
+char *gzip_decompress(const char *data, size_t len, size_t *out_len);
+
+#endif
@@ -0,0 +1,356 @@
+#include "json_extract.h"
+
+static const char *skip_ws(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+    p++;
+  return p;
+}
+
+// p at the opening quote, returns one past the closing quote
+static const char *skip_string(const char *p, const char *end) {
+  p++;
+  while (p < end) {
+    const char *quote = memchr(p, '"', end - p);
+    if (!quote)
+      return NULL;
+
+    // the quote is escaped when an odd number of backslashes precede it
+    size_t backslashes = 0;
+    for (const char *b = quote - 1; b >= p && *b == '\\'; b--)
+      backslashes++;
+
+    p = quote + 1;
+    if (backslashes % 2 == 0)
+      return p;
+  }
+  return NULL;
+}
+
+// p at the start of any value, returns one past its end
+static const char *skip_value(const char *p, const char *end) {
+  if (p >= end)
+    return NULL;
+
+  if (*p == '"')
+    return skip_string(p, end);
+
+  if (*p == '{' || *p == '[') {
+    int depth = 0;
+    while (p < end) {
+      char c = *p;
+      if (c == '"') {
+        p = skip_string(p, end);
+        if (!p)
+          return NULL;
+        continue;
+      }
+      if (c == '{' || c == '[')
+        depth++;
+      else if (c == '}' || c == ']')
+        depth--;
+      p++;
+      if (depth == 0)
+        return p;
+    }
+    return NULL;
+  }
+
+  // number, true, false, null
+  while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' &&
+         *p != '\n' && *p != '\r' && *p != '\t')
+    p++;
+  return p;
+}
+
+// object member lookup, key compared on its raw bytes
+static int find_key(const JsonSlice *object, const char *key, size_t key_len,
+                    JsonSlice *out) {
+  const char *end = object->start + object->len;
+  const char *p = skip_ws(object->start, end);
+  if (p >= end || *p != '{')
+    return -1;
+  p++;
+
+  while (1) {
+    p = skip_ws(p, end);
+    if (p >= end || *p != '"')
+      return -1;
+
+    const char *key_start = p + 1;
+    const char *key_end = skip_string(p, end);
+    if (!key_end)
+      return -1;
+    bool match = (size_t)(key_end - 1 - key_start) == key_len &&
+                 memcmp(key_start, key, key_len) == 0;
+
+    p = skip_ws(key_end, end);
+    if (p >= end || *p != ':')
+      return -1;
+    p = skip_ws(p + 1, end);
+
+    const char *value_end = skip_value(p, end);
+    if (!value_end)
+      return -1;
+
+    if (match) {
+      out->start = p;
+      out->len = value_end - p;
+      return 0;
+    }
+
+    p = skip_ws(value_end, end);
+    if (p >= end || *p != ',')
+      return -1;
+    p++;
+  }
+}
+
+static int find_index(const JsonSlice *array, long index, JsonSlice *out) {
+  const char *cursor = NULL;
+  JsonSlice element;
+
+  while (json_array_next(array, &cursor, &element) == 0) {
+    if (index-- == 0) {
+      *out = element;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+int json_slice_find(const JsonSlice *in, const char *path, JsonSlice *out) {
+  JsonSlice current = *in;
+  const char *p = path;
+
+  while (*p) {
+    if (*p == '.') {
+      p++;
+      continue;
+    }
+
+    if (*p == '[') {
+      char *index_end;
+      long index = strtol(p + 1, &index_end, 10);
+      if (*index_end != ']' || find_index(&current, index, &current) != 0)
+        return -1;
+      p = index_end + 1;
+      continue;
+    }
+
+    size_t key_len = strcspn(p, ".[");
+    if (find_key(&current, p, key_len, &current) != 0)
+      return -1;
+    p += key_len;
+  }
+
+  *out = current;
+  return 0;
+}
+
+int json_find(const char *json, size_t len, const char *path, JsonSlice *out) {
+  if (!json)
+    return -1;
+
+  JsonSlice root = {json, len};
+  return json_slice_find(&root, path, out);
+}
+
+int json_array_next(const JsonSlice *array, const char **cursor,
+                    JsonSlice *element) {
+  const char *end = array->start + array->len;
+  const char *p;
+
+  if (*cursor == NULL) {
+    p = skip_ws(array->start, end);
+    if (p >= end || *p != '[')
+      return -1;
+    p = skip_ws(p + 1, end);
+    if (p < end && *p == ']')
+      return -1;
+  } else {
+    p = skip_ws(*cursor, end);
+    if (p >= end || *p != ',')
+      return -1;
+    p = skip_ws(p + 1, end);
+  }
+
+  const char *value_end = skip_value(p, end);
+  if (!value_end)
+    return -1;
+
+  element->start = p;
+  element->len = value_end - p;
+  *cursor = value_end;
+
+  return 0;
+}
+
+bool json_slice_is_string(const JsonSlice *slice) {
+  return slice->len >= 2 && slice->start[0] == '"';
+}
+
+static unsigned hex_value(const char *p) {
+  unsigned value = 0;
+  for (int i = 0; i < 4; i++) {
+    char c = p[i];
+    value <<= 4;
+    if (c >= '0' && c <= '9')
+      value |= c - '0';
+    else if (c >= 'a' && c <= 'f')
+      value |= c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      value |= c - 'A' + 10;
+  }
+  return value;
+}
+
+// unescapes the inside of a string slice into out (at least len bytes),
+// returns the number of bytes written
+static size_t unescape_into(const JsonSlice *slice, char *out) {
+  const char *p = slice->start + 1;
+  const char *end = slice->start + slice->len - 1;
+  char *o = out;
+
+  while (p < end) {
+    const char *backslash = memchr(p, '\\', end - p);
+    if (!backslash) {
+      memcpy(o, p, end - p);
+      o += end - p;
+      break;
+    }
+
+    memcpy(o, p, backslash - p);
+    o += backslash - p;
+    p = backslash + 1;
+    if (p >= end)
+      break;
+
+    char c = *p++;
+    switch (c) {
+    case 'n':
+      *o++ = '\n';
+      break;
+    case 't':
+      *o++ = '\t';
+      break;
+    case 'r':
+      *o++ = '\r';
+      break;
+    case 'b':
+      *o++ = '\b';
+      break;
+    case 'f':
+      *o++ = '\f';
+      break;
+    case 'u': {
+      if (end - p < 4)
+        break;
+      unsigned code = hex_value(p);
+      p += 4;
+
+      // surrogate pair -> one code point
+      if (code >= 0xD800 && code <= 0xDBFF && end - p >= 6 && p[0] == '\\' &&
+          p[1] == 'u') {
+        unsigned low = hex_value(p + 2);
+        if (low >= 0xDC00 && low <= 0xDFFF) {
+          code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          p += 6;
+        }
+      }
+
+      // a \uXXXX escape is 6 bytes and its UTF-8 form at most 4
+      if (code < 0x80) {
+        *o++ = (char)code;
+      } else if (code < 0x800) {
+        *o++ = (char)(0xC0 | (code >> 6));
+        *o++ = (char)(0x80 | (code & 0x3F));
+      } else if (code < 0x10000) {
+        *o++ = (char)(0xE0 | (code >> 12));
+        *o++ = (char)(0x80 | ((code >> 6) & 0x3F));
+        *o++ = (char)(0x80 | (code & 0x3F));
+      } else {
+        *o++ = (char)(0xF0 | (code >> 18));
+        *o++ = (char)(0x80 | ((code >> 12) & 0x3F));
+        *o++ = (char)(0x80 | ((code >> 6) & 0x3F));
+        *o++ = (char)(0x80 | (code & 0x3F));
+      }
+      break;
+    }
+    default: // \" \\ \/
+      *o++ = c;
+      break;
+    }
+  }
+
+  return o - out;
+}
+
+char *json_slice_string(const JsonSlice *slice) {
+  if (!json_slice_is_string(slice))
+    return NULL;
+
+  char *out = malloc(slice->len - 1);
+  if (!out)
+    return NULL;
+
+  size_t len = unescape_into(slice, out);
+  out[len] = '\0';
+
+  return out;
+}
+
+long long json_slice_int(const JsonSlice *slice, long long fallback) {
+  if (slice->len == 0 || slice->start[0] == '"' || slice->start[0] == '{' ||
+      slice->start[0] == '[' || slice->start[0] == 'n')
+    return fallback;
+
+  return strtoll(slice->start, NULL, 10);
+}
+
+double json_slice_double(const JsonSlice *slice, double fallback) {
+  if (slice->len == 0 || slice->start[0] == '"' || slice->start[0] == '{' ||
+      slice->start[0] == '[' || slice->start[0] == 'n')
+    return fallback;
+
+  return strtod(slice->start, NULL);
+}
+
+char *json_concat_text(const char *json, size_t len, const char *parts_path) {
+  JsonSlice parts;
+  if (json_find(json, len, parts_path, &parts) != 0)
+    return NULL;
+
+  // first pass sizes the result from the raw slices (unescaping only
+  // shrinks), the second unescapes straight into it
+  size_t total = 0;
+  int found = 0;
+  const char *cursor = NULL;
+  JsonSlice part, text;
+
+  while (json_array_next(&parts, &cursor, &part) == 0) {
+    if (json_slice_find(&part, "text", &text) == 0 &&
+        json_slice_is_string(&text)) {
+      total += text.len - 2;
+      found++;
+    }
+  }
+
+  if (found == 0)
+    return NULL;
+
+  char *out = malloc(total + 1);
+  if (!out)
+    return NULL;
+
+  size_t written = 0;
+  cursor = NULL;
+  while (json_array_next(&parts, &cursor, &part) == 0) {
+    if (json_slice_find(&part, "text", &text) == 0 &&
+        json_slice_is_string(&text)) {
+      written += unescape_into(&text, out + written);
+    }
+  }
+  out[written] = '\0';
+
+  return out;
+}
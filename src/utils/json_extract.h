@@ -0,0 +1,37 @@
+#ifndef JSONEXTRACT_H
+#define JSONEXTRACT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a value inside a JSON buffer, nothing is copied until asked for
+typedef struct JsonSlice {
+  const char *start; // first byte of the value ('"' for strings)
+  size_t len;        // whole value, quotes included
+} JsonSlice;
+
+// finds a value by path such as "candidates[0].content.parts[0].text" or
+// "file.uri", scanning the raw buffer once. returns 0 when found
+int json_find(const char *json, size_t len, const char *path, JsonSlice *out);
+
+// same, starting from a slice instead of the whole buffer
+int json_slice_find(const JsonSlice *in, const char *path, JsonSlice *out);
+
+// iterates an array slice: set *cursor to NULL first, returns 0 per element
+int json_array_next(const JsonSlice *array, const char **cursor,
+                    JsonSlice *element);
+
+bool json_slice_is_string(const JsonSlice *slice);
+// unescaped copy of a string value, NULL for anything else
+char *json_slice_string(const JsonSlice *slice);
+// number value, fallback for anything else
+long long json_slice_int(const JsonSlice *slice, long long fallback);
+double json_slice_double(const JsonSlice *slice, double fallback);
+
+// every "text" of the parts array at parts_path concatenated, one malloc
+// for the result, NULL when there is no text at all
+char *json_concat_text(const char *json, size_t len, const char *parts_path);
+
+#endif
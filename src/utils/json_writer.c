@@ -0,0 +1,221 @@
+#include "json_writer.h"
+
+static bool json_reserve(JsonWriter *w, size_t extra) {
+  if (w->failed)
+    return false;
+
+  if (w->len + extra + 1 <= w->cap)
+    return true;
+
+  size_t cap = w->cap ? w->cap : 1024;
+  while (cap < w->len + extra + 1) {
+    cap *= 2;
+  }
+
+  char *data = realloc(w->data, cap);
+  if (!data) {
+    fprintf(stderr, "[ERROR] Failed to realloc memory. \n");
+    w->failed = true;
+    return false;
+  }
+
+  w->data = data;
+  w->cap = cap;
+  return true;
+}
+
+static void json_put(JsonWriter *w, const char *bytes, size_t len) {
+  if (!json_reserve(w, len))
+    return;
+
+  memcpy(w->data + w->len, bytes, len);
+  w->len += len;
+  w->data[w->len] = '\0';
+}
+
+static void json_put_char(JsonWriter *w, char c) {
+  if (!json_reserve(w, 1))
+    return;
+
+  w->data[w->len++] = c;
+  w->data[w->len] = '\0';
+}
+
+// comma between siblings, nothing right after a key
+static void json_separate(JsonWriter *w) {
+  if (w->after_key) {
+    w->after_key = false;
+    return;
+  }
+
+  if (w->depth > 0 && w->has_items[w->depth - 1])
+    json_put_char(w, ',');
+
+  if (w->depth > 0)
+    w->has_items[w->depth - 1] = true;
+}
+
+void json_writer_reset(JsonWriter *w) {
+  w->len = 0;
+  w->depth = 0;
+  w->after_key = false;
+  w->failed = false;
+  if (w->data)
+    w->data[0] = '\0';
+}
+
+void json_writer_free(JsonWriter *w) {
+  free(w->data);
+  memset(w, 0, sizeof(*w));
+}
+
+static void json_open(JsonWriter *w, char c) {
+  json_separate(w);
+  json_put_char(w, c);
+
+  if (w->depth < JSON_WRITER_MAX_DEPTH) {
+    w->has_items[w->depth] = false;
+  } else {
+    w->failed = true;
+  }
+  w->depth++;
+}
+
+static void json_close(JsonWriter *w, char c) {
+  if (w->depth > 0)
+    w->depth--;
+  json_put_char(w, c);
+}
+
+void json_begin_object(JsonWriter *w) { json_open(w, '{'); }
+void json_end_object(JsonWriter *w) { json_close(w, '}'); }
+void json_begin_array(JsonWriter *w) { json_open(w, '['); }
+void json_end_array(JsonWriter *w) { json_close(w, ']'); }
+
+// characters that need escaping inside a JSON string
+static const char *json_escape_for(unsigned char c) {
+  switch (c) {
+  case '"':
+    return "\\\"";
+  case '\\':
+    return "\\\\";
+  case '\n':
+    return "\\n";
+  case '\r':
+    return "\\r";
+  case '\t':
+    return "\\t";
+  case '\b':
+    return "\\b";
+  case '\f':
+    return "\\f";
+  default:
+    return NULL;
+  }
+}
+
+void json_string_append(JsonWriter *w, const char *text, size_t len) {
+  // worst case every byte becomes \u00XX, reserving once keeps the copy
+  // loop free of capacity checks
+  if (!json_reserve(w, len * 6))
+    return;
+
+  char *out = w->data + w->len;
+  const char *run = text;
+  const char *end = text + len;
+
+  for (const char *p = text; p < end; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c >= 0x20 && c != '"' && c != '\\')
+      continue;
+
+    memcpy(out, run, p - run);
+    out += p - run;
+    run = p + 1;
+
+    const char *escaped = json_escape_for(c);
+    if (escaped) {
+      size_t escaped_len = strlen(escaped);
+      memcpy(out, escaped, escaped_len);
+      out += escaped_len;
+    } else {
+      out += sprintf(out, "\\u%04x", c);
+    }
+  }
+
+  memcpy(out, run, end - run);
+  out += end - run;
+
+  w->len = out - w->data;
+  w->data[w->len] = '\0';
+}
+
+void json_string_append_escaped(JsonWriter *w, const char *escaped,
+                                size_t len) {
+  json_put(w, escaped, len);
+}
+
+void json_string_begin(JsonWriter *w) {
+  json_separate(w);
+  json_put_char(w, '"');
+}
+
+void json_string_end(JsonWriter *w) { json_put_char(w, '"'); }
+
+void json_key(JsonWriter *w, const char *key) {
+  json_separate(w);
+  json_put_char(w, '"');
+  json_string_append(w, key, strlen(key));
+  json_put(w, "\":", 2);
+  w->after_key = true;
+}
+
+void json_string(JsonWriter *w, const char *value) {
+  json_string_begin(w);
+  json_string_append(w, value, strlen(value));
+  json_string_end(w);
+}
+
+void json_int(JsonWriter *w, long long value) {
+  char number[32];
+  int len = snprintf(number, sizeof(number), "%lld", value);
+
+  json_separate(w);
+  json_put(w, number, len);
+}
+
+void json_double(JsonWriter *w, double value) {
+  char number[32];
+  int len = snprintf(number, sizeof(number), "%.17g", value);
+
+  json_separate(w);
+  json_put(w, number, len);
+}
+
+void json_bool(JsonWriter *w, bool value) {
+  json_separate(w);
+  if (value)
+    json_put(w, "true", 4);
+  else
+    json_put(w, "false", 5);
+}
+
+void json_raw_value(JsonWriter *w, const char *json, size_t len) {
+  json_separate(w);
+  json_put(w, json, len);
+}
+
+char *json_escape(const char *text, size_t *out_len) {
+  JsonWriter w = {0};
+
+  json_string_append(&w, text, strlen(text));
+  if (w.failed) {
+    json_writer_free(&w);
+    return NULL;
+  }
+
+  if (out_len)
+    *out_len = w.len;
+
+  return w.data ? w.data : calloc(1, 1);
+}
@@ -0,0 +1,52 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_WRITER_MAX_DEPTH 32
+
+// compact JSON emitted straight into one growable buffer, reset and reuse
+// it across requests so steady state does no allocation at all
+typedef struct JsonWriter {
+  char *data;
+  size_t len;
+  size_t cap;
+  int depth;
+  bool has_items[JSON_WRITER_MAX_DEPTH]; // needs a comma before the next item
+  bool after_key;
+  bool failed; // an allocation failed, data is incomplete
+} JsonWriter;
+
+void json_writer_reset(JsonWriter *w);
+void json_writer_free(JsonWriter *w);
+
+void json_begin_object(JsonWriter *w);
+void json_end_object(JsonWriter *w);
+void json_begin_array(JsonWriter *w);
+void json_end_array(JsonWriter *w);
+
+void json_key(JsonWriter *w, const char *key);
+void json_string(JsonWriter *w, const char *value);
+void json_int(JsonWriter *w, long long value);
+void json_double(JsonWriter *w, double value);
+void json_bool(JsonWriter *w, bool value);
+
+// a string value built from pieces, e.g. a pre-escaped prefix followed by
+// raw user text: begin, any mix of append/append_escaped, end
+void json_string_begin(JsonWriter *w);
+void json_string_append(JsonWriter *w, const char *text, size_t len);
+void json_string_append_escaped(JsonWriter *w, const char *escaped,
+                                size_t len);
+void json_string_end(JsonWriter *w);
+
+// appends an already valid JSON value as is
+void json_raw_value(JsonWriter *w, const char *json, size_t len);
+
+// escapes text once for later json_string_append_escaped calls, malloc'd
+char *json_escape(const char *text, size_t *out_len);
+
+#endif
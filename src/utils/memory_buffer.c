@@ -0,0 +1,254 @@
+#include "memory_buffer.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static char *pool[MEMORY_POOL_SIZE];
+static size_t pool_capacity[MEMORY_POOL_SIZE];
+static int pool_count = 0;
+
+static MemoryStats stats = {0};
+static size_t spill_at = MEMORY_DEFAULT_SPILL_AT;
+static size_t limit = MEMORY_DEFAULT_LIMIT;
+
+void memory_init(Memory *mem) {
+  *mem = (Memory){0};
+
+  pthread_mutex_lock(&pool_lock);
+  if (pool_count > 0) {
+    pool_count--;
+    mem->response = pool[pool_count];
+    mem->capacity = pool_capacity[pool_count];
+    stats.pooled++;
+  }
+  pthread_mutex_unlock(&pool_lock);
+
+  if (!mem->response) {
+    mem->response = malloc(MEMORY_INITIAL_CAPACITY);
+    mem->capacity = mem->response ? MEMORY_INITIAL_CAPACITY : 0;
+  }
+
+  if (mem->response)
+    mem->response[0] = '\0';
+}
+
+int memory_reserve(Memory *mem, size_t extra) {
+  size_t needed = mem->size + extra + 1;
+  if (mem->response && needed <= mem->capacity)
+    return 0;
+
+  size_t capacity = mem->capacity ? mem->capacity : MEMORY_INITIAL_CAPACITY;
+  while (capacity < needed) {
+    capacity *= 2;
+  }
+
+  char *temp = realloc(mem->response, capacity);
+  if (!temp) {
+    fprintf(stderr, "[ERROR] Failed to realloc memory. \n");
+    return -1;
+  }
+
+  mem->response = temp;
+  mem->capacity = capacity;
+  mem->reallocs++;
+
+  return 0;
+}
+
+// moves what is in memory to a temp file, later appends go straight there
+static int memory_spill(Memory *mem) {
+  mem->spill = tmpfile();
+  if (!mem->spill) {
+    fprintf(stderr, "[ERROR] Could not create a temp file to spill to.\n");
+    return -1;
+  }
+
+  if (mem->size > 0 &&
+      fwrite(mem->response, 1, mem->size, mem->spill) != mem->size) {
+    fprintf(stderr, "[ERROR] Could not spill response to disk.\n");
+    fclose(mem->spill);
+    mem->spill = NULL;
+    return -1;
+  }
+
+  mem->spilled = mem->size;
+  mem->size = 0;
+  if (mem->response)
+    mem->response[0] = '\0';
+
+  return 0;
+}
+
+static void memory_unmap(Memory *mem) {
+  if (!mem->view)
+    return;
+
+#ifdef _WIN32
+  UnmapViewOfFile(mem->view);
+#else
+  munmap(mem->view, mem->spilled);
+#endif
+  mem->view = NULL;
+}
+
+size_t memory_append(Memory *mem, const char *data, size_t len) {
+  size_t body_len = mem->size + mem->spilled;
+  if (mem->limit > 0 && body_len + len > mem->limit) {
+    mem->over_limit = 1;
+    return 0;
+  }
+
+  if (!mem->spill && mem->spill_at > 0 && mem->size + len > mem->spill_at) {
+    if (memory_spill(mem) != 0)
+      return 0;
+  }
+
+  if (mem->spill) {
+    memory_unmap(mem);
+    if (fwrite(data, 1, len, mem->spill) != len)
+      return 0;
+    mem->spilled += len;
+    mem->written += len;
+    return len;
+  }
+
+  if (memory_reserve(mem, len) != 0)
+    return 0;
+
+  memcpy(mem->response + mem->size, data, len);
+  mem->size += len;
+  mem->response[mem->size] = '\0';
+
+  mem->written += len;
+  if (mem->size > mem->peak)
+    mem->peak = mem->size;
+
+  return len;
+}
+
+const char *memory_body(Memory *mem) {
+  if (!mem->spill)
+    return mem->response;
+  if (mem->view)
+    return mem->view;
+  if (fflush(mem->spill) != 0)
+    return NULL;
+
+  // the page cache holds the body, not the heap
+#ifdef _WIN32
+  HANDLE file = (HANDLE)_get_osfhandle(_fileno(mem->spill));
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping)
+    return NULL;
+  mem->view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, mem->spilled);
+  // the view keeps the mapping alive
+  CloseHandle(mapping);
+#else
+  void *view =
+      mmap(NULL, mem->spilled, PROT_READ, MAP_PRIVATE, fileno(mem->spill), 0);
+  mem->view = view == MAP_FAILED ? NULL : view;
+#endif
+  if (!mem->view)
+    fprintf(stderr, "[ERROR] Could not map the spilled response.\n");
+
+  return mem->view;
+}
+
+size_t memory_body_len(const Memory *mem) {
+  return mem->spill ? mem->spilled : mem->size;
+}
+
+// drops the spill file and its mapping
+static void memory_close_spill(Memory *mem) {
+  memory_unmap(mem);
+  if (mem->spill)
+    fclose(mem->spill);
+  mem->spill = NULL;
+  mem->spilled = 0;
+}
+
+void memory_clear(Memory *mem) {
+  memory_close_spill(mem);
+  mem->over_limit = 0;
+  mem->size = 0;
+  if (mem->response)
+    mem->response[0] = '\0';
+}
+
+void memory_release(Memory *mem) {
+  // never initialized or already released
+  if (!mem->response && !mem->spill && mem->written == 0)
+    return;
+
+  int spilled = mem->spill != NULL;
+  memory_close_spill(mem);
+
+  pthread_mutex_lock(&pool_lock);
+  stats.buffers++;
+  stats.bytes += mem->written;
+  stats.reallocs += mem->reallocs;
+  stats.spills += spilled;
+  stats.overflows += mem->over_limit != 0;
+  if (mem->peak > stats.peak)
+    stats.peak = mem->peak;
+
+  // {malloc(1), 0} buffers have no known capacity, don't pool those
+  if (mem->response && mem->capacity >= MEMORY_INITIAL_CAPACITY &&
+      mem->capacity <= MEMORY_POOL_MAX_CAPACITY &&
+      pool_count < MEMORY_POOL_SIZE) {
+    pool[pool_count] = mem->response;
+    pool_capacity[pool_count] = mem->capacity;
+    pool_count++;
+    mem->response = NULL;
+  }
+  pthread_mutex_unlock(&pool_lock);
+
+  free(mem->response);
+  *mem = (Memory){0};
+}
+
+char *memory_detach(Memory *mem) {
+  char *response = NULL;
+
+  if (mem->spill) {
+    response = malloc(mem->spilled + 1);
+    rewind(mem->spill);
+    if (response &&
+        fread(response, 1, mem->spilled, mem->spill) == mem->spilled) {
+      response[mem->spilled] = '\0';
+    } else {
+      fprintf(stderr, "[ERROR] Could not read the spilled response.\n");
+      free(response);
+      response = NULL;
+    }
+  } else {
+    response = mem->response;
+    mem->response = NULL;
+  }
+  memory_release(mem);
+
+  return response;
+}
+
+int memory_spilled(const Memory *mem) { return mem->spill != NULL; }
+
+int memory_over_limit(const Memory *mem) { return mem->over_limit; }
+
+void memory_set_spill_at(size_t bytes) { spill_at = bytes; }
+
+size_t memory_spill_at(void) { return spill_at; }
+
+void memory_set_limit(size_t bytes) { limit = bytes; }
+
+size_t memory_limit(void) { return limit; }
+
+void memory_stats(MemoryStats *out) {
+  pthread_mutex_lock(&pool_lock);
+  *out = stats;
+  pthread_mutex_unlock(&pool_lock);
+}
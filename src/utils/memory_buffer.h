@@ -0,0 +1,81 @@
+#ifndef MEMORYBUFFER_H
+#define MEMORYBUFFER_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../types/types.h"
+
+// first allocation, about one curl chunk so most headers never grow
+#define MEMORY_INITIAL_CAPACITY 4096
+// released buffers kept for the next request
+#define MEMORY_POOL_SIZE 8
+// bigger buffers are freed instead of pooled
+#define MEMORY_POOL_MAX_CAPACITY (1024 * 1024)
+// gemini response bodies past this move to a temp file, see
+// memory_set_spill_at()
+#define MEMORY_DEFAULT_SPILL_AT (4 * 1024 * 1024)
+// default size limit of gemini responses, see memory_set_limit()
+#define MEMORY_DEFAULT_LIMIT (32 * 1024 * 1024)
+
+typedef struct MemoryStats {
+  unsigned long long buffers;  // buffers released so far
+  unsigned long long bytes;    // bytes appended to them
+  unsigned long long reallocs; // times any of them had to grow
+  unsigned long long spills;   // bodies that went to a temp file
+  unsigned long long overflows; // bodies cut off at their limit
+  unsigned long long pooled;   // inits served from the pool
+  size_t peak;                 // largest buffer held in memory
+} MemoryStats;
+
+// empty buffer, reusing a pooled allocation when there is one
+void memory_init(Memory *mem);
+
+// makes room for extra more bytes plus the terminator, doubling the
+// capacity so a body of n bytes costs O(log n) reallocs. returns 0 on success
+int memory_reserve(Memory *mem, size_t extra);
+
+// appends and keeps response NUL terminated, returns len or 0 on failure.
+// once the body would pass spill_at, what is in memory moves to a temp file
+// and later appends go there, read it back with memory_body(). an append
+// that would go past limit fails and sets over_limit, so a write callback
+// aborts the transfer there
+size_t memory_append(Memory *mem, const char *data, size_t len);
+
+// the whole body, response itself or the spill file mapped read-only (not
+// NUL terminated then). valid until the next append, clear or release.
+// NULL when the spill can't be mapped
+const char *memory_body(Memory *mem);
+// its length, spilled bytes included
+size_t memory_body_len(const Memory *mem);
+
+// empties the buffer but keeps its capacity, spill threshold and limit
+void memory_clear(Memory *mem);
+
+// gives the buffer back to the pool and folds its counters into the stats
+void memory_release(Memory *mem);
+
+// hands the body to the caller as one NUL terminated allocation (free()
+// it), read back from the spill file when it went there. the rest is
+// released, NULL when a spilled body can't be read
+char *memory_detach(Memory *mem);
+
+// the body went to a temp file
+int memory_spilled(const Memory *mem);
+// the body was cut off at mem->limit
+int memory_over_limit(const Memory *mem);
+
+// spill threshold for response bodies, 0 keeps them in memory
+void memory_set_spill_at(size_t bytes);
+size_t memory_spill_at(void);
+
+// size limit for response bodies, 0 for none
+void memory_set_limit(size_t bytes);
+size_t memory_limit(void);
+
+void memory_stats(MemoryStats *out);
+
+#endif
@@ -0,0 +1,24 @@
+#include "parse_rfc3339.h"
+
+// days since 1970-01-01 for a proleptic gregorian date, avoids timegm which
+// windows does not have
+static long long days_from_civil(int year, int month, int day) {
+  year -= month <= 2;
+  long long era = (year >= 0 ? year : year - 399) / 400;
+  long long yoe = year - era * 400;
+  long long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+  return era * 146097 + doe - 719468;
+}
+
+long long parse_rfc3339(const char *timestamp) {
+  int year, month, day, hour, minute, second;
+
+  if (!timestamp || sscanf(timestamp, "%4d-%2d-%2dT%2d:%2d:%2d", &year, &month,
+                           &day, &hour, &minute, &second) != 6)
+    return -1;
+
+  return days_from_civil(year, month, day) * 86400LL + hour * 3600LL +
+         minute * 60LL + second;
+}
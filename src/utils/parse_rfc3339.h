@@ -0,0 +1,10 @@
+#ifndef PARSERFC3339_H
+#define PARSERFC3339_H
+
+#include <stdio.h>
+#include <time.h>
+
+// "2025-01-31T12:00:00.123Z" -> unix seconds, -1 if malformed
+long long parse_rfc3339(const char *timestamp);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct Sha256 {
+  uint32_t state[8];
+  uint64_t bit_len;
+  unsigned char block[64];
+  size_t block_len;
+} Sha256;
+
+void sha256_init(Sha256 *ctx);
+void sha256_update(Sha256 *ctx, const void *data, size_t len);
+// writes the digest as 64 lowercase hex chars plus '\0'
+void sha256_final_hex(Sha256 *ctx, char out_hex[65]);
+
+// hashes a file with a fixed 64 KiB buffer, returns 0 on success
+int sha256_file(const char *path, char out_hex[65]);
+
+#endif